@@ -15,3 +15,23 @@ const char * BepInExNotInstalledException::what() const noexcept {
 const char * BepInExInstallationError::what() const noexcept {
     return "There was an issue installing BepInEx.";
 }
+
+const char * ModpackInstallationError::what() const noexcept {
+    return "Some of the modpack files could not be installed.";
+}
+
+const char * DownloadFailedException::what() const noexcept {
+    return "A download failed. Check your internet connection and try again.";
+}
+
+const char * ExtractionFailedException::what() const noexcept {
+    return "Some files could not be extracted from the downloaded archive.";
+}
+
+const char * CorruptArchiveException::what() const noexcept {
+    return "The downloaded archive is corrupt.";
+}
+
+const char * ProfileSwitchException::what() const noexcept {
+    return "The profile could not be switched.";
+}
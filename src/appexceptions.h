@@ -27,4 +27,34 @@ public:
     const char * what() const noexcept override;
 };
 
+class ModpackInstallationError : public std::exception
+{
+public:
+    const char * what() const noexcept override;
+};
+
+class DownloadFailedException : public std::exception
+{
+public:
+    const char * what() const noexcept override;
+};
+
+class ExtractionFailedException : public std::exception
+{
+public:
+    const char * what() const noexcept override;
+};
+
+class CorruptArchiveException : public std::exception
+{
+public:
+    const char * what() const noexcept override;
+};
+
+class ProfileSwitchException : public std::exception
+{
+public:
+    const char * what() const noexcept override;
+};
+
 #endif // APPEXCEPTIONS_H
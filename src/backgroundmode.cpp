@@ -0,0 +1,135 @@
+#include "backgroundmode.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <thread>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Whether background mode is on
+static std::atomic<bool> enabled(false);
+
+// Bytes that may be written per second across all threads (0 leaves writes unpaced)
+static std::atomic<std::uint64_t> bytesPerSecond(20ull << 20);
+
+// Most workers any one job runs at once
+static std::atomic<unsigned> maxWorkers(2);
+
+// Writes can run this far ahead of the budget before they are held back, so short bursts aren't slowed
+static const std::chrono::milliseconds PACE_BURST(250);
+
+// The time by which everything written so far is within the budget
+static std::mutex paceMutex;
+static std::chrono::steady_clock::time_point paceClock;
+
+// Whether the current thread's priority has already been lowered
+static thread_local bool lowered = false;
+
+#ifdef __linux__
+// Niceness of lowered threads (19 is the lowest priority)
+static const int LOWERED_NICENESS = 10;
+
+// ioprio_set() arguments, which glibc has no header for: best-effort class, lowest level
+static const int IOPRIO_WHO_PROCESS = 1;
+static const int IOPRIO_CLASS_BE = 2;
+static const int IOPRIO_CLASS_SHIFT = 13;
+static const int IOPRIO_LOWEST_LEVEL = 7;
+#endif
+
+BackgroundMode::BackgroundMode() {}
+
+//=== FUNCTIONALITIES
+/* Runs a task and waits for it. In background mode the task runs on its own lowered thread, so the
+ * caller's priority is never touched (an unprivileged thread can't raise it back again). Exceptions
+ * thrown by the task are rethrown here.
+*/
+void BackgroundMode::run(const std::function<void()> &task) {
+    if (!isEnabled() || lowered) {
+        task();
+        return;
+    }
+
+    std::exception_ptr error;
+    std::thread worker([&]() {
+        lowerThreadPriority();
+        try {
+            task();
+        } catch (...) {
+            error = std::current_exception();
+        }
+    });
+    worker.join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+/* Lowers the calling thread's CPU and I/O priority for the rest of its life, if background mode is on.
+ * Only call it from threads that end with their work. I/O stays in the best-effort class rather than
+ * idle, so a disk that is never idle still lets the install finish.
+*/
+void BackgroundMode::lowerThreadPriority() {
+    if (!isEnabled() || lowered) {
+        return;
+    }
+    lowered = true;
+#ifdef _WIN32
+    // Lowers CPU, I/O and memory priority together
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#elif defined(__linux__)
+    // On Linux both priorities are per thread, addressed by thread ID
+    pid_t thread = static_cast<pid_t>(syscall(SYS_gettid));
+    setpriority(PRIO_PROCESS, static_cast<id_t>(thread), LOWERED_NICENESS);
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, thread, (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | IOPRIO_LOWEST_LEVEL);
+#endif
+}
+
+// Holds the calling thread back until the given bytes fit in the write budget
+void BackgroundMode::pace(std::uint64_t bytes) {
+    std::uint64_t budget = getBytesPerSecond();
+    if (!isEnabled() || budget == 0 || bytes == 0) {
+        return;
+    }
+
+    std::chrono::steady_clock::time_point wakeAt;
+    const auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(paceMutex);
+        paceClock = std::max(paceClock, now - PACE_BURST);
+        paceClock += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(bytes) / static_cast<double>(budget)));
+        wakeAt = paceClock;
+    }
+    if (wakeAt > now) {
+        std::this_thread::sleep_until(wakeAt);
+    }
+}
+
+// Returns how many workers to run out of the number wanted
+unsigned BackgroundMode::capWorkers(unsigned threads) {
+    if (!isEnabled()) {
+        return threads;
+    }
+    return std::max(1u, std::min(threads, getMaxWorkers()));
+}
+
+//=== SETTINGS
+void BackgroundMode::setEnabled(bool enabled) { ::enabled = enabled; }
+
+bool BackgroundMode::isEnabled() { return enabled; }
+
+void BackgroundMode::setBytesPerSecond(std::uint64_t bytesPerSecond) { ::bytesPerSecond = bytesPerSecond; }
+
+std::uint64_t BackgroundMode::getBytesPerSecond() { return bytesPerSecond; }
+
+void BackgroundMode::setMaxWorkers(unsigned workers) { maxWorkers = std::max(1u, workers); }
+
+unsigned BackgroundMode::getMaxWorkers() { return maxWorkers; }
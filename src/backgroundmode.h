@@ -0,0 +1,31 @@
+#ifndef BACKGROUNDMODE_H
+#define BACKGROUNDMODE_H
+#include <functional>
+#include <cstdint>
+
+/* Low-impact mode for installing while the machine is busy with other work. When it is on,
+ * extraction and install work runs on threads with lowered CPU and I/O priority, no more than a
+ * set number of workers run at once, and the bytes written are paced to a budget shared by every
+ * thread. When it is off, every call here does nothing (run() just calls the task).
+*/
+class BackgroundMode
+{
+public:
+    BackgroundMode();
+
+    //=== FUNCTIONALITIES
+    static void run(const std::function<void()> &task);
+    static void lowerThreadPriority();
+    static void pace(std::uint64_t bytes);
+    static unsigned capWorkers(unsigned threads);
+
+    //=== SETTINGS
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+    static void setBytesPerSecond(std::uint64_t bytesPerSecond);
+    static std::uint64_t getBytesPerSecond();
+    static void setMaxWorkers(unsigned workers);
+    static unsigned getMaxWorkers();
+};
+
+#endif // BACKGROUNDMODE_H
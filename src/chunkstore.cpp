@@ -0,0 +1,416 @@
+#include "chunkstore.h"
+#include "mappedfile.h"
+#include "zipindex.h"
+#include "sha256.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unordered_set>
+#include <zlib.h>
+#include <zstd.h>
+
+// Chunk sizes: no cut before MIN_CHUNK, a stricter mask until AVERAGE_CHUNK, a looser one after, and a forced cut at MAX_CHUNK
+static const std::size_t MIN_CHUNK = 16 << 10;
+static const std::size_t AVERAGE_CHUNK = 64 << 10;
+static const std::size_t MAX_CHUNK = 256 << 10;
+static const std::uint64_t MASK_STRICT = 0xFFFFC00000000000ull;
+static const std::uint64_t MASK_LOOSE = 0xFFFC000000000000ull;
+
+// Compression level used for stored chunks
+static const int CHUNK_LEVEL = 3;
+
+static const char * RECIPE_HEADER = "CHUNKS 1";
+
+// A file in a release recipe, with the chunks that make it up in order
+struct RecipeFile
+{
+    std::string name;
+    std::uint64_t size = 0;
+    std::uint32_t crc = 0;
+    std::vector<std::pair<std::string, std::uint64_t>> chunks;
+};
+
+// Returns the gear table of the rolling hash: 256 fixed pseudo-random values (splitmix64)
+static const std::uint64_t * gearTable() {
+    static std::uint64_t table[256];
+    static bool filled = [] {
+        std::uint64_t seed = 0x9E3779B97F4A7C15ull;
+        for (std::uint64_t &value : table) {
+            std::uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            value = z ^ (z >> 31);
+        }
+        return true;
+    }();
+    (void)filled;
+    return table;
+}
+
+static unsigned workerCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Reads a release recipe. Returns false if it is missing or malformed.
+static bool readRecipe(const std::string &path, std::vector<RecipeFile> &files) {
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line) || line != RECIPE_HEADER) {
+        return false;
+    }
+
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string kind;
+        fields >> kind;
+        if (kind == "F") {
+            RecipeFile file;
+            fields >> file.size >> file.crc;
+            fields.get();
+            std::getline(fields, file.name);
+            files.push_back(file);
+        } else if (kind == "C" && !files.empty()) {
+            std::pair<std::string, std::uint64_t> chunk;
+            fields >> chunk.first >> chunk.second;
+            files.back().chunks.push_back(chunk);
+        } else if (!kind.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ChunkStore::ChunkStore(const std::string &directory) : directory(directory) {}
+
+//=== FUNCTIONALITIES
+/* Cuts a buffer into content-defined chunks and returns where each chunk ends. Boundaries depend
+ * only on the bytes around them, so an edit early in a file doesn't shift the chunks after it.
+*/
+std::vector<std::size_t> ChunkStore::chunkBoundaries(const unsigned char * data, std::size_t size) {
+    const std::uint64_t * gear = gearTable();
+    std::vector<std::size_t> boundaries;
+    std::size_t start = 0;
+    while (start < size) {
+        std::size_t remaining = size - start;
+        std::size_t cut = remaining;
+        if (remaining > MIN_CHUNK) {
+            const unsigned char * p = data + start;
+            std::size_t end = std::min(remaining, MAX_CHUNK);
+            std::size_t normal = std::min(end, AVERAGE_CHUNK);
+            std::uint64_t hash = 0;
+            std::size_t i = MIN_CHUNK;
+            cut = end;
+            for (; i < normal; ++i) {
+                hash = (hash << 1) + gear[p[i]];
+                if ((hash & MASK_STRICT) == 0) { cut = i + 1; break; }
+            }
+            if (i == normal) {
+                for (; i < end; ++i) {
+                    hash = (hash << 1) + gear[p[i]];
+                    if ((hash & MASK_LOOSE) == 0) { cut = i + 1; break; }
+                }
+            }
+        }
+        start += cut;
+        boundaries.push_back(start);
+    }
+    return boundaries;
+}
+
+/* Chunks every file of a release archive into the store and records its recipe under a name.
+ * Files are decoded and chunked in parallel; chunks already in the store are not written again.
+ * Returns false if the archive can't be fully decoded.
+*/
+bool ChunkStore::addRelease(const std::string &name, const std::string &archivePath) {
+    MappedFile archive(archivePath);
+    if (!archive.isOpen()) {
+        return false;
+    }
+
+    std::vector<ZipEntry> entries;
+    ZipIndex zipIndex;
+    if (zipIndex.open(archivePath)) {
+        entries = zipIndex.entries();
+    } else if (ZipHandler::readCentralDirectory(archive.data(), archive.size(), entries)) {
+        std::sort(entries.begin(), entries.end(), [](const ZipEntry &a, const ZipEntry &b) { return a.name < b.name; });
+    } else {
+        return false;
+    }
+    for (const ZipEntry &entry : entries) {
+        if ((entry.flags & 1) || (entry.method != 0 && entry.method != 8) || entry.uncompressedSize > 0xFFFFFFFFull) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(directory) / "recipes", error);
+
+    std::vector<RecipeFile> files(entries.size());
+    std::atomic<std::size_t> nextEntry(0);
+    std::atomic<bool> failed(false);
+    auto work = [&](unsigned worker) {
+        std::vector<char> contents;
+        for (std::size_t i = nextEntry++; i < entries.size() && !failed; i = nextEntry++) {
+            const ZipEntry &entry = entries[i];
+            RecipeFile &file = files[i];
+            file.name = entry.name;
+            file.size = entry.uncompressedSize;
+            file.crc = entry.crc;
+            if (entry.name.empty() || entry.name.back() == '/') {
+                continue;
+            }
+
+            contents.resize(static_cast<std::size_t>(entry.uncompressedSize));
+            if (!ZipHandler::decodeEntry(archive.data(), archive.size(), entry, contents.data())) {
+                std::cerr << "Error decoding " << entry.name << "\n";
+                failed = true;
+                break;
+            }
+
+            const unsigned char * data = reinterpret_cast<const unsigned char *>(contents.data());
+            std::size_t start = 0;
+            for (std::size_t end : chunkBoundaries(data, contents.size())) {
+                std::string hash = Sha256::hash(data + start, end - start);
+                if (!storeChunk(data + start, end - start, hash, worker)) {
+                    failed = true;
+                    break;
+                }
+                file.chunks.emplace_back(hash, end - start);
+                start = end;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < workerCount(); ++i) {
+        workers.emplace_back(work, i);
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    if (failed) {
+        return false;
+    }
+
+    // Write the recipe to a temporary file, then swap it in
+    std::string path = recipePath(name);
+    {
+        std::ofstream out(path + ".tmp", std::ios::trunc);
+        out << RECIPE_HEADER << "\n";
+        for (const RecipeFile &file : files) {
+            out << "F " << file.size << " " << file.crc << " " << file.name << "\n";
+            for (const auto &chunk : file.chunks) {
+                out << "C " << chunk.first << " " << chunk.second << "\n";
+            }
+        }
+        if (!out) {
+            return false;
+        }
+    }
+    std::filesystem::rename(path + ".tmp", path, error);
+    return !error;
+}
+
+/* Rebuilds a stored release, writing each file to the destination of its mapping (see ZipHandler::extractMapped).
+ * Every chunk's SHA-256 and every file's CRC is checked. Returns 0, or -1 if the recipe is missing or any file failed.
+*/
+int ChunkStore::rebuild(const std::string &name, const std::vector<PathMapping> &mappings, ExtractStats * stats) const {
+    const auto startTime = std::chrono::steady_clock::now();
+    std::vector<RecipeFile> files;
+    if (!readRecipe(recipePath(name), files)) {
+        std::cerr << "Error reading recipe for release " << name << "\n";
+        return -1;
+    }
+
+    std::atomic<std::size_t> nextFile(0);
+    std::atomic<std::uint64_t> filesWritten(0);
+    std::atomic<std::uint64_t> filesFailed(0);
+    std::atomic<std::uint64_t> bytesWritten(0);
+    auto work = [&]() {
+        std::string compressed;
+        std::vector<char> chunk;
+        for (std::size_t i = nextFile++; i < files.size(); i = nextFile++) {
+            const RecipeFile &file = files[i];
+            std::string fullPath;
+            if (!ZipHandler::mapEntryPath(file.name, mappings, fullPath)) {
+                continue;
+            }
+            std::error_code error;
+            if (fullPath.back() == '/') {
+                std::filesystem::create_directories(fullPath, error);
+                continue;
+            }
+            std::filesystem::create_directories(std::filesystem::path(fullPath).parent_path(), error);
+
+            std::FILE * output = ZipHandler::createFile(fullPath);
+            bool ok = output != nullptr;
+            std::uint32_t crc = static_cast<std::uint32_t>(crc32(0L, Z_NULL, 0));
+            for (std::size_t c = 0; ok && c < file.chunks.size(); ++c) {
+                const std::string &hash = file.chunks[c].first;
+                std::ifstream in(chunkPath(hash), std::ios::binary);
+                compressed.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+                chunk.resize(static_cast<std::size_t>(file.chunks[c].second));
+                std::size_t length = ZSTD_decompress(chunk.data(), chunk.size(), compressed.data(), compressed.size());
+                ok = !ZSTD_isError(length) && length == chunk.size() && Sha256::hash(chunk.data(), chunk.size()) == hash
+                     && std::fwrite(chunk.data(), 1, chunk.size(), output) == chunk.size();
+                crc = static_cast<std::uint32_t>(crc32_z(crc, reinterpret_cast<const Bytef *>(chunk.data()), chunk.size()));
+            }
+            if (output != nullptr) {
+                std::fclose(output);
+            }
+
+            if (!ok || crc != file.crc) {
+                std::cerr << "Error rebuilding " << fullPath << "\n";
+                ++filesFailed;
+            } else {
+                ++filesWritten;
+                bytesWritten += file.size;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < workerCount(); ++i) {
+        workers.emplace_back(work);
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    if (stats != nullptr) {
+        stats->files = filesWritten;
+        stats->bytes = bytesWritten;
+        stats->skipped = 0;
+        stats->failed = filesFailed;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+    return filesFailed == 0 ? 0 : -1;
+}
+
+// Forgets a release, and the details kept with it. Its chunks stay until the next garbage collection.
+bool ChunkStore::removeRelease(const std::string &name) {
+    std::error_code error;
+    std::filesystem::remove(detailsPath(name), error);
+    return std::filesystem::remove(recipePath(name), error);
+}
+
+// Forgets every release except the most recently added "keep" ones
+void ChunkStore::prune(std::size_t keep) {
+    std::vector<std::pair<std::filesystem::file_time_type, std::string>> recipes;
+    for (const std::string &name : releases()) {
+        std::error_code error;
+        recipes.emplace_back(std::filesystem::last_write_time(recipePath(name), error), name);
+    }
+    std::sort(recipes.begin(), recipes.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+    for (std::size_t i = keep; i < recipes.size(); ++i) {
+        removeRelease(recipes[i].second);
+    }
+}
+
+// Deletes every chunk no recipe refers to (and any leftover temporary files). Returns the number of bytes freed.
+std::uint64_t ChunkStore::collectGarbage() {
+    std::unordered_set<std::string> referenced;
+    for (const std::string &name : releases()) {
+        std::vector<RecipeFile> files;
+        if (!readRecipe(recipePath(name), files)) {
+            // Keep everything rather than lose chunks a damaged recipe might still need
+            return 0;
+        }
+        for (const RecipeFile &file : files) {
+            for (const auto &chunk : file.chunks) {
+                referenced.insert(chunk.first);
+            }
+        }
+    }
+
+    std::uint64_t freed = 0;
+    std::error_code error;
+    std::filesystem::path objects = std::filesystem::path(directory) / "objects";
+    if (!std::filesystem::exists(objects, error)) {
+        return 0;
+    }
+    std::vector<std::filesystem::path> unreferenced;
+    for (const auto &item : std::filesystem::recursive_directory_iterator(objects, error)) {
+        if (!item.is_regular_file()) {
+            continue;
+        }
+        std::string hash = item.path().parent_path().filename().string() + item.path().filename().string();
+        if (referenced.count(hash) == 0) {
+            unreferenced.push_back(item.path());
+        }
+    }
+    for (const std::filesystem::path &path : unreferenced) {
+        std::uint64_t size = std::filesystem::file_size(path, error);
+        if (std::filesystem::remove(path, error)) {
+            freed += size;
+        }
+    }
+    return freed;
+}
+
+//=== GETTERS
+bool ChunkStore::hasRelease(const std::string &name) const {
+    return std::filesystem::exists(recipePath(name));
+}
+
+// Returns the names of every stored release
+std::vector<std::string> ChunkStore::releases() const {
+    std::vector<std::string> names;
+    std::error_code error;
+    for (const auto &item : std::filesystem::directory_iterator(std::filesystem::path(directory) / "recipes", error)) {
+        if (item.path().extension() == ".recipe") {
+            names.push_back(item.path().stem().string());
+        }
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// Returns where the caller keeps its own details about a release (such as its release JSON), next to its recipe
+std::string ChunkStore::detailsPath(const std::string &name) const {
+    std::string filename = name;
+    return (std::filesystem::path(directory) / "recipes" / (ZipHandler::sanitizeFilename(filename) + ".details")).string();
+}
+
+std::string ChunkStore::recipePath(const std::string &name) const {
+    std::string filename = name;
+    return (std::filesystem::path(directory) / "recipes" / (ZipHandler::sanitizeFilename(filename) + ".recipe")).string();
+}
+
+// Chunks are spread over 256 folders by the first byte of their hash
+std::string ChunkStore::chunkPath(const std::string &hash) const {
+    return (std::filesystem::path(directory) / "objects" / hash.substr(0, 2) / hash.substr(2)).string();
+}
+
+// Compresses and writes a chunk, unless the store already has it
+bool ChunkStore::storeChunk(const unsigned char * data, std::size_t size, const std::string &hash, unsigned worker) const {
+    std::string path = chunkPath(hash);
+    std::error_code error;
+    if (std::filesystem::exists(path, error)) {
+        return true;
+    }
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+    std::string compressed(ZSTD_compressBound(size), '\0');
+    std::size_t length = ZSTD_compress(&compressed[0], compressed.size(), data, size, CHUNK_LEVEL);
+    if (ZSTD_isError(length)) {
+        return false;
+    }
+
+    // Each worker writes through its own temporary file, so two workers storing the same chunk can't collide
+    std::string temporaryPath = path + ".tmp" + std::to_string(worker);
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        out.write(compressed.data(), static_cast<std::streamsize>(length));
+        if (!out) {
+            return false;
+        }
+    }
+    std::filesystem::rename(temporaryPath, path, error);
+    return !error;
+}
@@ -0,0 +1,39 @@
+#ifndef CHUNKSTORE_H
+#define CHUNKSTORE_H
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "ziphandler.h"
+
+/* A deduplicating store of release contents, kept in "<cache>/chunks". Every file in a release is
+ * cut into content-defined chunks with a FastCDC-style rolling (gear) hash, and each chunk is stored
+ * once, zstd-compressed, under its SHA-256. A release is recorded as a recipe listing its files and
+ * their chunks, so releases that share most of their bytes only cost their unique chunks.
+*/
+class ChunkStore
+{
+public:
+    ChunkStore(const std::string &directory);
+
+    //=== FUNCTIONALITIES
+    bool addRelease(const std::string &name, const std::string &archivePath);
+    int rebuild(const std::string &name, const std::vector<PathMapping> &mappings, ExtractStats * stats = nullptr) const;
+    bool removeRelease(const std::string &name);
+    void prune(std::size_t keep);
+    std::uint64_t collectGarbage();
+
+    //=== GETTERS
+    bool hasRelease(const std::string &name) const;
+    std::vector<std::string> releases() const;
+    std::string detailsPath(const std::string &name) const;
+    static std::vector<std::size_t> chunkBoundaries(const unsigned char * data, std::size_t size);
+
+private:
+    std::string recipePath(const std::string &name) const;
+    std::string chunkPath(const std::string &hash) const;
+    bool storeChunk(const unsigned char * data, std::size_t size, const std::string &hash, unsigned worker) const;
+
+    std::string directory;
+};
+
+#endif // CHUNKSTORE_H
@@ -0,0 +1,185 @@
+#include "configfile.h"
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+// A change to a release's text: replaces "length" characters at "offset" (inserting when it is 0)
+struct TextEdit
+{
+    std::size_t offset;
+    std::size_t length;
+    std::string replacement;
+};
+
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Narrows [begin, end) of a text down to its non-blank part
+static void trim(const std::string &text, std::size_t &begin, std::size_t &end) {
+    while (begin < end && isBlank(text[begin])) {
+        ++begin;
+    }
+    while (end > begin && isBlank(text[end - 1])) {
+        --end;
+    }
+}
+
+// Key of a setting in the index; names never hold line breaks, so one separates the two
+static std::string indexKey(const std::string &section, const std::string &key) {
+    return section + '\n' + key;
+}
+
+ConfigFile::ConfigFile() {}
+
+//=== FUNCTIONALITIES
+// Reads and parses a config file. Returns false if it can't be read.
+bool ConfigFile::load(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    parse(std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+    return true;
+}
+
+/* Parses a config file's text in a single pass. Lines that are neither a section, a setting nor a
+ * comment are kept in the text but otherwise ignored, as BepInEx does. If a setting appears twice,
+ * the first one counts.
+*/
+void ConfigFile::parse(std::string contents) {
+    text = std::move(contents);
+    entries.clear();
+    index.clear();
+    sectionEnds.clear();
+
+    std::string section;
+    std::size_t position = text.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+    while (position < text.size()) {
+        std::size_t lineEnd = text.find('\n', position);
+        lineEnd = lineEnd == std::string::npos ? text.size() : lineEnd + 1;
+        std::size_t begin = position;
+        std::size_t end = lineEnd;
+        trim(text, begin, end);
+        position = lineEnd;
+        if (begin == end || text[begin] == '#') {
+            continue;
+        }
+
+        if (text[begin] == '[' && text[end - 1] == ']') {
+            std::size_t nameBegin = begin + 1;
+            std::size_t nameEnd = end - 1;
+            trim(text, nameBegin, nameEnd);
+            section = text.substr(nameBegin, nameEnd - nameBegin);
+            sectionEnds[section] = lineEnd;
+            continue;
+        }
+
+        std::size_t equals = text.find('=', begin);
+        if (equals >= end) {
+            continue;
+        }
+        std::size_t keyBegin = begin;
+        std::size_t keyEnd = equals;
+        std::size_t valueBegin = equals + 1;
+        std::size_t valueEnd = end;
+        trim(text, keyBegin, keyEnd);
+        trim(text, valueBegin, valueEnd);
+
+        ConfigEntry entry;
+        entry.section = section;
+        entry.key = text.substr(keyBegin, keyEnd - keyBegin);
+        entry.value = text.substr(valueBegin, valueEnd - valueBegin);
+        entry.valueOffset = valueBegin;
+        entry.valueLength = valueEnd - valueBegin;
+        entry.lineEnd = lineEnd;
+        if (index.emplace(indexKey(entry.section, entry.key), entries.size()).second) {
+            entries.push_back(std::move(entry));
+        }
+        sectionEnds[section] = lineEnd;
+    }
+}
+
+/* Three-way merges a config file, returning the new release's text with this machine's edits applied:
+ *  - a setting changed locally (it differs from the base, the release it was installed from) keeps
+ *    its local value, even when the new release changed it too (counted in "conflicts");
+ *  - any other setting takes the new release's value;
+ *  - settings only this machine has (added by hand, or by a plugin newer than the release) are kept
+ *    at the end of their section, and settings the new release dropped are dropped.
+*/
+std::string ConfigFile::merge(const ConfigFile &base, const ConfigFile &local, const ConfigFile &release, std::size_t * conflicts) {
+    const std::string &releaseText = release.text;
+    const char * newline = releaseText.find("\r\n") != std::string::npos ? "\r\n" : "\n";
+
+    std::vector<TextEdit> edits;
+    std::size_t conflictCount = 0;
+    for (const ConfigEntry &entry : release.entries) {
+        const ConfigEntry * mine = local.find(entry.section, entry.key);
+        const ConfigEntry * original = base.find(entry.section, entry.key);
+        if (mine == nullptr || original == nullptr || mine->value == original->value || mine->value == entry.value) {
+            continue;
+        }
+        if (entry.value != original->value) {
+            ++conflictCount;
+        }
+        edits.push_back({ entry.valueOffset, entry.valueLength, mine->value });
+    }
+
+    // Local-only settings, in their local order; sections the release lacks are added at the end
+    std::vector<std::pair<std::string, std::string>> newSections;
+    for (const ConfigEntry &entry : local.entries) {
+        if (release.find(entry.section, entry.key) != nullptr || base.find(entry.section, entry.key) != nullptr) {
+            continue;
+        }
+        std::string line = entry.key + " = " + entry.value + newline;
+        auto sectionEnd = release.sectionEnds.find(entry.section);
+        if (sectionEnd != release.sectionEnds.end()) {
+            edits.push_back({ sectionEnd->second, 0, line });
+            continue;
+        }
+        auto existing = std::find_if(newSections.begin(), newSections.end(), [&](const std::pair<std::string, std::string> &s) { return s.first == entry.section; });
+        if (existing == newSections.end()) {
+            newSections.emplace_back(entry.section, "");
+            existing = newSections.end() - 1;
+        }
+        existing->second += line;
+    }
+    for (const std::pair<std::string, std::string> &section : newSections) {
+        std::string header = section.first.empty() ? "" : "[" + section.first + "]" + newline + newline;
+        edits.push_back({ releaseText.size(), 0, newline + header + section.second });
+    }
+    if (conflicts != nullptr) {
+        *conflicts = conflictCount;
+    }
+    if (edits.empty()) {
+        return releaseText;
+    }
+
+    std::stable_sort(edits.begin(), edits.end(), [](const TextEdit &a, const TextEdit &b) { return a.offset < b.offset; });
+    std::string merged;
+    merged.reserve(releaseText.size() + 256);
+    std::size_t copied = 0;
+    for (const TextEdit &edit : edits) {
+        merged.append(releaseText, copied, edit.offset - copied);
+
+        // Settings added after a last line with no line break need one first
+        if (edit.length == 0 && edit.offset == releaseText.size() && !merged.empty() && merged.back() != '\n') {
+            merged += newline;
+        }
+        merged += edit.replacement;
+        copied = edit.offset + edit.length;
+    }
+    merged.append(releaseText, copied, std::string::npos);
+    return merged;
+}
+
+//=== GETTERS
+const std::string &ConfigFile::getText() const { return text; }
+
+const std::vector<ConfigEntry> &ConfigFile::getEntries() const { return entries; }
+
+// Returns a setting, or nullptr if the file doesn't have it
+const ConfigEntry * ConfigFile::find(const std::string &section, const std::string &key) const {
+    auto found = index.find(indexKey(section, key));
+    return found == index.end() ? nullptr : &entries[found->second];
+}
@@ -0,0 +1,45 @@
+#ifndef CONFIGFILE_H
+#define CONFIGFILE_H
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+
+// A setting in a config file, with where its value and line sit in the file's text
+struct ConfigEntry
+{
+    std::string section;
+    std::string key;
+    std::string value;
+    std::size_t valueOffset = 0;
+    std::size_t valueLength = 0;
+    std::size_t lineEnd = 0;
+};
+
+/* A BepInEx .cfg file: [Section] headers, "Key = Value" settings and '#' comment lines. The original
+ * text is kept, so a merged file is written back with only its values changed and every comment,
+ * blank line and line ending where the release put it.
+*/
+class ConfigFile
+{
+public:
+    ConfigFile();
+
+    //=== FUNCTIONALITIES
+    bool load(const std::string &path);
+    void parse(std::string text);
+    static std::string merge(const ConfigFile &base, const ConfigFile &local, const ConfigFile &release, std::size_t * conflicts = nullptr);
+
+    //=== GETTERS
+    const std::string &getText() const;
+    const std::vector<ConfigEntry> &getEntries() const;
+    const ConfigEntry * find(const std::string &section, const std::string &key) const;
+
+private:
+    std::string text;
+    std::vector<ConfigEntry> entries;
+    std::unordered_map<std::string, std::size_t> index;
+    std::unordered_map<std::string, std::size_t> sectionEnds;
+};
+
+#endif // CONFIGFILE_H
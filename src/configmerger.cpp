@@ -0,0 +1,215 @@
+#include "configmerger.h"
+#include "configfile.h"
+#include "ziphandler.h"
+#include "backgroundmode.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Folder inside config holding the release's own copies of the files it shipped
+static const char * BASE_FOLDER = ".release";
+
+// Suffix of the folder the base is set aside in while an install replaces config
+static const char * HOLDING_SUFFIX = ".release";
+
+// Runs work(0) to work(count - 1) across worker threads
+static void forEachParallel(std::size_t count, const std::function<void(std::size_t)> &work) {
+    std::atomic<std::size_t> next(0);
+    auto worker = [&]() {
+        BackgroundMode::lowerThreadPriority();
+        for (std::size_t i = next++; i < count; i = next++) {
+            work(i);
+        }
+    };
+    unsigned threadCount = BackgroundMode::capWorkers(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < std::min<std::size_t>(threadCount, count); ++i) {
+        workers.emplace_back(worker);
+    }
+    for (std::thread &thread : workers) {
+        thread.join();
+    }
+}
+
+static bool readFile(const std::filesystem::path &path, std::string &contents) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// Replaces a file with the given contents, creating its folder if needed
+static bool writeFile(const std::filesystem::path &path, const std::string &contents) {
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    std::FILE * file = ZipHandler::createFile(path.string());
+    if (file == nullptr) {
+        return false;
+    }
+    bool written = contents.empty() || std::fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+    return std::fclose(file) == 0 && written;
+}
+
+// Lists the files under a folder by their path relative to it, leaving out the base folder
+static std::vector<std::string> listFiles(const std::filesystem::path &directory) {
+    std::vector<std::string> files;
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator it(directory, std::filesystem::directory_options::skip_permission_denied, error);
+    for (; !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+        if (it.depth() == 0 && it->path().filename() == BASE_FOLDER) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        if (it->is_regular_file(error)) {
+            files.push_back(it->path().lexically_relative(directory).generic_string());
+        }
+    }
+    return files;
+}
+
+static bool isConfigFile(const std::string &path) {
+    return path.size() > 4 && path.compare(path.size() - 4, 4, ".cfg") == 0;
+}
+
+ConfigMerger::ConfigMerger() {}
+
+//=== FUNCTIONALITIES
+/* Reads every file in the live config folder, and sets the base aside so the install can replace
+ * the folder. A base already set aside by an interrupted install is kept.
+*/
+void ConfigMerger::capture(const std::string &configDirectory) {
+    std::filesystem::path config(configDirectory);
+    holdingDirectory = configDirectory + HOLDING_SUFFIX;
+    localFiles.clear();
+
+    std::error_code error;
+    if (std::filesystem::exists(config / BASE_FOLDER, error)) {
+        std::filesystem::remove_all(holdingDirectory, error);
+        std::filesystem::rename(config / BASE_FOLDER, holdingDirectory, error);
+        if (error) {
+            std::cerr << "Error setting aside the config base: " << error.message() << "\n";
+        }
+    }
+
+    std::vector<std::string> files = listFiles(config);
+    std::vector<std::string> contents(files.size());
+    std::vector<char> read(files.size(), 0);
+    forEachParallel(files.size(), [&](std::size_t i) { read[i] = readFile(config / files[i], contents[i]); });
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        if (read[i]) {
+            localFiles.emplace(std::move(files[i]), std::move(contents[i]));
+        }
+    }
+}
+
+/* Merges the captured edits into the release just installed in a config folder (which may be a
+ * staging folder), records the release's files as the new base, and puts back local files the
+ * release doesn't ship: ones plugins created at runtime, or edited ones the release dropped.
+*/
+ConfigMergeResult ConfigMerger::apply(const std::string &configDirectory) {
+    const auto startTime = std::chrono::steady_clock::now();
+    std::filesystem::path config(configDirectory);
+    std::filesystem::path base = config / BASE_FOLDER;
+
+    // Bring the base back into the installed folder, replacing whatever stale one the install left there
+    std::error_code error;
+    std::filesystem::create_directories(config, error);
+    std::filesystem::remove_all(base, error);
+    if (!holdingDirectory.empty() && std::filesystem::exists(holdingDirectory, error)) {
+        std::filesystem::rename(holdingDirectory, base, error);
+        if (error) {
+            std::cerr << "Error restoring the config base: " << error.message() << "\n";
+        }
+    }
+
+    std::vector<std::string> releaseFiles = listFiles(config);
+    std::atomic<std::uint64_t> filesMerged(0);
+    std::atomic<std::uint64_t> conflicts(0);
+    std::atomic<std::uint64_t> failed(0);
+    forEachParallel(releaseFiles.size(), [&](std::size_t i) {
+        const std::string &path = releaseFiles[i];
+        std::string releaseText;
+        if (!readFile(config / path, releaseText)) {
+            ++failed;
+            return;
+        }
+        std::string baseText;
+        bool hasBase = readFile(base / path, baseText);
+
+        // Only files edited here since the base was installed need merging
+        auto local = localFiles.find(path);
+        if (hasBase && local != localFiles.end() && local->second != baseText) {
+            std::string merged;
+            if (isConfigFile(path)) {
+                ConfigFile baseFile, localFile, releaseFile;
+                baseFile.parse(baseText);
+                localFile.parse(local->second);
+                releaseFile.parse(releaseText);
+                std::size_t fileConflicts = 0;
+                merged = ConfigFile::merge(baseFile, localFile, releaseFile, &fileConflicts);
+                conflicts += fileConflicts;
+            } else {
+                merged = local->second;
+                conflicts += releaseText != baseText ? 1 : 0;
+            }
+            if (merged != releaseText) {
+                if (writeFile(config / path, merged)) {
+                    ++filesMerged;
+                } else {
+                    std::cerr << "Error writing merged config " << path << "\n";
+                    ++failed;
+                }
+            }
+        }
+
+        if ((!hasBase || baseText != releaseText) && !writeFile(base / path, releaseText)) {
+            std::cerr << "Error recording config base " << path << "\n";
+        }
+    });
+
+    // Put back local files the release doesn't ship, unless the release dropped them and they were never edited
+    std::unordered_set<std::string> shipped(releaseFiles.begin(), releaseFiles.end());
+    std::uint64_t filesKept = 0;
+    for (const auto &local : localFiles) {
+        if (shipped.count(local.first) > 0) {
+            continue;
+        }
+        std::string existing;
+        if ((readFile(base / local.first, existing) && existing == local.second)
+            || (readFile(config / local.first, existing) && existing == local.second)) {
+            continue;
+        }
+        if (writeFile(config / local.first, local.second)) {
+            ++filesKept;
+        } else {
+            std::cerr << "Error restoring config " << local.first << "\n";
+            ++failed;
+        }
+    }
+
+    // The base only describes files this release ships
+    for (const std::string &path : listFiles(base)) {
+        if (shipped.count(path) == 0) {
+            std::filesystem::remove(base / path, error);
+        }
+    }
+
+    ConfigMergeResult result;
+    result.filesChecked = releaseFiles.size();
+    result.filesMerged = filesMerged;
+    result.filesKept = filesKept;
+    result.conflicts = conflicts;
+    result.failed = failed;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return result;
+}
@@ -0,0 +1,41 @@
+#ifndef CONFIGMERGER_H
+#define CONFIGMERGER_H
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+// What a config merge did
+struct ConfigMergeResult
+{
+    std::uint64_t filesChecked = 0;
+    std::uint64_t filesMerged = 0;      // Release files rewritten with this machine's edits
+    std::uint64_t filesKept = 0;        // Local files the release doesn't ship, put back as they were
+    std::uint64_t conflicts = 0;        // Settings changed both here and in the release (the local value won)
+    std::uint64_t failed = 0;
+    double seconds = 0.0;
+};
+
+/* Carries this machine's config edits across a modpack install, which replaces the config folder
+ * with the release's. capture() reads the live config folder before the install; apply() then
+ * three-way merges each installed file between the release it replaced (the base), the captured
+ * local copy and the new release, and only rewrites the files whose merged contents differ.
+ * .cfg files are merged setting by setting (see ConfigFile::merge); any other file keeps its local
+ * copy if it was edited. The release's own copies of the files it shipped are kept in a ".release"
+ * folder inside config as the base of the next merge, so they follow staged installs, profiles and
+ * the install manifest like the rest of the folder.
+*/
+class ConfigMerger
+{
+public:
+    ConfigMerger();
+
+    //=== FUNCTIONALITIES
+    void capture(const std::string &configDirectory);
+    ConfigMergeResult apply(const std::string &configDirectory);
+
+private:
+    std::string holdingDirectory;
+    std::unordered_map<std::string, std::string> localFiles;
+};
+
+#endif // CONFIGMERGER_H
@@ -0,0 +1,145 @@
+#include "copyengine.h"
+#include "filecopier.h"
+#include "backgroundmode.h"
+#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+// Worker count used when none is given (0 picks one from the hardware)
+static std::atomic<unsigned> defaultThreads(0);
+
+// One worker's share of the jobs. The owner takes from the front, thieves from the back.
+struct WorkQueue
+{
+    std::mutex mutex;
+    std::deque<std::size_t> jobs;
+
+    bool takeFront(std::size_t &job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (jobs.empty()) {
+            return false;
+        }
+        job = jobs.front();
+        jobs.pop_front();
+        return true;
+    }
+
+    bool takeBack(std::size_t &job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (jobs.empty()) {
+            return false;
+        }
+        job = jobs.back();
+        jobs.pop_back();
+        return true;
+    }
+};
+
+CopyEngine::CopyEngine(unsigned threads) : threads(threads) {
+    if (this->threads == 0) {
+        this->threads = getDefaultThreads();
+    }
+}
+
+//=== FUNCTIONALITIES
+void CopyEngine::addDirectory(const std::string &path) {
+    directories.push_back(path);
+}
+
+void CopyEngine::addFile(const std::string &source, const std::string &target, std::uint64_t size) {
+    jobs.push_back({ source, target, size });
+}
+
+// Creates every directory, then copies every file across the worker threads
+CopyResult CopyEngine::run() {
+    CopyResult result;
+
+    // Parents sort before their children, so each directory is created once
+    std::sort(directories.begin(), directories.end());
+    for (const std::string &directory : directories) {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error) {
+            result.errors.push_back({ directory, error.message() });
+        }
+    }
+    if (jobs.empty()) {
+        return result;
+    }
+
+    // Deal the jobs out largest first, so big files start early and spread across workers
+    unsigned workerCount = static_cast<unsigned>(std::min<std::size_t>(BackgroundMode::capWorkers(threads), jobs.size()));
+    std::vector<std::size_t> order(jobs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) { return jobs[a].size > jobs[b].size; });
+    std::vector<WorkQueue> queues(workerCount);
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        queues[i % workerCount].jobs.push_back(order[i]);
+    }
+
+    std::mutex resultMutex;
+    auto work = [&](unsigned worker) {
+        BackgroundMode::lowerThreadPriority();
+        CopyResult local;
+        std::size_t index = 0;
+        while (true) {
+            // Take our own work first, then steal
+            bool found = queues[worker].takeFront(index);
+            for (unsigned k = 1; !found && k < workerCount; ++k) {
+                found = queues[(worker + k) % workerCount].takeBack(index);
+            }
+            if (!found) {
+                break;
+            }
+
+            const CopyJob &job = jobs[index];
+            CopyMethod method = FileCopier::copy(job.source, job.target);
+            if (method == CopyMethod::Failed) {
+                local.errors.push_back({ job.target, "the file could not be copied" });
+                continue;
+            }
+
+            // Hardlinks already share the source's time
+            if (method != CopyMethod::Hardlink) {
+                std::error_code error;
+                std::filesystem::last_write_time(job.target, std::filesystem::last_write_time(job.source, error), error);
+            }
+            ++local.filesCopied;
+            local.filesCloned += method == CopyMethod::Reflink ? 1 : 0;
+            local.filesLinked += method == CopyMethod::Hardlink ? 1 : 0;
+            local.bytesCopied += method == CopyMethod::Copy ? job.size : 0;
+        }
+
+        std::lock_guard<std::mutex> lock(resultMutex);
+        result.filesCopied += local.filesCopied;
+        result.filesCloned += local.filesCloned;
+        result.filesLinked += local.filesLinked;
+        result.bytesCopied += local.bytesCopied;
+        result.errors.insert(result.errors.end(), local.errors.begin(), local.errors.end());
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers.emplace_back(work, i);
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    return result;
+}
+
+//=== SETTINGS
+void CopyEngine::setDefaultThreads(unsigned threads) { defaultThreads = threads; }
+
+// Returns the worker count used when none is given. Copies mostly wait on the disk, so this is more than the core count.
+unsigned CopyEngine::getDefaultThreads() {
+    unsigned threads = defaultThreads;
+    if (threads == 0) {
+        threads = std::min(16u, std::max(2u, std::thread::hardware_concurrency() * 2));
+    }
+    return threads;
+}
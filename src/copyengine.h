@@ -0,0 +1,57 @@
+#ifndef COPYENGINE_H
+#define COPYENGINE_H
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// A file to be copied
+struct CopyJob
+{
+    std::string source;
+    std::string target;
+    std::uint64_t size = 0;
+};
+
+// A file that couldn't be copied, and why
+struct CopyError
+{
+    std::string path;
+    std::string message;
+};
+
+// What a copy run did
+struct CopyResult
+{
+    std::uint64_t filesCopied = 0;
+    std::uint64_t filesCloned = 0;
+    std::uint64_t filesLinked = 0;
+    std::uint64_t bytesCopied = 0;
+    std::vector<CopyError> errors;
+};
+
+/* Copies many files at once. Directories are all created up front, then the files are dealt
+ * (largest first) onto one queue per worker thread; a worker that runs out steals from the back
+ * of another's queue, so one slow disk or huge file doesn't leave the others idle. Each file goes
+ * through FileCopier and keeps its source's modification time. Errors are collected per file.
+*/
+class CopyEngine
+{
+public:
+    CopyEngine(unsigned threads = 0);
+
+    //=== FUNCTIONALITIES
+    void addDirectory(const std::string &path);
+    void addFile(const std::string &source, const std::string &target, std::uint64_t size);
+    CopyResult run();
+
+    //=== SETTINGS
+    static void setDefaultThreads(unsigned threads);
+    static unsigned getDefaultThreads();
+
+private:
+    unsigned threads;
+    std::vector<std::string> directories;
+    std::vector<CopyJob> jobs;
+};
+
+#endif // COPYENGINE_H
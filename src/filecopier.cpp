@@ -0,0 +1,122 @@
+#include "filecopier.h"
+#include "backgroundmode.h"
+#include <filesystem>
+#include <atomic>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#endif
+
+// Whether files are cloned by the filesystem when it supports it
+static std::atomic<bool> cloning(true);
+
+// Whether immutable files are hardlinked instead of copied
+static std::atomic<bool> hardlinking(true);
+
+// Bytes copied per call while background mode paces writes, so the budget is spent evenly through big files
+static const std::uint64_t PACED_COPY_CHUNK = 1 << 20;
+
+#ifdef __linux__
+// Clones a file with FICLONE (btrfs, XFS, bcachefs...). Leaves no target behind if the filesystem can't.
+static bool cloneFile(const std::string &source, const std::string &target) {
+    int in = ::open(source.c_str(), O_RDONLY);
+    if (in < 0) {
+        return false;
+    }
+    struct stat info;
+    int out = fstat(in, &info) == 0 ? ::open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC, info.st_mode & 0777) : -1;
+    bool cloned = out >= 0 && ioctl(out, FICLONE, in) == 0;
+    if (out >= 0) {
+        ::close(out);
+    }
+    ::close(in);
+    if (!cloned && out >= 0) {
+        ::unlink(target.c_str());
+    }
+    return cloned;
+}
+
+// Copies a file inside the kernel with copy_file_range, which never moves the bytes through user space
+static bool copyFileRange(const std::string &source, const std::string &target) {
+    int in = ::open(source.c_str(), O_RDONLY);
+    if (in < 0) {
+        return false;
+    }
+    struct stat info;
+    int out = fstat(in, &info) == 0 ? ::open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC, info.st_mode & 0777) : -1;
+    bool copied = out >= 0;
+    bool paced = BackgroundMode::isEnabled() && BackgroundMode::getBytesPerSecond() > 0;
+    for (off_t remaining = info.st_size; copied && remaining > 0;) {
+        std::uint64_t chunk = paced ? std::min<std::uint64_t>(remaining, PACED_COPY_CHUNK) : static_cast<std::uint64_t>(remaining);
+        BackgroundMode::pace(chunk);
+        ssize_t length = copy_file_range(in, nullptr, out, nullptr, static_cast<size_t>(chunk), 0);
+        copied = length > 0;
+        remaining -= length;
+    }
+    if (out >= 0) {
+        ::close(out);
+    }
+    ::close(in);
+    return copied;
+}
+#endif
+
+FileCopier::FileCopier() {}
+
+//=== FUNCTIONALITIES
+/* Copies a file, replacing whatever is at the target. On Windows the byte copy goes through CopyFile2,
+ * which clones blocks by itself on ReFS and Dev Drive volumes. Returns how the file was copied.
+*/
+CopyMethod FileCopier::copy(const std::string &source, const std::string &target) {
+    std::error_code error;
+    std::filesystem::remove(target, error);
+
+#ifdef __linux__
+    if (isCloning() && cloneFile(source, target)) {
+        return CopyMethod::Reflink;
+    }
+#endif
+
+    // Hardlinks only work within a volume; anywhere else this simply fails and the file is copied
+    if (isHardlinking() && isImmutable(source)) {
+        std::filesystem::create_hard_link(source, target, error);
+        if (!error) {
+            return CopyMethod::Hardlink;
+        }
+    }
+
+#ifdef __linux__
+    if (copyFileRange(source, target)) {
+        return CopyMethod::Copy;
+    }
+#endif
+
+    // The whole file is paced up front, as this copy can't be split up
+    error.clear();
+    std::uintmax_t size = std::filesystem::file_size(source, error);
+    BackgroundMode::pace(error ? 0 : size);
+    std::filesystem::copy_file(source, target, std::filesystem::copy_options::overwrite_existing, error);
+    return error ? CopyMethod::Failed : CopyMethod::Copy;
+}
+
+// Returns whether a file is never modified in place once installed, so it is safe to share with the cache
+bool FileCopier::isImmutable(const std::string &path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    return extension == ".dll";
+}
+
+//=== SETTINGS
+void FileCopier::setCloning(bool enabled) { cloning = enabled; }
+
+bool FileCopier::isCloning() { return cloning; }
+
+void FileCopier::setHardlinking(bool enabled) { hardlinking = enabled; }
+
+bool FileCopier::isHardlinking() { return hardlinking; }
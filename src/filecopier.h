@@ -0,0 +1,34 @@
+#ifndef FILECOPIER_H
+#define FILECOPIER_H
+#include <string>
+
+// How a file ended up at its destination
+enum class CopyMethod
+{
+    Failed,
+    Reflink,    // Cloned by the filesystem (shares blocks until either copy is written)
+    Hardlink,   // Linked to the same data as the source
+    Copy        // Bytes copied (in the kernel where possible)
+};
+
+/* Puts a copy of a file at a destination as cheaply as the filesystem allows: a reflink clone,
+ * then a hardlink for files that are never modified in place (plugin DLLs), then a byte copy.
+ * The destination is always unlinked first, so writing it can never write through a hardlink.
+*/
+class FileCopier
+{
+public:
+    FileCopier();
+
+    //=== FUNCTIONALITIES
+    static CopyMethod copy(const std::string &source, const std::string &target);
+    static bool isImmutable(const std::string &path);
+
+    //=== SETTINGS
+    static void setCloning(bool enabled);
+    static bool isCloning();
+    static void setHardlinking(bool enabled);
+    static bool isHardlinking();
+};
+
+#endif // FILECOPIER_H
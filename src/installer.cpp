@@ -1,7 +1,69 @@
 #include "installer.h"
 #include <filesystem>
+#include <vector>
 #include <QDebug>
 #include "appexceptions.h"
+#include "ziphandler.h"
+#include "installplan.h"
+#include "installmanifest.h"
+#include "trash.h"
+#include "backgroundmode.h"
+#include "configmerger.h"
+
+// Removes the modpack's folders from BepInEx, then recreates the plugins and patchers folders empty
+static void clearModpackFolders(const std::filesystem::path &pluginsDirectory, const std::filesystem::path &patchersDirectory, const std::filesystem::path &configDirectory) {
+    // Move the folders to the game's trash, to be deleted in the background
+    std::string trashDirectory = Trash::trashFor(pluginsDirectory.parent_path().string());
+    Trash::remove(pluginsDirectory.string(), trashDirectory);
+    Trash::remove(patchersDirectory.string(), trashDirectory);
+    // Remove all files except for BepInEx config
+    Trash::remove(configDirectory.string(), trashDirectory);
+
+    // Create the deleted/missing folders
+    std::filesystem::create_directory(pluginsDirectory);
+    std::filesystem::create_directory(patchersDirectory);
+}
+
+/* Brings an installed folder in line with a staged one, writing only what changed.
+ * Returns the number of files that couldn't be installed.
+*/
+static std::uint64_t installTree(const std::filesystem::path &source, const std::filesystem::path &target, const char * label, bool deleteExtra) {
+    InstallPlan plan = InstallPlan::compare(source.string(), target.string(), deleteExtra);
+    qDebug() << "Plan for" << label << ":" << plan.describe().c_str();
+
+    PlanResult result = plan.apply();
+    qDebug() << "Installed" << label << ":" << result.filesWritten << "files written (" << result.bytesWritten / 1000000 << "MB copied,"
+             << result.filesCloned << "cloned," << result.filesLinked << "hardlinked)," << result.filesDeleted << "deleted," << result.failed << "failed";
+    return result.failed;
+}
+
+// The modpack's folders in BepInEx, and the suffixes of their staged and previous copies
+static const char * MODPACK_FOLDERS[] = { "plugins", "patchers", "config" };
+static const char * STAGING_SUFFIX = ".staging";
+static const char * PREVIOUS_SUFFIX = ".previous";
+
+// The folders BepInEx loads code from, which are renamed with this suffix while the modpack is disabled
+static const char * LOADED_FOLDERS[] = { "plugins", "patchers" };
+static const char * DISABLED_SUFFIX = ".disabled";
+
+/* Renames each pair of paths in order. If one fails, the renames already done are undone
+ * before the error is rethrown, so the folders are never left half swapped.
+*/
+static void renameAll(const std::vector<std::pair<std::filesystem::path, std::filesystem::path>> &renames) {
+    std::size_t done = 0;
+    try {
+        for (; done < renames.size(); ++done) {
+            std::filesystem::rename(renames[done].first, renames[done].second);
+        }
+    } catch (std::filesystem::filesystem_error &e) {
+        qDebug() << "Error swapping folders, rolling back:" << e.what();
+        while (done-- > 0) {
+            std::error_code error;
+            std::filesystem::rename(renames[done].second, renames[done].first, error);
+        }
+        throw;
+    }
+}
 
 //=== CONSTRUCTORS/DESTRUCTORS
 Installer::Installer() {}
@@ -10,8 +72,10 @@ Installer::Installer(std::string filesDirectory, std::string gameDirectory)
 Installer::~Installer() {}
 
 //=== FUNCTIONALITIES
-// Installs the modpack
-void Installer::install(std::string &filesDirectory, std::string &gameDirectory) {
+/* Installs the modpack. The folders installed to can be given a suffix, so a staged install
+ * can build them next to the live ones before swapping them in.
+*/
+void Installer::install(std::string &filesDirectory, std::string &gameDirectory, const std::string &folderSuffix) {
     // Check if installation directory exists
     qDebug() << "Checking installation folder...";
     if (!std::filesystem::exists(filesDirectory)) {
@@ -50,39 +114,18 @@ void Installer::install(std::string &filesDirectory, std::string &gameDirectory)
     std::filesystem::path patchersInstallation(filesDirectory + "\\" + installationFolderName + "\\patchers");
 
     // Get destination paths
-    std::filesystem::path pluginsDirectory(bepinexDirectory + "\\plugins");
-    std::filesystem::path configDirectory(bepinexDirectory + "\\config");
-    std::filesystem::path patchersDirectory(bepinexDirectory + "\\patchers");
+    std::filesystem::path pluginsDirectory(bepinexDirectory + "\\plugins" + folderSuffix);
+    std::filesystem::path configDirectory(bepinexDirectory + "\\config" + folderSuffix);
+    std::filesystem::path patchersDirectory(bepinexDirectory + "\\patchers" + folderSuffix);
 
-    // Remove folders if they exist
-    if (std::filesystem::exists(pluginsDirectory)) {
-        std::filesystem::remove_all(pluginsDirectory);
+    // Bring the 3 folders in BepInEx in line with the staged ones, only writing what changed
+    std::uint64_t failed = 0;
+    failed += installTree(pluginsInstallation, pluginsDirectory, "plugins", true);
+    failed += installTree(patchersInstallation, patchersDirectory, "patchers", true);
+    failed += installTree(configInstallation, configDirectory, "config", true);
+    if (failed > 0) {
+        throw ModpackInstallationError();
     }
-    if (std::filesystem::exists(patchersDirectory)) {
-        std::filesystem::remove_all(patchersDirectory);
-    }
-    // Remove all files except for BepInEx config
-    if (std::filesystem::exists(configDirectory)) {
-        std::filesystem::remove_all(configDirectory);
-    }
-
-    // Create the deleted/missing folders
-    std::filesystem::create_directory(pluginsDirectory);
-    std::filesystem::create_directory(patchersDirectory);
-
-    // Move 3 folders into BepInEx directory
-    const auto copyOption = std::filesystem::copy_options::recursive | std::filesystem::copy_options::overwrite_existing;
-    qDebug() << "Installing plugins...";
-    std::filesystem::copy(pluginsInstallation, pluginsDirectory, copyOption);
-    qDebug() << "Installed plugins.";
-
-    qDebug() << "Installing patchers...";
-    std::filesystem::copy(patchersInstallation, patchersDirectory, copyOption);
-    qDebug() << "Installed patchers.";
-
-    qDebug() << "Installing config...";
-    std::filesystem::copy(configInstallation, configDirectory, copyOption);
-    qDebug() << "Installed config.";
 }
 
 // Installs the BepInEx mod dependency
@@ -98,13 +141,11 @@ void Installer::installBepInEx(std::string &filesDirectory, std::string &gameDir
     }
 
     try {
-        // Move the BepInEx files into the game files
+        // Copy the changed BepInEx files into the game files, leaving the game's own files alone
         std::filesystem::path bepinexInstallation(filesDirectory + "\\BepInExPack");
-        //for (auto & entry : std::filesystem::directory_iterator(bepinexInstallation)) {
-        // Copy file into game directory
-        const auto copyOptions = std::filesystem::copy_options::recursive | std::filesystem::copy_options::overwrite_existing;
-        std::filesystem::copy(bepinexInstallation, gameDirectory, copyOptions);
-        //}
+        if (installTree(bepinexInstallation, gameDirectory, "BepInEx", false) > 0) {
+            throw BepInExInstallationError();
+        }
     } catch (std::filesystem::filesystem_error & e) {
         qDebug() << "Error: " << e.what() << '\n';
         throw BepInExInstallationError();
@@ -114,34 +155,412 @@ void Installer::installBepInEx(std::string &filesDirectory, std::string &gameDir
 
 }
 
+// Installs the modpack straight from its release archive, skipping the extracted copy in the cache (see install() for the suffix)
+void Installer::installFromArchive(std::string &archivePath, std::string &gameDirectory, const std::string &folderSuffix) {
+    // Check if the archive exists
+    qDebug() << "Checking installation archive...";
+    if (!std::filesystem::exists(archivePath)) {
+        throw InstallationFilesNotFoundException();
+    }
+
+    // Check if game directory exists
+    qDebug() << "Checking game directory...";
+    if (!std::filesystem::exists(gameDirectory)) {
+        throw GameNotFoundException();
+    }
+
+    // Check if BepInEx directory exists
+    qDebug() << "Checking for BepInEx...";
+    std::string bepinexDirectory = gameDirectory + "\\BepInEx";
+    if (!std::filesystem::exists(std::filesystem::path(bepinexDirectory))) {
+        throw BepInExNotInstalledException();
+    }
+
+    // Find name of zipped folder
+    qDebug() << "Finding archive folder name...";
+    std::string root = ZipHandler::findRootFolder(archivePath);
+
+    // Get destination paths
+    std::filesystem::path pluginsDirectory(bepinexDirectory + "\\plugins" + folderSuffix);
+    std::filesystem::path configDirectory(bepinexDirectory + "\\config" + folderSuffix);
+    std::filesystem::path patchersDirectory(bepinexDirectory + "\\patchers" + folderSuffix);
+
+    // Remove folders if they exist and recreate the empty ones
+    clearModpackFolders(pluginsDirectory, patchersDirectory, configDirectory);
+
+    // Write the 3 folders from the archive directly into the BepInEx directory
+    qDebug() << "Installing plugins, patchers and config from archive...";
+    std::vector<PathMapping> mappings = {
+        { root + "plugins/", pluginsDirectory.string() },
+        { root + "patchers/", patchersDirectory.string() },
+        { root + "config/", configDirectory.string() },
+    };
+    if (ZipHandler::extractMapped(archivePath, mappings) != 0) {
+        throw ModpackInstallationError();
+    }
+    qDebug() << "Installed plugins, patchers and config.";
+}
+
+// Installs the BepInEx mod dependency straight from its archive
+void Installer::installBepInExFromArchive(std::string &archivePath, std::string &gameDirectory) {
+    // Check if the archive exists
+    if (!std::filesystem::exists(archivePath)) {
+        throw InstallationFilesNotFoundException();
+    }
+
+    // Check if game directory exists
+    if (!std::filesystem::exists(gameDirectory)) {
+        throw GameNotFoundException();
+    }
+
+    // Write the BepInExPack folder's contents into the game files
+    std::vector<PathMapping> mappings = { { "BepInExPack/", gameDirectory } };
+    if (ZipHandler::extractMapped(archivePath, mappings) != 0) {
+        throw BepInExInstallationError();
+    }
+}
+
+// Installs the modpack from an archive already decoded into memory, writing straight into the BepInEx directory (see install() for the suffix)
+void Installer::installFromMemory(const MemoryStage &stage, std::string &gameDirectory, const std::string &folderSuffix) {
+    // Check if game directory exists
+    qDebug() << "Checking game directory...";
+    if (!std::filesystem::exists(gameDirectory)) {
+        throw GameNotFoundException();
+    }
+
+    // Check if BepInEx directory exists
+    qDebug() << "Checking for BepInEx...";
+    std::string bepinexDirectory = gameDirectory + "\\BepInEx";
+    if (!std::filesystem::exists(std::filesystem::path(bepinexDirectory))) {
+        throw BepInExNotInstalledException();
+    }
+
+    std::string root = stage.findRootFolder();
+    std::filesystem::path pluginsDirectory(bepinexDirectory + "\\plugins" + folderSuffix);
+    std::filesystem::path configDirectory(bepinexDirectory + "\\config" + folderSuffix);
+    std::filesystem::path patchersDirectory(bepinexDirectory + "\\patchers" + folderSuffix);
+
+    // Remove folders if they exist and recreate the empty ones
+    clearModpackFolders(pluginsDirectory, patchersDirectory, configDirectory);
+
+    // Write the 3 folders from memory into the BepInEx directory
+    qDebug() << "Installing plugins, patchers and config from memory...";
+    std::vector<PathMapping> mappings = {
+        { root + "plugins/", pluginsDirectory.string() },
+        { root + "patchers/", patchersDirectory.string() },
+        { root + "config/", configDirectory.string() },
+    };
+    if (stage.writeTo(mappings) != 0) {
+        throw ModpackInstallationError();
+    }
+    qDebug() << "Installed plugins, patchers and config.";
+}
+
+// Installs the BepInEx mod dependency from an archive already decoded into memory
+void Installer::installBepInExFromMemory(const MemoryStage &stage, std::string &gameDirectory) {
+    // Check if game directory exists
+    if (!std::filesystem::exists(gameDirectory)) {
+        throw GameNotFoundException();
+    }
+
+    // Write the BepInExPack folder's contents into the game files
+    std::vector<PathMapping> mappings = { { "BepInExPack/", gameDirectory } };
+    if (stage.writeTo(mappings) != 0) {
+        throw BepInExInstallationError();
+    }
+}
+
+/* Gets the staging folders ready for a staged install. The previous install becomes the starting
+ * point, so a differential install only has to write what changed since that version.
+*/
+void Installer::prepareStaging(const std::string &gameDirectory) {
+    std::string bepinexDirectory = gameDirectory + "\\BepInEx\\";
+    for (const char * folder : MODPACK_FOLDERS) {
+        std::filesystem::path staging = std::filesystem::path(bepinexDirectory + folder + STAGING_SUFFIX);
+        std::filesystem::path previous = std::filesystem::path(bepinexDirectory + folder + PREVIOUS_SUFFIX);
+
+        // Clear out what a failed install left behind
+        std::filesystem::remove_all(staging);
+        if (std::filesystem::exists(previous)) {
+            std::filesystem::rename(previous, staging);
+        }
+    }
+}
+
+/* Swaps the staged folders in with renames, keeping the replaced ones as the previous install.
+ * Takes milliseconds whatever the pack size. Nothing is changed if any rename fails.
+*/
+void Installer::swapInStaging(const std::string &gameDirectory) {
+    std::string bepinexDirectory = gameDirectory + "\\BepInEx\\";
+    std::vector<std::pair<std::filesystem::path, std::filesystem::path>> renames;
+    for (const char * folder : MODPACK_FOLDERS) {
+        std::filesystem::path current = std::filesystem::path(bepinexDirectory + folder);
+        std::filesystem::path staging = std::filesystem::path(bepinexDirectory + folder + STAGING_SUFFIX);
+        std::filesystem::path previous = std::filesystem::path(bepinexDirectory + folder + PREVIOUS_SUFFIX);
+
+        // Every folder is swapped, even if the pack left it empty
+        std::filesystem::create_directories(staging);
+        std::filesystem::remove_all(previous);
+        if (std::filesystem::exists(current)) {
+            renames.emplace_back(current, previous);
+        }
+        renames.emplace_back(staging, current);
+    }
+
+    try {
+        renameAll(renames);
+    } catch (...) {
+        throw ModpackInstallationError();
+    }
+}
+
+// Swaps the previous install back in, keeping the current one as the new previous install
+void Installer::rollback(const std::string &gameDirectory) {
+    if (!hasPreviousInstall(gameDirectory)) {
+        throw InstallationFilesNotFoundException();
+    }
+
+    std::string bepinexDirectory = gameDirectory + "\\BepInEx\\";
+    std::vector<std::pair<std::filesystem::path, std::filesystem::path>> renames;
+    for (const char * folder : MODPACK_FOLDERS) {
+        std::filesystem::path current = std::filesystem::path(bepinexDirectory + folder);
+        std::filesystem::path previous = std::filesystem::path(bepinexDirectory + folder + PREVIOUS_SUFFIX);
+        std::filesystem::path swap = std::filesystem::path(bepinexDirectory + folder + ".swap");
+        std::filesystem::remove_all(swap);
+        if (std::filesystem::exists(current)) {
+            renames.emplace_back(current, swap);
+        }
+        renames.emplace_back(previous, current);
+        if (std::filesystem::exists(current)) {
+            renames.emplace_back(swap, previous);
+        }
+    }
+
+    try {
+        renameAll(renames);
+    } catch (...) {
+        throw ModpackInstallationError();
+    }
+}
+
+// Returns whether a staged install left a previous version to roll back to
+bool Installer::hasPreviousInstall(const std::string &gameDirectory) {
+    std::string bepinexDirectory = gameDirectory + "\\BepInEx\\";
+    for (const char * folder : MODPACK_FOLDERS) {
+        if (!std::filesystem::exists(std::filesystem::path(bepinexDirectory + folder + PREVIOUS_SUFFIX))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Moves the previous install to the trash, once it can no longer be rolled back to
+void Installer::discardPrevious(const std::string &gameDirectory) {
+    std::string bepinexDirectory = gameDirectory + "\\BepInEx\\";
+    std::string trashDirectory = Trash::trashFor(gameDirectory + "\\BepInEx");
+    for (const char * folder : MODPACK_FOLDERS) {
+        Trash::remove(bepinexDirectory + folder + PREVIOUS_SUFFIX, trashDirectory);
+    }
+}
+
+/* Moves the plugins and patchers back into BepInEx's load path. A folder BepInEx recreated empty
+ * while the modpack was disabled is replaced; anything else put there stops the switch.
+*/
+void Installer::enable(const std::string &gameDirectory) {
+    std::string bepinexDirectory = gameDirectory + "\\BepInEx\\";
+    std::vector<std::pair<std::filesystem::path, std::filesystem::path>> renames;
+    for (const char * folder : LOADED_FOLDERS) {
+        std::filesystem::path current(bepinexDirectory + folder);
+        std::filesystem::path disabled(bepinexDirectory + folder + DISABLED_SUFFIX);
+        if (!std::filesystem::exists(disabled)) {
+            continue;
+        }
+        if (std::filesystem::exists(current)) {
+            // Throws if the folder isn't empty
+            std::filesystem::remove(current);
+        }
+        renames.emplace_back(disabled, current);
+    }
+    renameAll(renames);
+}
+
+// Moves the plugins and patchers out of BepInEx's load path, so the game starts unmodded
+void Installer::disable(const std::string &gameDirectory) {
+    std::string bepinexDirectory = gameDirectory + "\\BepInEx\\";
+    std::vector<std::pair<std::filesystem::path, std::filesystem::path>> renames;
+    for (const char * folder : LOADED_FOLDERS) {
+        std::filesystem::path current(bepinexDirectory + folder);
+        std::filesystem::path disabled(bepinexDirectory + folder + DISABLED_SUFFIX);
+        if (std::filesystem::exists(current) && !std::filesystem::exists(disabled)) {
+            renames.emplace_back(current, disabled);
+        }
+    }
+    renameAll(renames);
+}
+
+// Returns whether the modpack's plugins are currently moved out of the load path
+bool Installer::isDisabled(const std::string &gameDirectory) {
+    return std::filesystem::exists(std::filesystem::path(gameDirectory + "\\BepInEx\\plugins" + DISABLED_SUFFIX));
+}
+
 // Uninstalls the modpack by removing the associated folders/files
-void Installer::uninstall(std::string &gameDirectory) {
+void Installer::uninstall(std::string &gameDirectory, const std::string &manifestPath) {
     // Check if game directory exists
     if (!std::filesystem::exists(std::filesystem::path(gameDirectory))) {
         throw GameNotFoundException();
     }
 
-    // Remove the BepInEx folder
-    std::filesystem::path bepinexDirectory(gameDirectory + "\\BepInEx");
-    std::filesystem::remove_all(bepinexDirectory);
+    // Without a manifest there is no record of what was installed, so remove the whole BepInEx folder
+    std::string trashDirectory = Trash::trashFor(gameDirectory + "\\BepInEx");
+    InstallManifest manifest;
+    if (manifestPath.empty() || !manifest.load(manifestPath)) {
+        Trash::remove(gameDirectory + "\\BepInEx", trashDirectory);
+        return;
+    }
+
+    // The modpack's folders (and their staged and previous copies) only hold installed files, so they go to the trash whole
+    std::string bepinexDirectory = gameDirectory + "\\BepInEx\\";
+    for (const char * folder : MODPACK_FOLDERS) {
+        Trash::remove(bepinexDirectory + folder, trashDirectory);
+        Trash::remove(bepinexDirectory + folder + STAGING_SUFFIX, trashDirectory);
+        Trash::remove(bepinexDirectory + folder + PREVIOUS_SUFFIX, trashDirectory);
+        Trash::remove(bepinexDirectory + folder + DISABLED_SUFFIX, trashDirectory);
+        manifest.forget(std::string("BepInEx\\") + folder);
+    }
+
+    // Then only the other files that were installed
+    std::size_t removed = manifest.removeFiles(gameDirectory);
+    qDebug() << "Removed" << removed << "installed files.";
+    std::filesystem::remove(manifestPath);
+}
+
+// Records the installed modpack folders in the manifest, replacing what was recorded for them before
+void Installer::recordModpack(const std::string &gameDirectory, const std::string &manifestPath, const std::string &release) {
+    InstallManifest manifest;
+    manifest.load(manifestPath);
+    std::size_t recorded = 0;
+    for (const char * folder : MODPACK_FOLDERS) {
+        std::string relativeFolder = std::string("BepInEx\\") + folder;
+        manifest.forget(relativeFolder);
+        recorded += manifest.recordTree(gameDirectory, relativeFolder, release);
+    }
+    if (manifest.save(manifestPath)) {
+        qDebug() << "Recorded" << recorded << "modpack files in the manifest.";
+    }
 }
 
 //=== SLOTS
+/* Installs the modpack from whichever source was given, staging it first when staged installs are on.
+ * In background mode the writing and copying run at low priority (see BackgroundMode).
+*/
+void Installer::installModpack() {
+    // Installing brings a disabled modpack back, rather than leaving a stale copy next to the new one
+    if (isDisabled(gameDirectory)) {
+        enable(gameDirectory);
+    }
+
+    std::string suffix = stagedInstall ? STAGING_SUFFIX : "";
+    if (stagedInstall) {
+        prepareStaging(gameDirectory);
+    }
+
+    // The install replaces the config folder, so this machine's edits are read first and merged back in after
+    std::string configDirectory = gameDirectory + "\\BepInEx\\config";
+    ConfigMerger configMerger;
+    BackgroundMode::run([&]() {
+        configMerger.capture(configDirectory);
+        if (memoryStage) {
+            installFromMemory(*memoryStage, gameDirectory, suffix);
+        } else if (!archivePath.empty()) {
+            installFromArchive(archivePath, gameDirectory, suffix);
+        } else {
+            install(filesDirectory, gameDirectory, suffix);
+        }
+
+        ConfigMergeResult merged = configMerger.apply(configDirectory + suffix);
+        qDebug() << "Merged config:" << merged.filesChecked << "files checked," << merged.filesMerged << "merged with local edits,"
+                 << merged.filesKept << "local files kept," << merged.conflicts << "conflicts (local kept)," << merged.failed << "failed in" << merged.seconds << "s";
+    });
+
+    if (stagedInstall) {
+        swapInStaging(gameDirectory);
+    }
+}
+
+/* Records the files a BepInEx install placed in the game directory. They are listed from the install's
+ * source, since the game's own files share the directory.
+*/
+void Installer::recordBepInEx() {
+    const std::string prefix = "BepInExPack/";
+    std::vector<std::string> files;
+    if (memoryStage) {
+        for (const StagedFile &file : memoryStage->getFiles()) {
+            if (file.name.compare(0, prefix.size(), prefix) == 0) {
+                files.push_back(file.name.substr(prefix.size()));
+            }
+        }
+    } else if (!archivePath.empty()) {
+        for (const std::string &name : ZipHandler::listFiles(archivePath)) {
+            if (name.compare(0, prefix.size(), prefix) == 0) {
+                files.push_back(name.substr(prefix.size()));
+            }
+        }
+    } else {
+        std::filesystem::path source(filesDirectory + "\\BepInExPack");
+        std::error_code error;
+        for (const auto &item : std::filesystem::recursive_directory_iterator(source, error)) {
+            if (item.is_regular_file(error)) {
+                files.push_back(item.path().lexically_relative(source).string());
+            }
+        }
+    }
+
+    InstallManifest manifest;
+    manifest.load(manifestPath);
+    std::size_t recorded = 0;
+    for (const std::string &file : files) {
+        recorded += manifest.record(gameDirectory, file, release) ? 1 : 0;
+    }
+    if (manifest.save(manifestPath)) {
+        qDebug() << "Recorded" << recorded << "BepInEx files in the manifest.";
+    }
+}
+
 void Installer::doInstall() {
-    install(filesDirectory, gameDirectory);
+    installModpack();
+    if (!manifestPath.empty()) {
+        recordModpack(gameDirectory, manifestPath, release);
+    }
     onInstallFinished();
 }
 
 void Installer::doInstallUpdate() {
     try {
-        install(filesDirectory, gameDirectory);
+        installModpack();
+        if (!manifestPath.empty()) {
+            recordModpack(gameDirectory, manifestPath, release);
+        }
         onInstallUpdateFinished();
+    } catch (std::exception &e) {
+        qDebug() << "Error installing update:" << e.what();
+        onInstallUpdateFailed();
     } catch (...) {
         onInstallUpdateFailed();
     }
 }
 void Installer::doInstallBepInEx() {
-    installBepInEx(filesDirectory, gameDirectory);
+    BackgroundMode::run([this]() {
+        if (memoryStage) {
+            installBepInExFromMemory(*memoryStage, gameDirectory);
+        } else if (!archivePath.empty()) {
+            installBepInExFromArchive(archivePath, gameDirectory);
+        } else {
+            installBepInEx(filesDirectory, gameDirectory);
+        }
+    });
+    if (!manifestPath.empty()) {
+        recordBepInEx();
+    }
     onInstallBepInExFinished();
 }
 void Installer::doUninstall() {
@@ -168,6 +587,31 @@ void Installer::onUninstallFinished() {
 }
 
 //=== GETTERS/SETTERS
+// Returns the bytes the files to be installed add up to, from whichever source was given
+std::uint64_t Installer::getInstallSize() const {
+    std::uint64_t size = 0;
+    if (memoryStage) {
+        return memoryStage->getUsed();
+    } else if (!archivePath.empty()) {
+        for (const ZipEntry &entry : ZipHandler::listEntries(archivePath)) {
+            size += entry.uncompressedSize;
+        }
+    } else {
+        std::error_code error;
+        for (const auto &item : std::filesystem::recursive_directory_iterator(filesDirectory, error)) {
+            if (item.is_regular_file(error)) {
+                size += item.file_size(error);
+            }
+        }
+    }
+    return size;
+}
+
+// Returns the suffix of the folders a staged install is built in (see prepareStaging)
+std::string Installer::getStagingSuffix() { return STAGING_SUFFIX; }
+
+std::string Installer::getDisabledSuffix() { return DISABLED_SUFFIX; }
+
 void Installer::setFilesDirectory(std::string directory) {
     filesDirectory = directory;
 }
@@ -175,3 +619,20 @@ void Installer::setFilesDirectory(std::string directory) {
 void Installer::setGameDirectory(std::string directory) {
     gameDirectory = directory;
 }
+
+void Installer::setArchivePath(std::string path) {
+    archivePath = path;
+}
+
+void Installer::setMemoryStage(std::shared_ptr<MemoryStage> stage) {
+    memoryStage = stage;
+}
+
+void Installer::setStagedInstall(bool enabled) {
+    stagedInstall = enabled;
+}
+
+void Installer::setManifest(std::string path, std::string release) {
+    this->manifestPath = path;
+    this->release = release;
+}
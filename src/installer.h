@@ -3,6 +3,9 @@
 
 #include <QObject>
 #include <string>
+#include <memory>
+#include <cstdint>
+#include "memorystage.h"
 
 class Installer : public QObject
 {
@@ -13,16 +16,35 @@ public:
     ~Installer();
 
     //=== FUNCTIONALITIES
-    static void install(std::string &filesDirectory, std::string &gameDirectory);
+    static void install(std::string &filesDirectory, std::string &gameDirectory, const std::string &folderSuffix = "");
     static void installBepInEx(std::string &filesDirectory, std::string &gameDirectory);
-    static void uninstall(std::string &gameDirectory);
+    static void installFromArchive(std::string &archivePath, std::string &gameDirectory, const std::string &folderSuffix = "");
+    static void installBepInExFromArchive(std::string &archivePath, std::string &gameDirectory);
+    static void installFromMemory(const MemoryStage &stage, std::string &gameDirectory, const std::string &folderSuffix = "");
+    static void installBepInExFromMemory(const MemoryStage &stage, std::string &gameDirectory);
+    static void uninstall(std::string &gameDirectory, const std::string &manifestPath = "");
+    static void recordModpack(const std::string &gameDirectory, const std::string &manifestPath, const std::string &release);
+    static void prepareStaging(const std::string &gameDirectory);
+    static void swapInStaging(const std::string &gameDirectory);
+    static void rollback(const std::string &gameDirectory);
+    static bool hasPreviousInstall(const std::string &gameDirectory);
+    static void discardPrevious(const std::string &gameDirectory);
+    static void enable(const std::string &gameDirectory);
+    static void disable(const std::string &gameDirectory);
+    static bool isDisabled(const std::string &gameDirectory);
 
     //=== GETTERS
-    int getInstallSize();
+    std::uint64_t getInstallSize() const;
+    static std::string getStagingSuffix();
+    static std::string getDisabledSuffix();
 
     //=== SETTERS
     void setFilesDirectory(std::string directory);
     void setGameDirectory(std::string directory);
+    void setArchivePath(std::string path);
+    void setMemoryStage(std::shared_ptr<MemoryStage> stage);
+    void setStagedInstall(bool enabled);
+    void setManifest(std::string path, std::string release);
 
 signals:
     void installFinished();
@@ -45,9 +67,16 @@ public slots:
     void onUninstallFinished();
 
 private:
-    int installSize;
+    void installModpack();
+    void recordBepInEx();
+
     std::string filesDirectory;
     std::string gameDirectory;
+    std::string archivePath;
+    std::shared_ptr<MemoryStage> memoryStage;
+    bool stagedInstall = false;
+    std::string manifestPath;
+    std::string release;
 };
 
 #endif // INSTALLER_H
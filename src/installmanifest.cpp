@@ -0,0 +1,211 @@
+#include "installmanifest.h"
+#include "sha256.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <set>
+
+// First line of a manifest file, so older or foreign files are rejected
+static const char * MANIFEST_HEADER = "MANIFEST 1";
+
+// Separator used in recorded paths ('\\' on Windows, as the rest of the installer builds them)
+static const char SEPARATOR = static_cast<char>(std::filesystem::path::preferred_separator);
+
+// Recorded paths always use the native separator, whether they came from an archive or a directory listing
+static std::string normalizePath(std::string path) {
+    for (char &c : path) {
+        if (c == '/' || c == '\\') {
+            c = SEPARATOR;
+        }
+    }
+    return path;
+}
+
+InstallManifest::InstallManifest() {}
+
+//=== FUNCTIONALITIES
+// Reads a manifest written by save(). Returns false (leaving the manifest empty) if it is missing or unreadable.
+bool InstallManifest::load(const std::string &path) {
+    entries.clear();
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line) || line != MANIFEST_HEADER) {
+        return false;
+    }
+
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string kind;
+        fields >> kind;
+        if (kind != "F") {
+            continue;
+        }
+        ManifestEntry entry;
+        fields >> entry.size >> entry.time >> entry.hash >> entry.release;
+        fields.get();
+        std::getline(fields, entry.path);
+        if (!entry.path.empty()) {
+            entries[entry.path] = entry;
+        }
+    }
+    return true;
+}
+
+// Writes the manifest to a temporary file, then swaps it in so a crash never leaves half a manifest
+bool InstallManifest::save(const std::string &path) const {
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::trunc);
+        if (!out) {
+            std::cerr << "Error writing manifest " << path << "\n";
+            return false;
+        }
+        out << MANIFEST_HEADER << "\n";
+        for (const auto &[name, entry] : entries) {
+            out << "F " << entry.size << " " << entry.time << " " << entry.hash << " " << entry.release << " " << name << "\n";
+        }
+        if (!out) {
+            std::cerr << "Error writing manifest " << path << "\n";
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        std::cerr << "Error writing manifest " << path << ": " << error.message() << "\n";
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
+
+// Records one installed file. Returns false if it can't be read, in which case it isn't recorded.
+bool InstallManifest::record(const std::string &rootDirectory, const std::string &relativePath, const std::string &release) {
+    std::string name = normalizePath(relativePath);
+    std::filesystem::path fullPath(rootDirectory + SEPARATOR + name);
+
+    std::error_code error;
+    ManifestEntry entry;
+    entry.path = name;
+    entry.release = release.empty() ? "unknown" : release;
+    entry.size = std::filesystem::file_size(fullPath, error);
+    if (error) {
+        return false;
+    }
+    entry.time = std::filesystem::last_write_time(fullPath, error).time_since_epoch().count();
+    if (error) {
+        return false;
+    }
+
+    // Unchanged since it was last recorded, so the hash still holds
+    auto existing = entries.find(name);
+    if (existing != entries.end() && existing->second.size == entry.size && existing->second.time == entry.time) {
+        entry.hash = existing->second.hash;
+    } else {
+        bool read = false;
+        entry.hash = Sha256::hashFile(fullPath.string(), read);
+        if (!read) {
+            return false;
+        }
+    }
+    entries[name] = entry;
+    return true;
+}
+
+// Records every file in a folder of the root directory. Returns the number of files recorded.
+std::size_t InstallManifest::recordTree(const std::string &rootDirectory, const std::string &relativeFolder, const std::string &release) {
+    std::filesystem::path folder(rootDirectory + SEPARATOR + normalizePath(relativeFolder));
+    std::error_code error;
+    if (!std::filesystem::is_directory(folder, error)) {
+        return 0;
+    }
+
+    std::size_t recorded = 0;
+    for (const auto &item : std::filesystem::recursive_directory_iterator(folder, error)) {
+        if (item.is_regular_file(error)) {
+            std::string relativePath = relativeFolder + SEPARATOR + item.path().lexically_relative(folder).string();
+            recorded += record(rootDirectory, relativePath, release) ? 1 : 0;
+        }
+    }
+    return recorded;
+}
+
+// Drops every entry inside a folder, before it is recorded again
+void InstallManifest::forget(const std::string &relativeFolder) {
+    std::string prefix = normalizePath(relativeFolder) + SEPARATOR;
+    auto it = entries.lower_bound(prefix);
+    while (it != entries.end() && it->first.compare(0, prefix.size(), prefix) == 0) {
+        it = entries.erase(it);
+    }
+}
+
+// Drops every entry whose file is no longer in the root directory. Returns the number dropped.
+std::size_t InstallManifest::prune(const std::string &rootDirectory) {
+    std::size_t dropped = 0;
+    for (auto it = entries.begin(); it != entries.end();) {
+        std::error_code error;
+        if (!std::filesystem::is_regular_file(std::filesystem::path(rootDirectory + SEPARATOR + it->first), error)) {
+            it = entries.erase(it);
+            ++dropped;
+        } else {
+            ++it;
+        }
+    }
+    return dropped;
+}
+
+/* Deletes every recorded file from the root directory, then any folders that leaves empty.
+ * Files the app didn't place are left alone. Returns the number of files deleted.
+*/
+std::size_t InstallManifest::removeFiles(const std::string &rootDirectory) const {
+    std::size_t removed = 0;
+    std::set<std::string> folders;
+    for (const auto &[name, entry] : entries) {
+        std::error_code error;
+        if (std::filesystem::remove(std::filesystem::path(rootDirectory + SEPARATOR + name), error)) {
+            ++removed;
+        }
+        for (std::size_t separator = name.find(SEPARATOR); separator != std::string::npos; separator = name.find(SEPARATOR, separator + 1)) {
+            folders.insert(name.substr(0, separator));
+        }
+    }
+
+    // Deepest first, so each folder is empty by the time it is removed (remove() fails harmlessly otherwise)
+    for (auto it = folders.rbegin(); it != folders.rend(); ++it) {
+        std::error_code error;
+        std::filesystem::remove(std::filesystem::path(rootDirectory + SEPARATOR + *it), error);
+    }
+    return removed;
+}
+
+//=== GETTERS
+std::vector<ManifestEntry> InstallManifest::getEntries() const {
+    std::vector<ManifestEntry> result;
+    result.reserve(entries.size());
+    for (const auto &[name, entry] : entries) {
+        result.push_back(entry);
+    }
+    return result;
+}
+
+bool InstallManifest::find(const std::string &relativePath, ManifestEntry &result) const {
+    auto it = entries.find(normalizePath(relativePath));
+    if (it == entries.end()) {
+        return false;
+    }
+    result = it->second;
+    return true;
+}
+
+std::size_t InstallManifest::size() const { return entries.size(); }
+
+// Returns the bytes taken by every recorded file
+std::uint64_t InstallManifest::totalSize() const {
+    std::uint64_t total = 0;
+    for (const auto &[name, entry] : entries) {
+        total += entry.size;
+    }
+    return total;
+}
@@ -0,0 +1,47 @@
+#ifndef INSTALLMANIFEST_H
+#define INSTALLMANIFEST_H
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+// A file the app placed in the game directory, with its path relative to it
+struct ManifestEntry
+{
+    std::string path;
+    std::uint64_t size = 0;
+    std::int64_t time = 0;
+    std::string hash;
+    std::string release;
+};
+
+/* The record of every file the app installed, kept in user_data. Each file is listed with its
+ * size, modification time, SHA-256 and the release it came from, so uninstalling, verifying and
+ * reporting disk usage don't have to crawl the game directory. Recording a file that still has
+ * the size and time already on record reuses its hash instead of reading it again.
+*/
+class InstallManifest
+{
+public:
+    InstallManifest();
+
+    //=== FUNCTIONALITIES
+    bool load(const std::string &path);
+    bool save(const std::string &path) const;
+    bool record(const std::string &rootDirectory, const std::string &relativePath, const std::string &release);
+    std::size_t recordTree(const std::string &rootDirectory, const std::string &relativeFolder, const std::string &release);
+    void forget(const std::string &relativeFolder);
+    std::size_t prune(const std::string &rootDirectory);
+    std::size_t removeFiles(const std::string &rootDirectory) const;
+
+    //=== GETTERS
+    std::vector<ManifestEntry> getEntries() const;
+    bool find(const std::string &relativePath, ManifestEntry &result) const;
+    std::size_t size() const;
+    std::uint64_t totalSize() const;
+
+private:
+    std::map<std::string, ManifestEntry> entries;
+};
+
+#endif // INSTALLMANIFEST_H
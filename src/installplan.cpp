@@ -0,0 +1,168 @@
+#include "installplan.h"
+#include "sha256.h"
+#include "copyengine.h"
+#include <filesystem>
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+// Size and modification time of a file in one of the trees
+struct FileState
+{
+    std::uint64_t size = 0;
+    std::filesystem::file_time_type time;
+};
+
+// Lists the files (by path relative to the root) and directories of a tree. A missing tree is empty.
+static void scanTree(const std::filesystem::path &root, std::unordered_map<std::string, FileState> &files, std::vector<std::string> &directories) {
+    std::error_code error;
+    if (!std::filesystem::is_directory(root, error)) {
+        return;
+    }
+    for (const auto &item : std::filesystem::recursive_directory_iterator(root, error)) {
+        std::string relativePath = item.path().lexically_relative(root).string();
+        if (item.is_directory(error)) {
+            directories.push_back(relativePath);
+        } else if (item.is_regular_file(error)) {
+            FileState state;
+            state.size = item.file_size(error);
+            state.time = item.last_write_time(error);
+            files[relativePath] = state;
+        }
+    }
+}
+
+InstallPlan::InstallPlan() {}
+
+//=== FUNCTIONALITIES
+/* Works out how to turn the installed tree into a copy of the staged one. When deleteExtra is false,
+ * installed files that aren't staged are left alone (for trees shared with other files, like the game folder).
+*/
+InstallPlan InstallPlan::compare(const std::string &sourceDirectory, const std::string &targetDirectory, bool deleteExtra) {
+    InstallPlan plan;
+    plan.sourceDirectory = sourceDirectory;
+    plan.targetDirectory = targetDirectory;
+
+    std::unordered_map<std::string, FileState> sourceFiles;
+    std::unordered_map<std::string, FileState> targetFiles;
+    std::vector<std::string> targetDirectories;
+    scanTree(sourceDirectory, sourceFiles, plan.directories);
+    scanTree(targetDirectory, targetFiles, targetDirectories);
+    std::sort(plan.directories.begin(), plan.directories.end());
+
+    for (const auto &[path, source] : sourceFiles) {
+        PlanItem item;
+        item.path = path;
+        item.size = source.size;
+
+        auto target = targetFiles.find(path);
+        if (target == targetFiles.end()) {
+            item.action = PlanAction::Add;
+        } else if (target->second.size != source.size) {
+            item.action = PlanAction::Replace;
+        } else if (target->second.time == source.time) {
+            item.action = PlanAction::Keep;
+        } else {
+            // Same size but a different time: only the contents can tell
+            bool sourceRead = false;
+            bool targetRead = false;
+            std::string sourceHash = Sha256::hashFile((std::filesystem::path(sourceDirectory) / path).string(), sourceRead);
+            std::string targetHash = Sha256::hashFile((std::filesystem::path(targetDirectory) / path).string(), targetRead);
+            item.action = (sourceRead && targetRead && sourceHash == targetHash) ? PlanAction::Touch : PlanAction::Replace;
+        }
+        plan.items.push_back(item);
+    }
+
+    if (deleteExtra) {
+        for (const auto &[path, target] : targetFiles) {
+            if (sourceFiles.count(path) == 0) {
+                plan.items.push_back({ PlanAction::Delete, path, target.size });
+            }
+        }
+        for (const std::string &path : targetDirectories) {
+            if (!std::binary_search(plan.directories.begin(), plan.directories.end(), path)) {
+                plan.extraDirectories.push_back(path);
+            }
+        }
+        // Deepest first, so each directory is empty by the time it is removed
+        std::sort(plan.extraDirectories.rbegin(), plan.extraDirectories.rend());
+    }
+
+    std::sort(plan.items.begin(), plan.items.end(), [](const PlanItem &a, const PlanItem &b) { return a.path < b.path; });
+    return plan;
+}
+
+/* Carries out the plan. Added and replaced files are copied in parallel by a CopyEngine; failures
+ * are counted rather than stopping the rest of the plan.
+*/
+PlanResult InstallPlan::apply() const {
+    PlanResult result;
+    std::filesystem::path source(sourceDirectory);
+    std::filesystem::path target(targetDirectory);
+
+    CopyEngine engine;
+    engine.addDirectory(target.string());
+    for (const std::string &path : directories) {
+        engine.addDirectory((target / path).string());
+    }
+    for (const PlanItem &item : items) {
+        if (item.action == PlanAction::Add || item.action == PlanAction::Replace) {
+            engine.addFile((source / item.path).string(), (target / item.path).string(), item.size);
+        }
+    }
+
+    CopyResult copied = engine.run();
+    result.filesWritten = copied.filesCopied;
+    result.bytesWritten = copied.bytesCopied;
+    result.filesCloned = copied.filesCloned;
+    result.filesLinked = copied.filesLinked;
+    result.failed = copied.errors.size();
+    for (const CopyError &copyError : copied.errors) {
+        std::cerr << "Error installing " << copyError.path << ": " << copyError.message << "\n";
+    }
+
+    for (const PlanItem &item : items) {
+        std::filesystem::path targetPath = target / item.path;
+        std::error_code error;
+        if (item.action == PlanAction::Touch) {
+            std::filesystem::last_write_time(targetPath, std::filesystem::last_write_time(source / item.path, error), error);
+        } else if (item.action == PlanAction::Delete && std::filesystem::remove(targetPath, error)) {
+            ++result.filesDeleted;
+        }
+        if (error) {
+            std::cerr << "Error installing " << targetPath.string() << ": " << error.message() << "\n";
+            ++result.failed;
+        }
+    }
+
+    std::error_code error;
+    for (const std::string &path : extraDirectories) {
+        std::filesystem::remove(target / path, error);
+    }
+    return result;
+}
+
+// Returns a one-line summary of the plan
+std::string InstallPlan::describe() const {
+    return std::to_string(count(PlanAction::Add)) + " to add, " + std::to_string(count(PlanAction::Replace)) + " to replace, "
+           + std::to_string(count(PlanAction::Delete)) + " to delete, " + std::to_string(count(PlanAction::Touch)) + " to retime, "
+           + std::to_string(count(PlanAction::Keep)) + " unchanged (" + std::to_string(bytesToWrite() / 1000000) + " MB to write)";
+}
+
+//=== GETTERS
+const std::vector<PlanItem> &InstallPlan::getItems() const { return items; }
+
+std::size_t InstallPlan::count(PlanAction action) const {
+    return static_cast<std::size_t>(std::count_if(items.begin(), items.end(), [action](const PlanItem &item) { return item.action == action; }));
+}
+
+// Returns the number of bytes applying the plan will copy
+std::uint64_t InstallPlan::bytesToWrite() const {
+    std::uint64_t total = 0;
+    for (const PlanItem &item : items) {
+        if (item.action == PlanAction::Add || item.action == PlanAction::Replace) {
+            total += item.size;
+        }
+    }
+    return total;
+}
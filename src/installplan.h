@@ -0,0 +1,64 @@
+#ifndef INSTALLPLAN_H
+#define INSTALLPLAN_H
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// What an install does to a single path
+enum class PlanAction
+{
+    Add,        // Missing from the installed tree
+    Replace,    // Installed, but its contents differ
+    Touch,      // Same contents with a different modification time; only the time is updated
+    Delete,     // Installed, but no longer part of the staged tree
+    Keep        // Already up to date
+};
+
+// A single step of an install plan, with the path relative to both trees
+struct PlanItem
+{
+    PlanAction action = PlanAction::Keep;
+    std::string path;
+    std::uint64_t size = 0;
+};
+
+// What applying a plan did
+struct PlanResult
+{
+    std::uint64_t filesWritten = 0;
+    std::uint64_t bytesWritten = 0;
+    std::uint64_t filesCloned = 0;
+    std::uint64_t filesLinked = 0;
+    std::uint64_t filesDeleted = 0;
+    std::uint64_t failed = 0;
+};
+
+/* The difference between a staged tree and an installed one. Files are compared by size and
+ * modification time first, and by SHA-256 when only the time differs, so applying the plan only
+ * writes what actually changed. Installed files get the staged file's time, so the next comparison
+ * of an unchanged file never has to read it.
+*/
+class InstallPlan
+{
+public:
+    InstallPlan();
+
+    //=== FUNCTIONALITIES
+    static InstallPlan compare(const std::string &sourceDirectory, const std::string &targetDirectory, bool deleteExtra = true);
+    PlanResult apply() const;
+    std::string describe() const;
+
+    //=== GETTERS
+    const std::vector<PlanItem> &getItems() const;
+    std::size_t count(PlanAction action) const;
+    std::uint64_t bytesToWrite() const;
+
+private:
+    std::string sourceDirectory;
+    std::string targetDirectory;
+    std::vector<std::string> directories;
+    std::vector<std::string> extraDirectories;
+    std::vector<PlanItem> items;
+};
+
+#endif // INSTALLPLAN_H
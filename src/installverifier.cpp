@@ -0,0 +1,119 @@
+#include "installverifier.h"
+#include "ziphandler.h"
+#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+// Number of files checked at once
+static unsigned workerCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+InstallVerifier::InstallVerifier() {}
+
+//=== FUNCTIONALITIES
+/* Checks every plugin, patcher and config file of the release against what is installed in the game
+ * directory. Returns false if the archive couldn't be read.
+*/
+bool InstallVerifier::verify(const std::string &archivePath, const std::string &gameDirectory, const InstallManifest &manifest, VerifyResult &result) {
+    const auto startTime = std::chrono::steady_clock::now();
+    result = VerifyResult();
+
+    std::vector<ZipEntry> entries = ZipHandler::listEntries(archivePath);
+    if (entries.empty()) {
+        return false;
+    }
+
+    // The same destinations the installer writes to
+    std::string root = ZipHandler::findRootFolder(archivePath);
+    std::string bepinexDirectory = gameDirectory + "\\BepInEx";
+    std::vector<PathMapping> mappings = {
+        { root + "plugins/", bepinexDirectory + "\\plugins" },
+        { root + "patchers/", bepinexDirectory + "\\patchers" },
+        { root + "config/", bepinexDirectory + "\\config" },
+    };
+    const std::string configPrefix = root + "config/";
+
+    std::atomic<std::size_t> nextEntry(0);
+    std::atomic<std::uint64_t> filesChecked(0);
+    std::atomic<std::uint64_t> filesHashed(0);
+    std::mutex problemsMutex;
+    auto work = [&]() {
+        for (std::size_t i = nextEntry++; i < entries.size(); i = nextEntry++) {
+            const ZipEntry &entry = entries[i];
+            std::string fullPath;
+            if (entry.name.empty() || entry.name.back() == '/' || !ZipHandler::mapEntryPath(entry.name, mappings, fullPath)) {
+                continue;
+            }
+            ++filesChecked;
+
+            std::error_code error;
+            std::uint64_t size = std::filesystem::file_size(fullPath, error);
+            bool missing = static_cast<bool>(error);
+            bool damaged = false;
+            if (!missing && entry.name.compare(0, configPrefix.size(), configPrefix) != 0) {
+                if (size != entry.uncompressedSize) {
+                    damaged = true;
+                } else {
+                    // Trust a file that is still exactly as the manifest recorded it
+                    ManifestEntry recorded;
+                    bool trusted = manifest.find("BepInEx/" + entry.name.substr(root.size()), recorded) && recorded.size == size
+                                   && recorded.time == std::filesystem::last_write_time(fullPath, error).time_since_epoch().count() && !error;
+                    if (!trusted) {
+                        ++filesHashed;
+                        bool read = false;
+                        damaged = ZipHandler::fileCrc(fullPath, read) != entry.crc || !read;
+                    }
+                }
+            }
+
+            if (missing || damaged) {
+                std::lock_guard<std::mutex> lock(problemsMutex);
+                result.problems.push_back({ entry.name, fullPath, missing });
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < workerCount(); ++i) {
+        workers.emplace_back(work);
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    std::sort(result.problems.begin(), result.problems.end(), [](const VerifyProblem &a, const VerifyProblem &b) { return a.entry < b.entry; });
+    result.filesChecked = filesChecked;
+    result.filesHashed = filesHashed;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return true;
+}
+
+// Re-extracts only the files a verification found missing or damaged. Returns false if any couldn't be written.
+bool InstallVerifier::repair(const std::string &archivePath, VerifyResult &result) {
+    if (result.problems.empty()) {
+        return true;
+    }
+
+    // One single-file mapping per problem, so nothing else in the archive is touched
+    std::vector<PathMapping> mappings;
+    for (const VerifyProblem &problem : result.problems) {
+        mappings.push_back({ problem.entry, problem.path });
+    }
+
+    ExtractStats stats;
+    int status = ZipHandler::extractMapped(archivePath, mappings, &stats);
+    result.filesRepaired = stats.files;
+    return status == 0 && stats.failed == 0 && stats.files == result.problems.size();
+}
+
+// Returns a one-line summary of a verification
+std::string InstallVerifier::describe(const VerifyResult &result) {
+    std::size_t missing = static_cast<std::size_t>(std::count_if(result.problems.begin(), result.problems.end(), [](const VerifyProblem &problem) { return problem.missing; }));
+    return std::to_string(result.filesChecked) + " files checked (" + std::to_string(result.filesHashed) + " by CRC), "
+           + std::to_string(missing) + " missing, " + std::to_string(result.problems.size() - missing) + " damaged, "
+           + std::to_string(result.filesRepaired) + " repaired in " + std::to_string(result.seconds) + " s";
+}
@@ -0,0 +1,43 @@
+#ifndef INSTALLVERIFIER_H
+#define INSTALLVERIFIER_H
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "installmanifest.h"
+
+// A modpack file whose installed copy is missing or damaged
+struct VerifyProblem
+{
+    std::string entry;      // Name in the release archive
+    std::string path;       // Where it is installed
+    bool missing = false;
+};
+
+// What a verification found
+struct VerifyResult
+{
+    std::uint64_t filesChecked = 0;
+    std::uint64_t filesHashed = 0;
+    std::uint64_t filesRepaired = 0;
+    std::vector<VerifyProblem> problems;
+    double seconds = 0.0;
+};
+
+/* Checks the installed modpack against the release archive's entries. Files are checked in
+ * parallel; one whose size matches and whose modification time is the one recorded in the
+ * manifest is trusted, and only the rest have their CRC32 compared with the archive's. Config
+ * files are only checked for being there, since BepInEx rewrites them as the game runs.
+ * Repairing re-extracts just the files found missing or damaged.
+*/
+class InstallVerifier
+{
+public:
+    InstallVerifier();
+
+    //=== FUNCTIONALITIES
+    static bool verify(const std::string &archivePath, const std::string &gameDirectory, const InstallManifest &manifest, VerifyResult &result);
+    static bool repair(const std::string &archivePath, VerifyResult &result);
+    static std::string describe(const VerifyResult &result);
+};
+
+#endif // INSTALLVERIFIER_H
@@ -0,0 +1,58 @@
+#include "iobackend.h"
+#include "uringiobackend.h"
+#include "ziphandler.h"
+#include <atomic>
+#include <cstdio>
+
+// Engine used by backends created from now on (falls back to Sync where it isn't available)
+static std::atomic<IoEngine> currentEngine(IoEngine::Sync);
+
+IoBackend::~IoBackend() {}
+
+//=== FUNCTIONALITIES
+// Creates a backend for the current engine, or a synchronous one if that engine can't be used here
+std::unique_ptr<IoBackend> IoBackend::create() {
+#ifdef MODPACK_IO_URING
+    if (currentEngine == IoEngine::Uring) {
+        std::unique_ptr<UringIoBackend> backend(new UringIoBackend());
+        if (backend->isOpen()) {
+            return backend;
+        }
+    }
+#endif
+    return std::unique_ptr<IoBackend>(new SyncIoBackend());
+}
+
+//=== ENGINE
+void IoBackend::setEngine(IoEngine engine) { currentEngine = engine; }
+
+IoEngine IoBackend::getEngine() { return currentEngine; }
+
+// Returns whether an engine works in this build on this machine (io_uring needs Linux 5.15 or newer)
+bool IoBackend::isAvailable(IoEngine engine) {
+    if (engine == IoEngine::Sync) {
+        return true;
+    }
+#ifdef MODPACK_IO_URING
+    return UringIoBackend().isOpen();
+#else
+    return false;
+#endif
+}
+
+//=== SYNC BACKEND
+SyncIoBackend::SyncIoBackend() {}
+
+void SyncIoBackend::write(const std::string &path, const char * data, std::size_t size, Completion done) {
+    std::FILE * output = ZipHandler::createFile(path);
+    bool ok = output != nullptr && (size == 0 || std::fwrite(data, 1, size, output) == size);
+    if (output != nullptr && std::fclose(output) != 0) {
+        ok = false;
+    }
+    if (done) {
+        done(ok);
+    }
+}
+
+// Nothing is ever held back
+void SyncIoBackend::finish() {}
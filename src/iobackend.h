@@ -0,0 +1,50 @@
+#ifndef IOBACKEND_H
+#define IOBACKEND_H
+#include <string>
+#include <memory>
+#include <functional>
+#include <cstddef>
+
+// The way whole files are written out during extraction and install
+enum class IoEngine
+{
+    Sync,       // One unlink/open/write/close after another, through the C runtime
+    Uring       // Batched through io_uring, many files per system call (Linux only)
+};
+
+/* Writes files whose contents are already in memory. A backend may hold writes back and issue
+ * them in batches, so contents passed to write() must stay valid until finish() returns, and a
+ * file's completion may run during a later write() or during finish(). Completions always run on
+ * the calling thread. Parent folders must already exist. Like ZipHandler::createFile, whatever was
+ * at a path is unlinked first, so a hardlinked file is never rewritten in place.
+*/
+class IoBackend
+{
+public:
+    using Completion = std::function<void(bool ok)>;
+
+    virtual ~IoBackend();
+
+    //=== FUNCTIONALITIES
+    virtual void write(const std::string &path, const char * data, std::size_t size, Completion done = nullptr) = 0;
+    virtual void finish() = 0;
+    static std::unique_ptr<IoBackend> create();
+
+    //=== ENGINE
+    static void setEngine(IoEngine engine);
+    static IoEngine getEngine();
+    static bool isAvailable(IoEngine engine);
+};
+
+// Writes every file immediately, one after another
+class SyncIoBackend : public IoBackend
+{
+public:
+    SyncIoBackend();
+
+    //=== FUNCTIONALITIES
+    void write(const std::string &path, const char * data, std::size_t size, Completion done = nullptr) override;
+    void finish() override;
+};
+
+#endif // IOBACKEND_H
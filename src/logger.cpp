@@ -1,6 +1,7 @@
 #include "logger.h"
 #include <filesystem>
 #include <iostream>
+#include <mutex>
 #include <time.h>
 #include <qDebug>
 
@@ -93,10 +94,15 @@ void Logger::log(std::string message, bool includeTime) {
     file.close();
 }
 
+// Serializes logging from pipeline tasks running at the same time, so their lines don't interleave
+static std::mutex logMutex;
+
 // Logs a message to the end of a given file (from filepath). Will never throw an exception.
 void Logger::log(std::string message, std::string path, bool includeTime) {
     if (path != "") {
         try {
+            std::lock_guard<std::mutex> lock(logMutex);
+
             // Open the text file
             std::ofstream file;
             file.open(path, std::ios_base::app);
@@ -1,6 +1,12 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
 #include "appexceptions.h"
+#include "ziphandler.h"
+#include "filecopier.h"
+#include "copyengine.h"
+#include "iobackend.h"
+#include "backgroundmode.h"
+#include "trash.h"
 #include <QFileDialog>
 #include <QCoreApplication>
 #include <QDir>
@@ -10,6 +16,8 @@
 #include <QDesktopServices>
 #include <QScrollBar>
 #include <QProcess>
+#include <QInputDialog>
+#include <algorithm>
 
 /* When given a stylesheet string and a .var file path, replaces
  * all the variables found in the stylesheet string.
@@ -152,6 +160,12 @@ MainWindow::MainWindow(QWidget *parent)
     // Read user data
     load();
 
+    // Finish deleting anything the last run left in the trash
+    Trash::emptyInBackground(Trash::trashFor(QDir::currentPath().toStdString() + "\\cache"));
+    if (!gameDirectory.empty()) {
+        Trash::emptyInBackground(Trash::trashFor(gameDirectory + "\\BepInEx"));
+    }
+
     // Initialize Widgets
     initialize_welcome();
     ui->stack_installation->setCurrentIndex(0);
@@ -223,6 +237,12 @@ void MainWindow::initialize_connections() {
     connect(ui->btn_managerGithub, &QPushButton::clicked, this, &MainWindow::clicked_managerGithub);
     connect(ui->btn_clearCache, &QPushButton::clicked, this, &MainWindow::clicked_clearCache);
     connect(ui->btn_uninstall, &QPushButton::clicked, this, &MainWindow::clicked_uninstall);
+    connect(ui->btn_verify, &QPushButton::clicked, this, &MainWindow::clicked_verify);
+    connect(ui->btn_toggle, &QPushButton::clicked, this, &MainWindow::clicked_toggle);
+    connect(ui->combo_profile, &QComboBox::textActivated, this, &MainWindow::selected_profile);
+    connect(ui->btn_removeProfile, &QPushButton::clicked, this, &MainWindow::clicked_removeProfile);
+    connect(ui->btn_restoreRelease, &QPushButton::clicked, this, &MainWindow::clicked_restoreRelease);
+    connect(ui->btn_rollback, &QPushButton::clicked, this, &MainWindow::clicked_rollback);
     connect(ui->btn_open, &QPushButton::clicked, this, &MainWindow::clicked_openGameLocation);
     connect(ui->btn_openAppLocation, &QPushButton::clicked, this, &MainWindow::clicked_openAppLocation);
     connect(ui->btn_log, &QPushButton::clicked, this, &MainWindow::clicked_openLog);
@@ -253,6 +273,17 @@ void MainWindow::initialize_connections() {
     connect(&manager, &Manager::updateInstalled, this, &MainWindow::onUpdateInstalled);
     connect(&manager, &Manager::updateFailed, this, &MainWindow::onUpdateFailed);
     connect (&manager, &Manager::fetched, this, &MainWindow::update_home);
+    connect(&manager, &Manager::errorOccurred, this, &MainWindow::onInstallationError);
+    connect(&manager, &Manager::stagesChanged, this, &MainWindow::onStagesChanged);
+
+    //=== Home page signals/slots
+    logger->log("Connecting verification, inventory, profile, release and rollback signals and slots...");
+    connect(&manager, &Manager::installVerified, this, &MainWindow::onInstallVerified);
+    connect(&manager, &Manager::pluginsScanned, this, &MainWindow::onPluginsScanned);
+    connect(&manager, &Manager::profileSwitched, this, &MainWindow::onProfileSwitched);
+    connect(&manager, &Manager::profileRemoved, this, &MainWindow::onProfileRemoved);
+    connect(&manager, &Manager::releaseRestored, this, &MainWindow::onReleaseRestored);
+    connect(&manager, &Manager::installRolledBack, this, &MainWindow::onInstallRolledBack);
 }
 
 // Saves the user data
@@ -264,9 +295,11 @@ void MainWindow::save() {
         dataHandler.setValue("pageCompleted", QVariant(pageCompleted));
         dataHandler.setValue("modpackInstalled", QVariant(modpackInstalled));
         dataHandler.setValue("firstOpen", QVariant(firstOpen));
+        dataHandler.setValue("directInstall", QVariant(directInstall));
         dataHandler.setValue("releaseUrl", QVariant(releaseUrl.c_str()));
         dataHandler.setValue("githubUrl", QVariant(githubUrl.c_str()));
         dataHandler.setValue("gameDirectory", QVariant(gameDirectory.c_str()));
+        dataHandler.setValue("profile", QVariant(manager.getProfile().c_str()));
 
         // Save with data handler
         dataHandler.save();
@@ -284,12 +317,48 @@ void MainWindow::load() {
         pageCompleted       = dataHandler.getValue("pageCompleted", true).toBool();
         modpackInstalled    = dataHandler.getValue("modpackInstalled", false).toBool();
         firstOpen           = dataHandler.getValue("firstOpen", true).toBool();
+        directInstall       = dataHandler.getValue("directInstall", false).toBool();
         releaseUrl      = dataHandler.getValue("releaseUrl", "").toString().toStdString();
         githubUrl       = dataHandler.getValue("githubUrl", "").toString().toStdString();
         gameDirectory       = dataHandler.getValue("gameDirectory", "").toString().toStdString();
     } catch (...) {
         logger->log("ERROR: Failed to reset user data");
     }
+    manager.setGameDirectory(gameDirectory);
+    manager.setDirectInstall(directInstall);
+    manager.setRepackCache(dataHandler.getValue("repackCache", false).toBool());
+
+    // Archives up to this many bytes extracted are staged in memory instead of on disk (0 turns it off)
+    manager.setMemoryStageBudget(dataHandler.getValue("memoryStageBudget", 256ll * 1024 * 1024).toLongLong());
+
+    // Keep deduplicated copies of the newest releases in the cache's chunk store
+    manager.setChunkStore(dataHandler.getValue("chunkStore", false).toBool());
+    manager.setRetainedReleases(dataHandler.getValue("retainedReleases", 3).toInt());
+
+    // Build installs next to the live folders and swap them in, keeping the old ones for rollback
+    manager.setStagedInstall(dataHandler.getValue("stagedInstall", false).toBool());
+
+    // Pick the extraction engine ("mapped" or "libzip")
+    std::string engine = dataHandler.getValue("extractEngine", "mapped").toString().toStdString();
+    ZipHandler::setEngine(engine == "libzip" ? ExtractEngine::Libzip : ExtractEngine::Mapped);
+    ZipHandler::setIncremental(dataHandler.getValue("incrementalExtract", true).toBool());
+
+    // Write extracted and installed files one by one ("sync"), or batched through io_uring on Linux ("uring")
+    std::string ioEngine = dataHandler.getValue("ioEngine", "sync").toString().toStdString();
+    IoBackend::setEngine(ioEngine == "uring" ? IoEngine::Uring : IoEngine::Sync);
+
+    // Install by cloning files, or hardlinking plugin DLLs, when the filesystem allows it
+    FileCopier::setCloning(dataHandler.getValue("cloneFiles", true).toBool());
+    FileCopier::setHardlinking(dataHandler.getValue("hardlinkPlugins", true).toBool());
+    CopyEngine::setDefaultThreads(dataHandler.getValue("copyThreads", 0).toUInt());
+
+    // Low-impact mode for busy machines: lowered priority, fewer workers and writes paced to a budget (0 MB/s is unpaced)
+    BackgroundMode::setEnabled(dataHandler.getValue("backgroundMode", false).toBool());
+    BackgroundMode::setMaxWorkers(dataHandler.getValue("backgroundWorkers", 2).toUInt());
+    BackgroundMode::setBytesPerSecond(dataHandler.getValue("backgroundMegabytesPerSecond", 20).toULongLong() << 20);
+
+    // The active profile picks which modpack repository releases come from
+    manager.setProfile(dataHandler.getValue("profile", "default").toString().toStdString());
 }
 
 // Resets the user data and sets them back to their default values
@@ -299,6 +368,7 @@ void MainWindow::reset() {
         pageCompleted = true;
         modpackInstalled = false;
         firstOpen = true;
+        directInstall = false;
         releaseUrl = "https://api.github.com/repos/m-riley04/TheWolfPack/releases/latest";
         githubUrl = "https://github.com/m-riley04/TheWolfPack";
         gameDirectory = "";
@@ -315,7 +385,7 @@ void MainWindow::clearCache() {
     std::string cacheDirectory = QDir::currentPath().toStdString() + "\\cache";
 
     if (std::filesystem::exists(QDir::currentPath().toStdString()) && std::filesystem::exists(cacheDirectory)) {
-        std::filesystem::remove_all(cacheDirectory);
+        Trash::remove(cacheDirectory, Trash::trashFor(cacheDirectory));
         std::filesystem::create_directory(cacheDirectory);
         logger->log("App cache has been cleared.");
         QMessageBox::information(this, "Cache cleared.", "The application's cache has been removed from the system.");
@@ -329,7 +399,7 @@ void MainWindow::clearCache() {
 void MainWindow::uninstall() {
     logger->log("Preparing to uninstall...");
     try {
-        Installer::uninstall(gameDirectory);
+        Installer::uninstall(gameDirectory, manager.getManifestPath());
         clearCache();
     } catch (GameNotFoundException) {
         logger->log("ERROR: Uninstallation failed because game installation was not found.");
@@ -377,18 +447,6 @@ void MainWindow::initialize_configuration() {
         // Log it
         logger->log("Game installation found.");
 
-        // Check game storage
-        logger->log("Checking game disk storage...");
-        std::string currentRoot = QDir(gameDirectory.c_str()).rootPath().toStdString();
-        const double spaceCurrent = manager.getAvailableStorage(currentRoot)/1000000000.00000;
-        ui->label_spaceAvailableGame->setText(QString(std::to_string(spaceCurrent).c_str()));
-        if (!manager.hasEnoughStorage(currentRoot, 1000000000)) {
-            ui->label_spaceAvailableGame->setStyleSheet("color: red");
-            QString warningMessage = "WARNING: Not enough storage on game location disk (" + QString(currentRoot.c_str()) + "). You MUST have at least 1 gigabyte of free space.";
-            QMessageBox::warning(this, "Not enough storage.", warningMessage, QMessageBox::Ok);
-        } else {
-            ui->label_spaceAvailableGame->setStyleSheet("color: white");
-        }
     } catch (GameNotFoundException e) {
         ui->label_found->setText(QString("No"));
         logger->log("Game installation NOT found.");
@@ -409,15 +467,41 @@ void MainWindow::initialize_configuration() {
         logger->log("BepInEx installation NOT found.");
     }
 
+    // The disks are checked once the space the install needs has been planned, off the GUI thread
+    logger->log("Planning the space the installation needs...");
+    connect(&manager, &Manager::storagePlanned, this, &MainWindow::onConfigurationStoragePlanned, Qt::UniqueConnection);
+    manager.doPlanStorage(false);
+
+    logger->log("Installer 'Configration' page initialized.");
+    logger->log("Awaiting configuration...");
+}
+
+// Checks the space on the game's disk against a planned install
+void MainWindow::check_gameStorage(const SpacePlan &plan) {
+    std::string currentRoot = QDir(gameDirectory.c_str()).rootPath().toStdString();
+    const double spaceCurrent = manager.getAvailableStorage(currentRoot)/1000000000.00000;
+    const qint64 spaceRequired = manager.getRequiredStorage(currentRoot, plan);
+    ui->label_spaceAvailableGame->setText(QString(std::to_string(spaceCurrent).c_str()));
+    if (!manager.hasEnoughStorage(currentRoot, spaceRequired)) {
+        ui->label_spaceAvailableGame->setStyleSheet("color: red");
+        QString warningMessage = "WARNING: Not enough storage on game location disk (" + QString(currentRoot.c_str()) + "). You MUST have at least " + QString::number(spaceRequired / 1000000) + " megabytes of free space.";
+        QMessageBox::warning(this, "Not enough storage.", warningMessage, QMessageBox::Ok);
+    }
+    ui->label_spaceAvailableGame->setStyleSheet("color: white");
+}
+
+// Checks the space on the manager's disk against a planned install, until there is enough or the user cancels
+void MainWindow::check_managerStorage(const SpacePlan &plan) {
     logger->log("Checking manager disk storage...");
     std::string currentRoot = QDir::rootPath().toStdString();
     const double spaceCurrent = manager.getAvailableStorage(currentRoot)/1000000000.00000;
+    const qint64 spaceRequired = manager.getRequiredStorage(currentRoot, plan);
     ui->label_spaceAvailableCurrent->setText(QString(std::to_string(spaceCurrent).c_str()));
-    if (!manager.hasEnoughStorage(currentRoot, 1000000000)) {
+    if (!manager.hasEnoughStorage(currentRoot, spaceRequired)) {
         ui->label_spaceAvailableCurrent->setStyleSheet("color: red");
         // Tell the user they do not have enough storage until they have enough storage
-        QString warningMessage = "WARNING: Not enough storage on current working disk (" + QString(currentRoot.c_str()) + "). You MUST have at least 1 gigabyte of free space.";
-        while (!manager.hasEnoughStorage(currentRoot, 1000000000)) {
+        QString warningMessage = "WARNING: Not enough storage on current working disk (" + QString(currentRoot.c_str()) + "). You MUST have at least " + QString::number(spaceRequired / 1000000) + " megabytes of free space.";
+        while (!manager.hasEnoughStorage(currentRoot, spaceRequired)) {
             QMessageBox::StandardButton reply = QMessageBox::warning(this, "Not enough storage.", warningMessage, QMessageBox::Retry | QMessageBox::Cancel);
             if (reply == QMessageBox::StandardButton::Cancel) {
                 initialize_cancel();
@@ -427,9 +511,6 @@ void MainWindow::initialize_configuration() {
         }
     }
     ui->label_spaceAvailableCurrent->setStyleSheet("color: white");
-
-    logger->log("Installer 'Configration' page initialized.");
-    logger->log("Awaiting configuration...");
 }
 
 void MainWindow::initialize_working() {
@@ -439,15 +520,27 @@ void MainWindow::initialize_working() {
     ui->btn_next->setEnabled(pageCompleted);
     ui->btn_back->setEnabled(false);
 
-    // Check storage again
+    // Plan the space again; the installation starts once it is known there is enough
+    logger->log("Re-planning the space the installation needs...");
+    connect(&manager, &Manager::storagePlanned, this, &MainWindow::onInstallStoragePlanned, Qt::UniqueConnection);
+    manager.doPlanStorage(false);
+}
+
+// Re-checks both disks against the fresh plan, then starts the installation
+void MainWindow::onInstallStoragePlanned(bool update, SpacePlan plan) {
+    if (update) {
+        return;
+    }
+    disconnect(&manager, &Manager::storagePlanned, this, &MainWindow::onInstallStoragePlanned);
+
     logger->log("Re-checking manager disk storage...");
-    if (!manager.hasEnoughStorage(QDir::currentPath().toStdString(), 1000000000.00000)) {
+    if (!manager.hasEnoughStorage(QDir::currentPath().toStdString(), manager.getRequiredStorage(QDir::currentPath().toStdString(), plan))) {
         initialize_error();
         navigate(ui->stack_installation, ui->page_error);
         return;
     }
     logger->log("Re-checking game drive storage...");
-    if (!manager.hasEnoughStorage(gameDirectory, 1000000000)) {
+    if (!manager.hasEnoughStorage(gameDirectory, manager.getRequiredStorage(gameDirectory, plan))) {
         initialize_error();
         navigate(ui->stack_installation, ui->page_error);
         return;
@@ -462,18 +555,10 @@ void MainWindow::initialize_working() {
     connect(&manager, &Manager::modpackInstalled, timer, &QTimer::deleteLater);
     timer->start(1000);
 
-    // Check if BepInEx is insalled
-    if (!manager.isBepInExInstalled()) {
-        // Download BepInEx
-        ui->label_progress->setText("Downloading BepInEx...");
-        logger->log("Preparing to download BepInEx...");
-        manager.doDownloadBepInEx();
-    } else {
-        // Download modpack
-        ui->label_progress->setText("Fetching modpack...");
-        logger->log("Preparing to fetch the modpack...");
-        manager.doFetchModpack();
-    }
+    // Install BepInEx too if it isn't installed. The manager runs every stage off the GUI thread; this page only follows along.
+    bool withBepInEx = !manager.isBepInExInstalled();
+    logger->log(withBepInEx ? "Preparing to install BepInEx and the modpack..." : "Preparing to install the modpack...");
+    manager.doInstallModpack(withBepInEx);
 }
 
 void MainWindow::initialize_done() {
@@ -515,6 +600,26 @@ void MainWindow::initialize_home() {
 
     // Set the game folder ui box
     ui->line_lethalCompanyLocationSettings->setText(QString(gameDirectory.c_str()));
+    ui->btn_toggle->setText(manager.isEnabled() ? "Disable" : "Enable");
+
+    // List the profiles, with the active one selected
+    ui->combo_profile->clear();
+    for (const Profile &profile : manager.getProfiles()) {
+        ui->combo_profile->addItem(QString(profile.name.c_str()));
+    }
+    ui->combo_profile->setCurrentText(QString(manager.getProfile().c_str()));
+    ui->btn_removeProfile->setEnabled(ui->combo_profile->count() > 1);
+
+    // List the releases kept in the chunk store, which can be restored
+    ui->combo_release->clear();
+    for (const std::string &release : manager.getStoredReleases()) {
+        ui->combo_release->addItem(QString(release.c_str()));
+    }
+    ui->combo_release->setEnabled(ui->combo_release->count() > 0);
+    ui->btn_restoreRelease->setEnabled(ui->combo_release->count() > 0);
+
+    // Only staged installs keep the install they replaced to roll back to
+    ui->btn_rollback->setEnabled(manager.hasPreviousInstall());
 
     // Initialize installed release local variables
     QJsonObject installation = manager.getInstallationRelease();
@@ -524,6 +629,7 @@ void MainWindow::initialize_home() {
         ui->text_changelog->setMarkdown(installedChangelog);
         ui->label_version->setText(installedVersion);
     }
+    update_inventory();
 
     // Fetch the data
     manager.doFetch();
@@ -589,6 +695,26 @@ void MainWindow::update_home() {
     }
 }
 
+// Takes an inventory of the plugins folder off the GUI thread; onPluginsScanned shows it
+void MainWindow::update_inventory() {
+    manager.doScanPlugins();
+}
+
+// Shows what is actually in the plugins folder, with every DLL listed in the tooltip
+void MainWindow::onPluginsScanned() {
+    const PluginInventory &inventory = manager.getInventory();
+    QString list;
+    for (const PluginRecord &record : inventory.getRecords()) {
+        QString line = QString::fromStdString(record.managed ? record.assemblyName + " " + record.assemblyVersion : record.path + " (native)");
+        for (const PluginDeclaration &plugin : record.plugins) {
+            line += QString::fromStdString("\n    " + plugin.guid + " " + plugin.version);
+        }
+        list += (list.isEmpty() ? "" : "\n") + line;
+    }
+    ui->label_plugins->setText(QString("Plugins: %1 DLLs, %2 BepInEx plugins").arg(inventory.getRecords().size()).arg(inventory.countPlugins()));
+    ui->label_plugins->setToolTip(list);
+}
+
 //===== WIDGET COMMANDS
 void MainWindow::clicked_next() {
     int currentIndex = ui->stack_installation->currentIndex();
@@ -683,17 +809,10 @@ void MainWindow::clicked_browse() {
         ui->line_lethalCompanyLocation->setText(QString(path.c_str()));
         ui->line_lethalCompanyLocation->setStyleSheet("border: 1px solid green");
 
-        // Check game storage
+        // Check game storage once the space the install needs has been planned
         logger->log("Checking game disk storage...");
-        std::string currentRoot = QDir(gameDirectory.c_str()).rootPath().toStdString();
-        const double spaceCurrent = manager.getAvailableStorage(currentRoot)/1000000000.00000;
-        ui->label_spaceAvailableGame->setText(QString(std::to_string(spaceCurrent).c_str()));
-        if (!manager.hasEnoughStorage(currentRoot, 1000000000)) {
-            ui->label_spaceAvailableGame->setStyleSheet("color: red");
-            QString warningMessage = "WARNING: Not enough storage on game location disk (" + QString(currentRoot.c_str()) + "). You MUST have at least 1 gigabyte of free space.";
-            QMessageBox::warning(this, "Not enough storage.", warningMessage, QMessageBox::Ok);
-        }
-        ui->label_spaceAvailableGame->setStyleSheet("color: white");
+        connect(&manager, &Manager::storagePlanned, this, &MainWindow::onGameStoragePlanned, Qt::UniqueConnection);
+        manager.doPlanStorage(false);
         return;
     }
     logger->log("Path does not exist. User cannot continue.");
@@ -816,6 +935,187 @@ void MainWindow::clicked_uninstall() {
     }
 }
 
+void MainWindow::clicked_verify() {
+    logger->log("User has chosen to verify the installation.");
+    ui->btn_verify->setDisabled(true);
+    ui->btn_verify->setText("Verifying...");
+    manager.doVerifyInstall(true);
+}
+
+void MainWindow::onInstallVerified(bool intact) {
+    ui->btn_verify->setText("Verify");
+    ui->btn_verify->setEnabled(true);
+
+    if (intact) {
+        QMessageBox::information(this, "Installation verified.", "The modpack files are installed correctly. Any missing or damaged files have been repaired.");
+    } else {
+        QMessageBox::warning(this, "Installation not verified.", "The installation could not be verified or repaired. Check the log for details, or reinstall the modpack.");
+    }
+}
+
+// Switches between modded and vanilla play by moving the plugins in or out of BepInEx's load path
+void MainWindow::clicked_toggle() {
+    if (manager.isEnabled()) {
+        logger->log("User has chosen to disable the modpack.");
+        manager.disable();
+    } else {
+        logger->log("User has chosen to enable the modpack.");
+        manager.enable();
+    }
+    ui->btn_toggle->setText(manager.isEnabled() ? "Disable" : "Enable");
+}
+
+// Reinstalls the release chosen from the chunk store, in place of the installed one
+void MainWindow::clicked_restoreRelease() {
+    QString release = ui->combo_release->currentText();
+    if (release.isEmpty()) {
+        return;
+    }
+
+    QMessageBox::StandardButton reply;
+    reply = QMessageBox::question(this, "Confirm", "Are you sure you would like to restore the modpack release " + release + "? It will be installed in place of the current one.",
+                                  QMessageBox::Yes|QMessageBox::No);
+    if (reply != QMessageBox::Yes) {
+        return;
+    }
+
+    logger->log("User has chosen to restore the release " + release.toStdString() + ".");
+    ui->btn_restoreRelease->setDisabled(true);
+    ui->btn_restoreRelease->setText("Restoring...");
+    manager.doRestoreRelease(release.toStdString());
+}
+
+void MainWindow::onReleaseRestored(bool restored) {
+    ui->btn_restoreRelease->setText("Restore");
+    ui->btn_restoreRelease->setEnabled(true);
+
+    if (restored) {
+        if (manager.getInstallationRelease().isEmpty()) {
+            ui->label_version->setText("Unknown");
+            ui->text_changelog->clear();
+        }
+        QMessageBox::information(this, "Release restored.", "The chosen modpack release has been installed.");
+    } else {
+        QMessageBox::warning(this, "Release not restored.", "The release could not be restored. Check the log for details.");
+    }
+    initialize_home();
+}
+
+// Swaps the install kept by the last staged install back in, in place of the current one
+void MainWindow::clicked_rollback() {
+    QMessageBox::StandardButton reply;
+    reply = QMessageBox::question(this, "Confirm", "Are you sure you would like to roll back to the previous modpack install? The current one will be kept, so rolling back again undoes it.",
+                                  QMessageBox::Yes|QMessageBox::No);
+    if (reply != QMessageBox::Yes) {
+        return;
+    }
+
+    logger->log("User has chosen to roll back the modpack install.");
+    ui->btn_rollback->setDisabled(true);
+    ui->btn_rollback->setText("Rolling back...");
+    manager.doRollbackInstall();
+}
+
+void MainWindow::onInstallRolledBack(bool rolledBack) {
+    ui->btn_rollback->setText("Roll Back");
+
+    if (rolledBack) {
+        if (manager.getInstallationRelease().isEmpty()) {
+            ui->label_version->setText("Unknown");
+            ui->text_changelog->clear();
+        }
+        QMessageBox::information(this, "Install rolled back.", "The previous modpack install has been restored.");
+    } else {
+        QMessageBox::warning(this, "Install not rolled back.", "The install could not be rolled back. Check the log for details.");
+    }
+    initialize_home();
+}
+
+// Switches to the chosen profile. A name that isn't a profile yet creates one, for a modpack repository the user gives.
+void MainWindow::selected_profile(const QString &name) {
+    std::string profile = name.trimmed().toStdString();
+    if (profile.empty() || profile == manager.getProfile()) {
+        return;
+    }
+
+    std::vector<Profile> profiles = manager.getProfiles();
+    if (std::none_of(profiles.begin(), profiles.end(), [&profile](const Profile &p) { return p.name == profile; })) {
+        bool accepted = false;
+        QString repository = QInputDialog::getText(this, "New profile", "Modpack repository for " + name.trimmed() + " (owner/repository):",
+                                                   QLineEdit::Normal, "m-riley04/TheWolfPack", &accepted);
+        QStringList parts = repository.trimmed().split('/');
+        if (!accepted || parts.size() != 2 || parts[0].isEmpty() || parts[1].isEmpty()
+            || !manager.createProfile(profile, parts[0].toStdString(), parts[1].toStdString())) {
+            ui->combo_profile->setCurrentText(QString(manager.getProfile().c_str()));
+            return;
+        }
+        logger->log("User created the profile " + profile + ".");
+    }
+
+    logger->log("User has chosen to switch to the profile " + profile + ".");
+    ui->combo_profile->setEnabled(false);
+    manager.doSwitchProfile(profile);
+}
+
+void MainWindow::onProfileSwitched(bool switched) {
+    ui->combo_profile->setEnabled(true);
+    if (switched) {
+        releaseUrl = manager.fetchLatestReleaseURL();
+        githubUrl = manager.getGithubUrl();
+        save();
+        if (manager.getInstallationRelease().isEmpty()) {
+            ui->label_version->setText("Not installed");
+            ui->text_changelog->clear();
+        }
+    } else {
+        QMessageBox::warning(this, "Profile not switched.", "The profile could not be switched. Check the log for details.");
+    }
+    initialize_home();
+}
+
+// Removes a profile other than the active one, chosen from a list, along with the stored files only it used
+void MainWindow::clicked_removeProfile() {
+    QStringList profiles;
+    for (const Profile &profile : manager.getProfiles()) {
+        if (profile.name != manager.getProfile()) {
+            profiles.append(QString(profile.name.c_str()));
+        }
+    }
+    if (profiles.isEmpty()) {
+        QMessageBox::information(this, "No profile to remove.", "The active profile can't be removed; switch to another one first.");
+        return;
+    }
+
+    bool accepted = false;
+    QString profile = QInputDialog::getItem(this, "Remove profile", "Profile to remove:", profiles, 0, false, &accepted);
+    if (!accepted || profile.isEmpty()) {
+        return;
+    }
+
+    QMessageBox::StandardButton reply;
+    reply = QMessageBox::question(this, "Confirm", "Are you sure you would like to remove the profile " + profile + "? Its saved files will be deleted.",
+                                  QMessageBox::Yes|QMessageBox::No);
+    if (reply != QMessageBox::Yes) {
+        return;
+    }
+
+    logger->log("User has chosen to remove the profile " + profile.toStdString() + ".");
+    ui->btn_removeProfile->setDisabled(true);
+    ui->btn_removeProfile->setText("Removing...");
+    manager.doRemoveProfile(profile.toStdString());
+}
+
+void MainWindow::onProfileRemoved(bool removed) {
+    ui->btn_removeProfile->setText("Remove Profile");
+
+    if (removed) {
+        QMessageBox::information(this, "Profile removed.", "The profile has been removed.");
+    } else {
+        QMessageBox::warning(this, "Profile not removed.", "The profile could not be removed. Check the log for details.");
+    }
+    initialize_home();
+}
+
 void MainWindow::clicked_github() {
     logger->log("User opened the modpack github.");
     QUrl url(githubUrl.c_str());
@@ -839,70 +1139,58 @@ void MainWindow::typed_gameLocation() {
         manager.setGameDirectory(gameDirectory);
         ui->line_lethalCompanyLocation->setStyleSheet("border: 1px solid green");
 
-        // Check game storage
+        // Check game storage once the space the install needs has been planned
         logger->log("Checking game disk storage...");
-        std::string currentRoot = QDir(gameDirectory.c_str()).rootPath().toStdString();
-        const double spaceCurrent = manager.getAvailableStorage(currentRoot)/1000000000.00000;
-        ui->label_spaceAvailableGame->setText(QString(std::to_string(spaceCurrent).c_str()));
-        if (!manager.hasEnoughStorage(currentRoot, 1000000000)) {
-            ui->label_spaceAvailableGame->setStyleSheet("color: red");
-            QString warningMessage = "WARNING: Not enough storage on game location disk (" + QString(currentRoot.c_str()) + "). You MUST have at least 1 gigabyte of free space.";
-            QMessageBox::warning(this, "Not enough storage.", warningMessage, QMessageBox::Ok);
-        }
-        ui->label_spaceAvailableGame->setStyleSheet("color: white");
+        connect(&manager, &Manager::storagePlanned, this, &MainWindow::onGameStoragePlanned, Qt::UniqueConnection);
+        manager.doPlanStorage(false);
         return;
     }
     ui->line_lethalCompanyLocation->setStyleSheet("border: 1px solid red");
 }
 
 //=== SLOTS
+// Checks the game's disk (once it is found) and the manager's disk against the planned install
+void MainWindow::onConfigurationStoragePlanned(bool update, SpacePlan plan) {
+    if (update) {
+        return;
+    }
+    disconnect(&manager, &Manager::storagePlanned, this, &MainWindow::onConfigurationStoragePlanned);
+    if (ui->label_found->text() == "Yes") {
+        logger->log("Checking game disk storage...");
+        check_gameStorage(plan);
+    }
+    check_managerStorage(plan);
+}
+void MainWindow::onGameStoragePlanned(bool update, SpacePlan plan) {
+    if (update) {
+        return;
+    }
+    disconnect(&manager, &Manager::storagePlanned, this, &MainWindow::onGameStoragePlanned);
+    check_gameStorage(plan);
+}
+// Shows every stage running, as the BepInEx and modpack stages run side by side
+void MainWindow::onStagesChanged(QString stages) {
+    if (!stages.isEmpty()) {
+        ui->label_progress->setText(stages + "...");
+    }
+}
 void MainWindow::onBepInExDownloaded() {
     logger->log("BepInEx downloaded successfully.");
-
-    // Move on to unzipping
-    logger->log("Preparing to unzip BepInEx...");
-    ui->label_progress->setText("Unzipping BepInEx...");
-    manager.doUnzipBepInEx();
 }
 void MainWindow::onBepInExUnzipped() {
     logger->log("BepInEx unzipped successfully.");
-
-    // Move on to install
-    logger->log("Preparing to install BepInEx...");
-    ui->label_progress->setText("Installing BepInEx...");
-    manager.doInstallBepInEx();
 }
 void MainWindow::onBepInExInstalled() {
     logger->log("BepInEx installed successfully.");
-
-    // Move on to the modpack fetch
-    logger->log("Preparing to fetch the modpack...");
-    ui->label_progress->setText("Fetching modpack...");
-    manager.doFetchModpack();
 }
 void MainWindow::onModpackFetched() {
-    logger->log("Update fetched successfully.");
-
-    // Move on to the modpack download
-    ui->label_progress->setText("Downloading modpack...");
-    logger->log("Preparing to download the modpack...");
-    manager.doDownload();
+    logger->log("Modpack fetched successfully.");
 }
 void MainWindow::onModpackDownloaded() {
     logger->log("Modpack downloaded successfully.");
-
-    // Move on to installation
-    logger->log("Preparing to unzip the modpack...");
-    ui->label_progress->setText("Unzipping modpack...");
-    manager.doUnzip();
 }
 void MainWindow::onModpackUnzipped() {
     logger->log("Modpack unzipped successfully.");
-
-    // Move on to installation
-    logger->log("Preparing to install the modpack...");
-    ui->label_progress->setText("Installing modpack...");
-    manager.doInstall();
 }
 void MainWindow::onModpackInstalled() {
     logger->log("--- INSTALLATION PHASE ENDED ---");
@@ -932,21 +1220,12 @@ void MainWindow::onUpdateChecked() {
 }
 void MainWindow::onUpdateFetched() {
     logger->log("Update fetched successfully.");
-
-    logger->log("Preparing to download the update...");
-    manager.doUpdateDownload();
 }
 void MainWindow::onUpdateDownloaded() {
     logger->log("Update downloaded successfully.");
-
-    logger->log("Preparing to unzip the update...");
-    manager.doUpdateUnzip();
 }
 void MainWindow::onUpdateUnzipped() {
     logger->log("Update unzipped successfully.");
-
-    logger->log("Preparing to install the update...");
-    manager.doUpdateInstall();
 }
 void MainWindow::onUpdateInstalled() {
     // Tell the user
@@ -973,22 +1252,35 @@ void MainWindow::onUpToDate() {
 }
 void MainWindow::onOutOfDate() {
     logger->log("Modpack is out of date.");
+
+    // The disks are checked once the space the update needs has been planned
+    connect(&manager, &Manager::storagePlanned, this, &MainWindow::onUpdateStoragePlanned, Qt::UniqueConnection);
+    manager.doPlanStorage(true);
+}
+void MainWindow::onUpdateStoragePlanned(bool update, SpacePlan plan) {
+    // An install's plan may arrive meanwhile; only the update's is checked here
+    if (!update) {
+        return;
+    }
+    disconnect(&manager, &Manager::storagePlanned, this, &MainWindow::onUpdateStoragePlanned);
     ui->btn_update->setText("Update");
 
     // Check storage
     logger->log("Checking available space on current disk...");
-    if (!manager.hasEnoughStorage(QDir::currentPath().toStdString(), 1000000000)) {
+    const qint64 spaceRequired = manager.getRequiredStorage(QDir::currentPath().toStdString(), plan);
+    if (!manager.hasEnoughStorage(QDir::currentPath().toStdString(), spaceRequired)) {
         // Tell the user they do not have enough storage until they have enough storage
-        QString message = "WARNING: Not enough storage on current working disk (" + QDir::rootPath() + "). You MUST have at least 1 gigabyte of free space.";
+        QString message = "WARNING: Not enough storage on current working disk (" + QDir::rootPath() + "). You MUST have at least " + QString::number(spaceRequired / 1000000) + " megabytes of free space.";
         QMessageBox::information(this, "Not enough storage.", message, QMessageBox::Ok);
         ui->btn_update->setEnabled(true);
         return;
     }
     logger->log("Checking available space on game disk...");
     if (gameDirectory != "") {
-        if (!manager.hasEnoughStorage(gameDirectory, 1000000000)) {
+        const qint64 gameSpaceRequired = manager.getRequiredStorage(gameDirectory, plan);
+        if (!manager.hasEnoughStorage(gameDirectory, gameSpaceRequired)) {
             // Tell the user they do not have enough storage until they have enough storage
-            QString message = "WARNING: Not enough storage on current game disk (" + QString(std::filesystem::path(gameDirectory).root_path().string().c_str()) + "). You MUST have at least 1 gigabyte of free space.";
+            QString message = "WARNING: Not enough storage on current game disk (" + QString(std::filesystem::path(gameDirectory).root_path().string().c_str()) + "). You MUST have at least " + QString::number(gameSpaceRequired / 1000000) + " megabytes of free space.";
             QMessageBox::information(this, "Not enough storage.", message, QMessageBox::Ok);
             ui->btn_update->setEnabled(true);
             return;
@@ -1008,13 +1300,8 @@ void MainWindow::onOutOfDate() {
         manager.clearPlugins();
         manager.clearConfig();
 
-        // Delete the old json installed release
-        QString userDataPath = QDir::currentPath() + "\\user_data";
-        QDir userDataDir(userDataPath);
-        userDataDir.remove("installation_release.json");
-
-        // Fetch latest version
-        manager.doUpdateFetch();
+        // Fetch, download and install the latest version (fetching replaces the installed release's json, once it has been kept for rolling back)
+        manager.doUpdateModpack();
     }
 }
 
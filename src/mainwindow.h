@@ -47,6 +47,11 @@ public:
     void update_console();
     void update_background();
     void update_home();
+    void update_inventory();
+
+    //===== Storage Checks
+    void check_gameStorage(const SpacePlan &plan);
+    void check_managerStorage(const SpacePlan &plan);
 
     //===== Button Commands
     void clicked_next();
@@ -62,6 +67,11 @@ public:
     void clicked_github();
     void clicked_managerGithub();
     void clicked_uninstall();
+    void clicked_verify();
+    void clicked_toggle();
+    void clicked_restoreRelease();
+    void clicked_rollback();
+    void clicked_removeProfile();
     void clicked_openAppLocation();
     void clicked_openLog();
     void clicked_openGameLocation();
@@ -72,7 +82,24 @@ public:
     //===== Textbox Commands
     void typed_gameLocation();
 
+    //===== Combobox Commands
+    void selected_profile(const QString &name);
+
 public slots:
+    void onStagesChanged(QString stages);
+
+    void onConfigurationStoragePlanned(bool update, SpacePlan plan);
+    void onGameStoragePlanned(bool update, SpacePlan plan);
+    void onInstallStoragePlanned(bool update, SpacePlan plan);
+    void onUpdateStoragePlanned(bool update, SpacePlan plan);
+
+    void onInstallVerified(bool intact);
+    void onPluginsScanned();
+    void onProfileSwitched(bool switched);
+    void onProfileRemoved(bool removed);
+    void onReleaseRestored(bool restored);
+    void onInstallRolledBack(bool rolledBack);
+
     void onBepInExDownloaded();
     void onBepInExUnzipped();
     void onBepInExInstalled();
@@ -106,6 +133,7 @@ private:
     bool pageCompleted;
     bool modpackInstalled;
     bool firstOpen;
+    bool directInstall;
     std::string releaseUrl;
     std::string githubUrl;
     std::string gameDirectory;
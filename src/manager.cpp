@@ -1,9 +1,51 @@
 #include "manager.h"
 #include <filesystem>
-#include <QThread>
+#include <algorithm>
+#include <fstream>
+#include <QEventLoop>
+#include <QStringList>
 #include "ziphandler.h"
 #include "appexceptions.h"
 #include "logger.h"
+#include "zipindex.h"
+#include "packarchive.h"
+#include "chunkstore.h"
+#include "installverifier.h"
+#include "spaceplanner.h"
+#include "profilestore.h"
+#include "trash.h"
+
+// Where BepInEx is downloaded from
+static const char * BEPINEX_URL = "https://thunderstore.io/package/download/BepInEx/BepInExPack/5.4.2100/";
+
+// Downloads a url into a folder, waiting on the calling thread until it is saved. Throws DownloadFailedException if it fails.
+static void downloadFile(const std::string &url, const std::string &output, const std::string &name, bool json) {
+    Downloader worker(url, output, name);
+    QEventLoop loop;
+    bool succeeded = false;
+    QObject::connect(&worker, &Downloader::downloadFinished, &loop, [&]() {
+        succeeded = true;
+        loop.quit();
+    });
+    QObject::connect(&worker, &Downloader::downloadError, &loop, &QEventLoop::quit);
+    if (json) {
+        worker.doDownloadJson();
+    } else {
+        worker.doDownload();
+    }
+    loop.exec();
+    if (!succeeded) {
+        throw DownloadFailedException();
+    }
+}
+
+// Returns a log line describing the throughput of an extraction
+static std::string describeExtraction(const ExtractStats &stats) {
+    return "Extracted " + std::to_string(stats.files) + " files (" + std::to_string(stats.bytes / 1000000) + " MB), skipped "
+           + std::to_string(stats.skipped) + " unchanged files in "
+           + std::to_string(stats.seconds) + "s: " + std::to_string(stats.filesPerSecond()) + " files/s, "
+           + std::to_string(stats.megabytesPerSecond()) + " MB/s" + (stats.failed > 0 ? ", " + std::to_string(stats.failed) + " FAILED" : "");
+}
 
 //=== CONSTRUCTORS/DESTRUCTORS
 Manager::Manager() {
@@ -40,9 +82,8 @@ Manager::Manager(Manager &m) {
 }
 
 Manager::~Manager() {
-    // Exit the thread safely
-    thread.quit();
-    thread.wait();
+    // Let running pipeline tasks finish safely; nothing new starts without the event loop
+    pool.waitForDone();
 }
 
 //=== FUNCTIONALITIES
@@ -50,7 +91,7 @@ Manager::~Manager() {
 void Manager::download() {
     // Get the latest release URL
     Logger::log("Grabbing latest release URL...", logPath);
-    std::string latestReleaseURL = this->fetchLatestReleaseURL("m-riley04", "TheWolfPack");
+    std::string latestReleaseURL = this->fetchLatestReleaseURL();
     Logger::log("Latest Release: " + latestReleaseURL, logPath);
     std::string url = this->fetchReleaseDownload(latestReleaseURL);
     Logger::log("Latest Release Download: " + url, logPath);
@@ -81,8 +122,13 @@ void Manager::unzip() {
     Logger::log("Extracting downloaded zip file...", logPath);
     std::string zip = cacheDirectory + "\\" + filename + ".zip";
     std::string output = cacheDirectory + "\\" + filename;
-    ZipHandler::extract(zip, output);
-    Logger::log("Zip file has been extracted.", logPath);
+    ExtractStats stats;
+    if (ZipHandler::extract(zip, output, &stats) != 0) {
+        Logger::log("ERROR: Some files could not be extracted.", logPath);
+    } else {
+        Logger::log("Zip file has been extracted.", logPath);
+    }
+    Logger::log(describeExtraction(stats), logPath);
 }
 
 void Manager::unzipBepInEx() {
@@ -90,8 +136,13 @@ void Manager::unzipBepInEx() {
     Logger::log("Extracting downloaded zip file...", logPath);
     std::string zip = cacheDirectory + "\\BepInEx.zip";
     std::string output = cacheDirectory + "\\BepInEx";
-    ZipHandler::extract(zip, output);
-    Logger::log("Zip file has been extracted.", logPath);
+    ExtractStats stats;
+    if (ZipHandler::extract(zip, output, &stats) != 0) {
+        Logger::log("ERROR: Some files could not be extracted.", logPath);
+    } else {
+        Logger::log("Zip file has been extracted.", logPath);
+    }
+    Logger::log(describeExtraction(stats), logPath);
 }
 
 void Manager::install() {
@@ -127,12 +178,32 @@ void Manager::update() {
 
 // Enables the modpack
 void Manager::enable() {
+    try {
+        Installer::enable(gameDirectory);
+    } catch (std::exception &e) {
+        Logger::log("ERROR: The modpack could not be enabled: " + std::string(e.what()), logPath);
+        return;
+    }
     Logger::log("The modpack has been enabled.", logPath);
 }
 
 // Disables the modpack temporarily
 void Manager::disable() {
-   Logger::log("The modpack has been disabled.", logPath);
+    try {
+        Installer::disable(gameDirectory);
+    } catch (std::exception &e) {
+        Logger::log("ERROR: The modpack could not be disabled: " + std::string(e.what()), logPath);
+        return;
+    }
+    Logger::log("The modpack has been disabled.", logPath);
+}
+
+// Returns whether a staged install kept the install it replaced, which rollbackInstall() can swap back in
+bool Manager::hasPreviousInstall() { return Installer::hasPreviousInstall(gameDirectory); }
+
+// Returns whether the modpack is installed and loaded by BepInEx
+bool ManagerTasks::isEnabled() const {
+    return !Installer::isDisabled(gameDirectory);
 }
 
 // Clears out the plugins folder
@@ -153,6 +224,349 @@ void Manager::clearPatchers() {
     std::filesystem::remove(patchersPath);
 }
 
+/* Rebuilds a release kept in the chunk store into the cache, in place of whatever was extracted there (the
+ * installer takes the first folder it finds). Returns false if it isn't stored or fails verification.
+*/
+bool ManagerTasks::restoreRelease(const std::string &version) const {
+    ChunkStore store(cacheDirectory + "\\chunks");
+    if (!store.hasRelease(version)) {
+        Logger::log("ERROR: Release " + version + " is not in the chunk store.", logPath);
+        return false;
+    }
+
+    Logger::log("Rebuilding release " + version + " from the chunk store...", logPath);
+    std::string output = cacheDirectory + "\\latest_release";
+    Trash::remove(output, Trash::trashFor(cacheDirectory));
+    ExtractStats stats;
+    int result = store.rebuild(version, { { "", output } }, &stats);
+    Logger::log(describeExtraction(stats), logPath);
+    return result == 0;
+}
+
+// Returns the releases kept in the chunk store, which restoreRelease() can rebuild (none while the store is off)
+std::vector<std::string> Manager::getStoredReleases() {
+    if (!chunkStore) {
+        return {};
+    }
+    return ChunkStore(cacheDirectory + "\\chunks").releases();
+}
+
+/* Swaps the modpack install kept by the last staged install back in, along with its release's details (the
+ * replaced ones are kept in turn, so rolling back again undoes it). The cached archive belongs to the release
+ * rolled back from, so it is dropped, and a reinstall downloads the installed release again. Returns false if
+ * there isn't a previous install.
+*/
+bool ManagerTasks::rollbackInstall() const {
+    if (!Installer::hasPreviousInstall(gameDirectory)) {
+        Logger::log("ERROR: There is no previous install to roll back to.", logPath);
+        return false;
+    }
+
+    try {
+        Installer::rollback(gameDirectory);
+    } catch (std::exception &e) {
+        Logger::log("ERROR: Rolling back the install failed: " + std::string(e.what()), logPath);
+        return false;
+    }
+
+    std::string releasePath = userDataDirectory + "\\installation_release.json";
+    std::string previousPath = userDataDirectory + "\\previous_release.json";
+    std::string swapPath = userDataDirectory + "\\rollback_release.json";
+    copyReleaseDetails(releasePath, swapPath);
+    copyReleaseDetails(previousPath, releasePath);
+    copyReleaseDetails(swapPath, previousPath);
+    std::error_code error;
+    std::filesystem::remove(swapPath, error);
+
+    std::string zip = cacheDirectory + "\\latest_release.zip";
+    std::filesystem::remove(zip, error);
+    std::filesystem::remove(ZipIndex::indexPathFor(zip), error);
+    std::filesystem::remove(PackArchive::packPathFor(zip), error);
+    Trash::remove(cacheDirectory + "\\latest_release", Trash::trashFor(cacheDirectory));
+
+    std::string tag = getInstallationRelease().value("tag_name").toString().toStdString();
+    Installer::recordModpack(gameDirectory, getManifestPath(), tag);
+    Logger::log("Rolled back to the previous install (" + (tag.empty() ? "unknown release" : tag) + ").", logPath);
+    return true;
+}
+
+/* Checks the installed modpack against the cached release archive, re-extracting only the files that are
+ * missing or damaged when repair is on. Returns whether the install is intact afterwards.
+*/
+bool ManagerTasks::verifyInstall(bool repair) const {
+    if (!isEnabled()) {
+        Logger::log("ERROR: The modpack is disabled; enable it before verifying the installation.", logPath);
+        return false;
+    }
+
+    std::string archive = cachedArchive("latest_release");
+    if (!std::filesystem::exists(archive)) {
+        Logger::log("ERROR: The release archive is not in the cache, so the install can't be verified.", logPath);
+        return false;
+    }
+
+    InstallManifest manifest;
+    manifest.load(getManifestPath());
+    VerifyResult result;
+    if (!InstallVerifier::verify(archive, gameDirectory, manifest, result)) {
+        Logger::log("ERROR: The release archive could not be read.", logPath);
+        return false;
+    }
+    for (const VerifyProblem &problem : result.problems) {
+        Logger::log((problem.missing ? "Missing: " : "Damaged: ") + problem.path, logPath);
+    }
+
+    bool intact = result.problems.empty();
+    if (!intact && repair) {
+        intact = InstallVerifier::repair(archive, result);
+        Installer::recordModpack(gameDirectory, getManifestPath(), getInstallationRelease().value("tag_name").toString().toStdString());
+    }
+    Logger::log(InstallVerifier::describe(result), logPath);
+    return intact;
+}
+
+/* Takes an inventory of the DLLs in the plugins folder (wherever it is while the modpack is disabled). Unchanged
+ * DLLs keep their cached records, and the result is also written out as a report for comparing installs across machines.
+*/
+PluginInventory ManagerTasks::scanPlugins() const {
+    std::string pluginsDirectory = gameDirectory + "\\BepInEx\\plugins" + (isEnabled() ? "" : Installer::getDisabledSuffix());
+    std::string cachePath = userDataDirectory + "\\plugin_inventory.cache";
+    PluginInventory inventory;
+    inventory.load(cachePath);
+    InventoryResult result = inventory.scan(pluginsDirectory);
+    inventory.save(cachePath);
+
+    std::ofstream report(userDataDirectory + "\\plugin_inventory.tsv", std::ios::trunc);
+    report << inventory.report();
+    Logger::log("Plugin inventory: " + std::to_string(result.filesScanned) + " DLLs declaring " + std::to_string(inventory.countPlugins())
+                + " BepInEx plugins (" + std::to_string(result.filesRead) + " read, the rest cached) in " + std::to_string(result.seconds) + "s", logPath);
+    return inventory;
+}
+
+//=== PROFILES
+// Creates a profile for a modpack repository, with nothing installed yet. Returns false if the name is taken.
+bool Manager::createProfile(const std::string &name, const std::string &owner, const std::string &repo) {
+    ProfileStore store(getProfileStorePath());
+    if (name.empty() || store.hasProfile(name)) {
+        Logger::log("ERROR: A profile named " + name + " already exists.", logPath);
+        return false;
+    }
+    if (!store.addProfile({ name, owner, repo, "" })) {
+        Logger::log("ERROR: The profile " + name + " could not be created.", logPath);
+        return false;
+    }
+    Logger::log("Created profile " + name + " for " + owner + "/" + repo + ".", logPath);
+    return true;
+}
+
+/* Switches the game's files to another profile. The current modpack folders are captured into the active
+ * profile (so its config edits survive), the other profile is built next to them out of links to the store,
+ * and the two are swapped with renames. Nothing is changed if any step before the swap fails. Only touches
+ * files, so it can run on the pool; the profile it switched to is returned in "target" for
+ * setActiveProfile() to take on afterwards.
+*/
+bool ManagerTasks::switchProfile(const std::string &name, Profile &target) const {
+    ProfileStore store(getProfileStorePath());
+    if (!store.getProfile(name, target)) {
+        Logger::log("ERROR: There is no profile named " + name + ".", logPath);
+        return false;
+    }
+    if (!isEnabled()) {
+        Logger::log("ERROR: The modpack is disabled; enable it before switching profiles.", logPath);
+        return false;
+    }
+
+    Logger::log("Saving profile " + profile + "...", logPath);
+    std::string releasePath = userDataDirectory + "\\installation_release.json";
+    if (!store.hasProfile(profile)) {
+        store.addProfile({ profile, packOwner, packRepo, "" });
+    }
+    if (!store.capture(profile, gameDirectory, getInstallationRelease().value("tag_name").toString().toStdString())) {
+        Logger::log("ERROR: The current profile could not be saved, so it was kept.", logPath);
+        return false;
+    }
+    std::error_code error;
+    if (std::filesystem::exists(releasePath, error)) {
+        std::filesystem::copy_file(releasePath, store.releasePath(profile), std::filesystem::copy_options::overwrite_existing, error);
+    }
+
+    Logger::log("Switching to profile " + name + "...", logPath);
+    try {
+        if (!store.materialise(name, gameDirectory, Installer::getStagingSuffix())) {
+            throw ModpackInstallationError();
+        }
+        Installer::discardPrevious(gameDirectory);
+        Installer::swapInStaging(gameDirectory);
+    } catch (std::exception &e) {
+        Logger::log("ERROR: Switching profiles failed: " + std::string(e.what()), logPath);
+        return false;
+    }
+    // The replaced folders are saved in the store, and rolling back to them would mix up the profiles
+    Installer::discardPrevious(gameDirectory);
+    std::filesystem::remove(userDataDirectory + "\\previous_release.json", error);
+
+    // The installed release's details belong to the profile too
+    if (std::filesystem::exists(store.releasePath(name), error)) {
+        std::filesystem::copy_file(store.releasePath(name), releasePath, std::filesystem::copy_options::overwrite_existing, error);
+    } else {
+        std::filesystem::remove(releasePath, error);
+    }
+    Installer::recordModpack(gameDirectory, getManifestPath(), target.version);
+
+    // Cached releases of another pack must not be installed as this one's
+    if (target.owner != packOwner || target.repo != packRepo) {
+        std::vector<std::string> releases;
+        for (const auto &item : std::filesystem::directory_iterator(cacheDirectory, error)) {
+            std::string filename = item.path().filename().string();
+            if (filename.rfind("latest_release", 0) == 0 || filename.rfind("installation_release", 0) == 0) {
+                releases.push_back(item.path().string());
+            }
+        }
+        for (const std::string &release : releases) {
+            Trash::remove(release, Trash::trashFor(cacheDirectory));
+        }
+    }
+    return true;
+}
+
+// Makes a profile the active one, once its files have been switched in (see switchProfile())
+void Manager::setActiveProfile(const Profile &target) {
+    profile = target.name;
+    packOwner = target.owner;
+    packRepo = target.repo;
+    version = target.version;
+    fetchLatestReleaseURL();
+    Logger::log("Switched to profile " + profile + " (" + packOwner + "/" + packRepo + " " + (version.empty() ? "not installed" : version) + ").", logPath);
+}
+
+// Deletes a profile (but not the active one), and any stored files no other profile uses
+bool ManagerTasks::removeProfile(const std::string &name) const {
+    if (name == profile) {
+        Logger::log("ERROR: The active profile can't be removed; switch to another one first.", logPath);
+        return false;
+    }
+    ProfileStore store(getProfileStorePath());
+    if (!store.removeProfile(name)) {
+        Logger::log("ERROR: There is no profile named " + name + ".", logPath);
+        return false;
+    }
+    std::uint64_t freed = store.collectGarbage();
+    Logger::log("Removed profile " + name + "; freed " + std::to_string(freed / 1000000) + " MB.", logPath);
+    return true;
+}
+
+/* Checks a downloaded archive against its stored index, building the index if there isn't one yet.
+ * A corrupt archive is deleted so the next attempt downloads it again.
+*/
+bool ManagerTasks::verifyArchive(const std::string &zip) const {
+    ZipIndex index;
+    if (!PackArchive::isPack(zip) && index.open(zip)) {
+        return true;
+    }
+
+    Logger::log("Verifying downloaded archive...", logPath);
+    std::string problem;
+    if (PackArchive::isPack(zip) ? PackArchive::verify(zip, problem) : (ZipIndex::verifyArchive(zip, problem) && ZipIndex::build(zip))) {
+        Logger::log("Archive verified and indexed.", logPath);
+        return true;
+    }
+
+    Logger::log("ERROR: The archive '" + zip + "' is corrupt: " + problem, logPath);
+    std::error_code error;
+    std::filesystem::remove(zip, error);
+    std::filesystem::remove(ZipIndex::indexPathFor(zip), error);
+    return false;
+}
+
+// Returns the cached archive for a download: its repacked copy if the original zip has been replaced by one
+std::string ManagerTasks::cachedArchive(const std::string &filename) const {
+    std::string zip = cacheDirectory + "\\" + filename + ".zip";
+    std::string pack = PackArchive::packPathFor(zip);
+    if (!std::filesystem::exists(zip) && std::filesystem::exists(pack)) {
+        return pack;
+    }
+    return zip;
+}
+
+/* Verifies a downloaded archive and, when repacking is on, replaces the zip with a zstd pack.
+ * Returns the path to extract from, or an empty string if the archive is corrupt.
+*/
+std::string ManagerTasks::prepareArchive(const std::string &filename) const {
+    std::string archive = cachedArchive(filename);
+    if (!verifyArchive(archive)) {
+        return "";
+    }
+    if (!repackCache || PackArchive::isPack(archive)) {
+        return archive;
+    }
+
+    Logger::log("Repacking archive for faster reinstalls...", logPath);
+    std::string pack = PackArchive::packPathFor(archive);
+    if (!PackArchive::transcode(archive, pack)) {
+        Logger::log("Repacking failed; keeping the original archive.", logPath);
+        return archive;
+    }
+
+    std::error_code error;
+    std::filesystem::remove(archive, error);
+    std::filesystem::remove(ZipIndex::indexPathFor(archive), error);
+    Logger::log("Archive repacked.", logPath);
+    return pack;
+}
+
+/* Decodes an archive into memory when it fits in the memory staging budget, so the installer can
+ * write straight from memory. Returns false (leaving no stage behind) if the archive should be staged on disk.
+*/
+bool ManagerTasks::stageInMemory(const std::string &zip, std::shared_ptr<MemoryStage> &stage) const {
+    stage.reset();
+    if (memoryStageBudget <= 0) {
+        return false;
+    }
+
+    auto memoryStage = std::make_shared<MemoryStage>(static_cast<std::uint64_t>(memoryStageBudget));
+    ExtractStats stats;
+    int result = ZipHandler::extractToMemory(zip, *memoryStage, &stats);
+    if (result != 0) {
+        Logger::log(result > 0 ? "Archive is over the memory staging budget; extracting to disk."
+                               : "Extracting into memory failed; extracting to disk.", logPath);
+        return false;
+    }
+
+    Logger::log("Zip file has been extracted into memory.", logPath);
+    Logger::log(describeExtraction(stats), logPath);
+    stage = memoryStage;
+    return true;
+}
+
+// Records a release in the chunk store, then forgets all but the newest retained releases and frees their unique chunks
+void ManagerTasks::recordRelease(const std::string &zip) const {
+    if (!chunkStore) {
+        return;
+    }
+    std::string version = getInstallationRelease().value("tag_name").toString().toStdString();
+    if (version.empty()) {
+        version = "latest_release";
+    }
+
+    ChunkStore store(cacheDirectory + "\\chunks");
+    if (store.hasRelease(version)) {
+        return;
+    }
+    Logger::log("Adding release " + version + " to the chunk store...", logPath);
+    if (!store.addRelease(version, zip)) {
+        Logger::log("The release could not be added to the chunk store.", logPath);
+        return;
+    }
+
+    // Keep the release's details with it, so restoring it also restores what the app shows as installed
+    std::error_code error;
+    std::filesystem::copy_file(userDataDirectory + "\\installation_release.json", store.detailsPath(version),
+                               std::filesystem::copy_options::overwrite_existing, error);
+    store.prune(static_cast<std::size_t>(std::max(1, retainedReleases)));
+    std::uint64_t freed = store.collectGarbage();
+    Logger::log("Release stored; freed " + std::to_string(freed / 1000000) + " MB of unused chunks.", logPath);
+}
+
 //=== STATUS
 // Returns whether the modpack is updated to the latest release or not
 bool Manager::isUpdated() {
@@ -200,6 +614,44 @@ qint64 Manager::getAvailableStorage(std::string path) {
     return info.bytesAvailable();
 }
 
+/* Works out the space an install or update needs in the cache and in the game directory. An update's
+ * release isn't downloaded yet, so the cached archive (the installed release) is left out of it.
+ * Lists archives and stats installed files, so it runs on the pool (see doPlanStorage()).
+*/
+SpacePlan ManagerTasks::planStorage(bool update) const {
+    InstallManifest manifest;
+    manifest.load(getManifestPath());
+
+    SpacePlanner planner(gameDirectory);
+    if (!update) {
+        planner.setArchive(cachedArchive("latest_release"));
+    }
+    bool bepinexInstalled = !gameDirectory.empty() && std::filesystem::exists(gameDirectory + "\\BepInEx");
+    planner.setBepInExArchive(cachedArchive("BepInEx"), bepinexInstalled);
+    planner.setExtractToCache(!directInstall);
+    planner.setStagedInstall(stagedInstall);
+    planner.setMemoryStageBudget(memoryStageBudget > 0 ? static_cast<std::uint64_t>(memoryStageBudget) : 0);
+    planner.setEstimate(manifest.totalSize());
+    return planner.plan();
+}
+
+/* Returns the bytes a planned install or update (see doPlanStorage()) still needs on the volume holding a
+ * path: the cache's share if the cache is on it, and the game directory's share if the game is on it.
+*/
+qint64 Manager::getRequiredStorage(std::string path, const SpacePlan &plan) {
+    QString volume = QStorageInfo(QString(path.c_str())).rootPath();
+    qint64 required = 0;
+    if (QStorageInfo(QString(cacheDirectory.c_str())).rootPath() == volume) {
+        required += static_cast<qint64>(plan.cacheBytes);
+    }
+    if (!gameDirectory.empty() && QStorageInfo(QString(gameDirectory.c_str())).rootPath() == volume) {
+        required += static_cast<qint64>(plan.gameBytes);
+    }
+    Logger::log("Space needed on " + volume.toStdString() + ": " + std::to_string(required / 1000000) + " MB"
+                + (plan.estimated ? " (estimated)" : ""), logPath);
+    return required;
+}
+
 //=== FINDERS
 // Finds the game's installation directory
 std::string Manager::locateGameLocation() {
@@ -248,6 +700,11 @@ std::string Manager::locateGameLocation() {
 //=== URL FETCHERS
 // Returns a string of the latest url release
 std::string Manager::fetchLatestReleaseURL(std::string owner, std::string repo) {
+    // Without a repository given, use the active profile's pack
+    if (owner.empty() || repo.empty()) {
+        owner = packOwner;
+        repo = packRepo;
+    }
     std::string url = "https://api.github.com/repos/";
     url += owner; url += "/"; url += repo; url += "/releases/latest";
     packUrl = url;
@@ -300,263 +757,364 @@ std::string Manager::fetchReleaseChangelog(std::string &url) {
 }
 
 //=== SLOTS
-void Manager::doFetchModpack() {
-    // Get the latest release URL
-    Logger::log("Grabbing latest release URL...", logPath);
-    std::string latestReleaseURL = this->fetchLatestReleaseURL("m-riley04", "TheWolfPack");
-    std::string filename = "installation_release";
-
-    Downloader * worker     = new Downloader(latestReleaseURL, userDataDirectory, filename);
-    worker->moveToThread(&thread);
-
-    connect(&thread, &QThread::started, worker, &Downloader::doDownloadJson);
-    connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
-    connect(worker, &Downloader::downloadFinished, this, &Manager::onModpackFetched);
-
-    thread.start();
-    Logger::log("Modpack fetch thread started.", logPath);
-}
-void Manager::doDownload() {
-    std::string filename = "latest_release";
-
-    // Check if file is already in cache
-    Logger::log("Beginning download...", logPath);
-    if (std::filesystem::exists(cacheDirectory + "\\" + filename + ".zip")) {
-        Logger::log("Requested file already downloaded!", logPath);
-        onModpackDownloaded();
-        return;
+/* Installs the modpack as a pipeline of tasks on the manager's thread pool: fetch, download, verify,
+ * unzip and install. When BepInEx is missing, its own download, verify, unzip and install run
+ * alongside, and only the modpack's install waits for it. The signal for each stage is emitted as it
+ * finishes, and errorOccurred if any of them fails.
+*/
+void Manager::doInstallModpack(bool withBepInEx) {
+    TaskGraph * graph = createPipeline();
+    ManagerTasks tasks(*this);
+    auto modpackStage = std::make_shared<std::shared_ptr<MemoryStage>>();
+    auto bepinexStage = std::make_shared<std::shared_ptr<MemoryStage>>();
+    auto reportStages = [this, graph]() {
+        QStringList stages;
+        for (const std::string &task : graph->getRunningTasks()) {
+            stages.append(QString::fromStdString(task));
+        }
+        emit stagesChanged(stages.join(", "));
+    };
+    connect(graph, &TaskGraph::taskStarted, this, reportStages);
+    connect(graph, &TaskGraph::taskFinished, this, reportStages);
+    connect(graph, &TaskGraph::failed, this, [this](QString, QString error) { emit errorOccurred(error); });
+
+    // BepInEx comes from a fixed release, so there is nothing to fetch
+    if (withBepInEx) {
+        graph->addTask("Downloading BepInEx", [this, tasks]() {
+            if (std::filesystem::exists(tasks.cachedArchive("BepInEx"))) {
+                Logger::log("Requested file already downloaded!", tasks.logPath);
+            } else {
+                downloadFile(BEPINEX_URL, tasks.cacheDirectory, "BepInEx", false);
+            }
+            emit bepInExDownloaded();
+        }, {}, { "BepInEx archive" });
+        addUnpackTasks(*graph, tasks, "BepInEx", "BepInEx", bepinexStage, false, &Manager::bepInExUnzipped);
+        graph->addTask("Installing BepInEx", [this, tasks, bepinexStage]() {
+            Installer worker(tasks.cacheDirectory + "\\BepInEx", tasks.gameDirectory);
+            if (tasks.directInstall) {
+                worker.setArchivePath(tasks.cachedArchive("BepInEx"));
+            }
+            worker.setMemoryStage(*bepinexStage);
+            worker.setManifest(tasks.getManifestPath(), "BepInEx");
+            worker.doInstallBepInEx();
+            bepinexStage->reset();
+            emit bepInExInstalled();
+        }, { "BepInEx files" }, { "BepInEx installed" });
     }
 
-    // Implement threading
-    Downloader* worker      = new Downloader(installedModpackZipUrl, cacheDirectory, filename);
-    worker->moveToThread(&thread);
-
-    connect(&thread, &QThread::started, worker, &Downloader::doDownload);
-    connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
-    connect(worker, &Downloader::downloadFinished, this, &Manager::onModpackDownloaded);
-
-    thread.start();
-    Logger::log("Modpack download thread started.", logPath);
+    // Nothing before the install needs BepInEx, so the modpack is fetched, downloaded and unpacked meanwhile
+    std::string releaseUrl = fetchLatestReleaseURL();
+    graph->addTask("Fetching modpack", [this, tasks, releaseUrl]() {
+        ManagerTasks::copyReleaseDetails(tasks.userDataDirectory + "\\installation_release.json", tasks.userDataDirectory + "\\replaced_release.json");
+        downloadFile(releaseUrl, tasks.userDataDirectory, "installation_release", true);
+        emit modpackFetched();
+    }, {}, { "modpack release" });
+    graph->addTask("Downloading modpack", [this, tasks]() {
+        if (std::filesystem::exists(tasks.cachedArchive("latest_release"))) {
+            Logger::log("Requested file already downloaded!", tasks.logPath);
+        } else {
+            downloadFile(tasks.getInstallationRelease().value("zipball_url").toString().toStdString(), tasks.cacheDirectory, "latest_release", false);
+        }
+        emit modpackDownloaded();
+    }, { "modpack release" }, { "modpack archive" });
+    addUnpackTasks(*graph, tasks, "latest_release", "modpack", modpackStage, true, &Manager::modpackUnzipped);
+
+    // The modpack installs into BepInEx's folders, so it waits for BepInEx (no task makes it when it is already installed)
+    graph->addTask("Installing modpack", [this, tasks, modpackStage]() {
+        tasks.installModpackFiles(*modpackStage);
+        modpackStage->reset();
+        emit modpackInstalled();
+    }, { "modpack files", "BepInEx installed" }, { "modpack installed" });
+
+    graph->start();
 }
-void Manager::doDownloadBepInEx() {
-    // Get the latest release URL
-    std::string bepinexURL = "https://thunderstore.io/package/download/BepInEx/BepInExPack/5.4.2100/";
-    std::string filename = "BepInEx";
 
-    // Check if file is already in cache
-    Logger::log("Beginning download...", logPath);
-    if (std::filesystem::exists(cacheDirectory + "\\" + filename + ".zip")) {
-        Logger::log("Requested file already downloaded!", logPath);
-        onBepInExDownloaded();
-        return;
-    }
-
-    // Implement threading
-    Downloader* worker      = new Downloader(bepinexURL, cacheDirectory, filename);
-    worker->moveToThread(&thread);
-
-    connect(&thread, &QThread::started, worker, &Downloader::doDownload);
-    connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
-    connect(worker, &Downloader::downloadFinished, this, &Manager::onBepInExDownloaded);
-
-    thread.start();
-    Logger::log("BepInEx download thread started.", logPath);
+/* Updates the modpack as a pipeline of tasks: fetch, download, verify, unzip and install. The new
+ * release always replaces the cached archive of the installed one. updateFailed is emitted if any
+ * stage fails.
+*/
+void Manager::doUpdateModpack() {
+    TaskGraph * graph = createPipeline();
+    ManagerTasks tasks(*this);
+    auto modpackStage = std::make_shared<std::shared_ptr<MemoryStage>>();
+    connect(graph, &TaskGraph::failed, this, [this]() { emit updateFailed(); });
+
+    std::string releaseUrl = fetchLatestReleaseURL();
+    graph->addTask("Fetching update", [this, tasks, releaseUrl]() {
+        ManagerTasks::copyReleaseDetails(tasks.userDataDirectory + "\\installation_release.json", tasks.userDataDirectory + "\\replaced_release.json");
+        downloadFile(releaseUrl, tasks.userDataDirectory, "installation_release", true);
+        emit updateFetched();
+    }, {}, { "update release" });
+    graph->addTask("Downloading update", [this, tasks]() {
+        downloadFile(tasks.getInstallationRelease().value("zipball_url").toString().toStdString(), tasks.cacheDirectory, "update_release", false);
+
+        /* Only replace the installed release's archive (and its index and pack) once the new one is here. Its
+         * extracted folder (with its extraction index) goes too: the new release's root folder has another name,
+         * and the installer takes the first folder it finds there.
+        */
+        std::string zip = tasks.cacheDirectory + "\\latest_release.zip";
+        std::error_code error;
+        std::filesystem::remove(ZipIndex::indexPathFor(zip), error);
+        std::filesystem::remove(PackArchive::packPathFor(zip), error);
+        Trash::remove(tasks.cacheDirectory + "\\latest_release", Trash::trashFor(tasks.cacheDirectory));
+        std::filesystem::rename(tasks.cacheDirectory + "\\update_release.zip", zip, error);
+        if (error) {
+            throw DownloadFailedException();
+        }
+        emit updateDownloaded();
+    }, { "update release" }, { "update archive" });
+    addUnpackTasks(*graph, tasks, "latest_release", "update", modpackStage, true, &Manager::updateUnzipped);
+    graph->addTask("Installing update", [this, tasks, modpackStage]() {
+        tasks.installModpackFiles(*modpackStage);
+        modpackStage->reset();
+        emit updateInstalled();
+    }, { "update files" }, { "update installed" });
+
+    graph->start();
 }
-void Manager::doUnzip() {
-    std::string filename = "latest_release";
-    // Extract the zip file to the cache directory
-    Logger::log("Extracting downloaded zip file...", logPath);
-    std::string zip = cacheDirectory + "\\" + filename + ".zip";
-    std::string output = cacheDirectory + "\\" + filename;
-    ZipHandler::extract(zip, output);
-    Logger::log("Zip file has been extracted.", logPath);
 
-    onModpackUnzipped();
+// Fetches the latest release's details into the cache, emitting fetched once they are there
+void Manager::doFetch() {
+    TaskGraph * graph = createPipeline();
+    std::string releaseUrl = fetchLatestReleaseURL();
+    std::string cache = cacheDirectory;
+    graph->addTask("Fetching latest release", [this, releaseUrl, cache]() {
+        downloadFile(releaseUrl, cache, "latest_release", true);
+        emit fetched();
+    }, {}, { "latest release" });
+    graph->start();
 }
-void Manager::doUnzipBepInEx() {
-    std::string filename = "BepInEx";
-    // Extract the zip file to the cache directory
-    Logger::log("Extracting downloaded zip file...", logPath);
-    std::string zip = cacheDirectory + "\\" + filename + ".zip";
-    std::string output = cacheDirectory + "\\" + filename;
-    ZipHandler::extract(zip, output);
-    Logger::log("Zip file has been extracted.", logPath);
 
-    onBepInExUnzipped();
+// Verifies the install (repairing it when asked) on the thread pool, emitting installVerified with whether it is intact
+void Manager::doVerifyInstall(bool repair) {
+    TaskGraph * graph = createPipeline();
+    ManagerTasks tasks(*this);
+    auto intact = std::make_shared<bool>(false);
+    graph->addTask("Verifying installation", [tasks, repair, intact]() {
+        *intact = tasks.verifyInstall(repair);
+    }, {}, { "verified installation" });
+    connect(graph, &TaskGraph::finished, this, [this, intact]() { emit installVerified(*intact); });
+    connect(graph, &TaskGraph::failed, this, [this]() { emit installVerified(false); });
+    graph->start();
 }
-void Manager::doInstall() {
-    std::string installationFilesDirectory = cacheDirectory + "\\latest_release";
-    Installer * worker = new Installer(installationFilesDirectory, gameDirectory);
-    worker->moveToThread(&thread);
 
-    connect(&thread, &QThread::started, worker, &Installer::doInstall);
-    connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
-    connect(worker, &Installer::installFinished, this, &Manager::onModpackInstalled);
-    //connect(worker, &Installer::installFinished, &thread, &QThread::quit);
-
-    thread.start();
-    Logger::log("Modpack install thread started.", logPath);
+// Takes the plugin inventory on the thread pool. pluginsScanned is emitted once getInventory() holds it (or still holds the last one, if the scan failed).
+void Manager::doScanPlugins() {
+    TaskGraph * graph = createPipeline();
+    ManagerTasks tasks(*this);
+    auto scanned = std::make_shared<PluginInventory>();
+    graph->addTask("Scanning plugins", [tasks, scanned]() {
+        *scanned = tasks.scanPlugins();
+    }, {}, { "plugin inventory" });
+    connect(graph, &TaskGraph::finished, this, [this, scanned]() {
+        inventory = std::move(*scanned);
+        emit pluginsScanned();
+    });
+    connect(graph, &TaskGraph::failed, this, [this]() { emit pluginsScanned(); });
+    graph->start();
 }
-void Manager::doInstallBepInEx() {
-    std::string installationFilesDirectory = cacheDirectory + "\\BepInEx";
-    Installer * worker = new Installer(installationFilesDirectory, gameDirectory);
-    worker->moveToThread(&thread);
 
-    connect(&thread, &QThread::started, worker, &Installer::doInstallBepInEx);
-    connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
-    connect(worker, &Installer::installBepInExFinished, this, &Manager::onBepInExInstalled);
-    //connect(worker, &Installer::installBepInExFinished, &thread, &QThread::quit);
+/* Switches to another profile. Its files are switched on the thread pool, and the manager only takes
+ * it on as the active profile back on this thread; profileSwitched is emitted either way.
+*/
+void Manager::doSwitchProfile(const std::string &name) {
+    if (name == profile) {
+        emit profileSwitched(true);
+        return;
+    }
 
-    thread.start();
-    Logger::log("BepInEx install thread started.", logPath);
-}
-void Manager::doUninstall() {
-    installer.doUninstall();
+    TaskGraph * graph = createPipeline();
+    ManagerTasks tasks(*this);
+    auto target = std::make_shared<Profile>();
+    graph->addTask("Switching profile", [tasks, name, target]() {
+        if (!tasks.switchProfile(name, *target)) {
+            throw ProfileSwitchException();
+        }
+    }, {}, { "switched profile" });
+    connect(graph, &TaskGraph::finished, this, [this, target]() {
+        setActiveProfile(*target);
+        emit profileSwitched(true);
+    });
+    connect(graph, &TaskGraph::failed, this, [this]() { emit profileSwitched(false); });
+    graph->start();
 }
-void Manager::doFetch() {
-    // Get the latest release URL
-    Logger::log("Grabbing latest release URL...", logPath);
-    std::string latestReleaseURL = this->fetchLatestReleaseURL("m-riley04", "TheWolfPack");
-    std::string filename = "latest_release";
-
-    Downloader * worker     = new Downloader(latestReleaseURL, cacheDirectory, filename);
-    worker->moveToThread(&thread);
 
-    connect(&thread, &QThread::started, worker, &Downloader::doDownloadJson);
-    connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
-    connect(worker, &Downloader::downloadFinished, this, &Manager::onFetched);
-
-    thread.start();
-    Logger::log("Fetch thread started.", logPath);
+/* Restores a release kept in the chunk store as a pipeline: it is rebuilt into the cache, installed from there,
+ * and its details become the installed release's. The cached archive belongs to another release afterwards, so
+ * it is dropped (a reinstall downloads the restored release again). releaseRestored is emitted either way.
+*/
+void Manager::doRestoreRelease(const std::string &version) {
+    TaskGraph * graph = createPipeline();
+    ManagerTasks tasks(*this);
+    graph->addTask("Restoring release", [tasks, version]() {
+        if (!tasks.restoreRelease(version)) {
+            throw ExtractionFailedException();
+        }
+    }, {}, { "restored release" });
+    graph->addTask("Installing restored release", [tasks, version]() {
+        Installer worker(tasks.cacheDirectory + "\\latest_release", tasks.gameDirectory);
+        worker.setStagedInstall(tasks.stagedInstall);
+        worker.setManifest(tasks.getManifestPath(), version);
+        worker.doInstall();
+
+        std::string zip = tasks.cacheDirectory + "\\latest_release.zip";
+        std::string releasePath = tasks.userDataDirectory + "\\installation_release.json";
+        std::string detailsPath = ChunkStore(tasks.cacheDirectory + "\\chunks").detailsPath(version);
+        if (tasks.stagedInstall) {
+            ManagerTasks::copyReleaseDetails(releasePath, tasks.userDataDirectory + "\\previous_release.json");
+        }
+        std::error_code error;
+        std::filesystem::remove(zip, error);
+        std::filesystem::remove(ZipIndex::indexPathFor(zip), error);
+        std::filesystem::remove(PackArchive::packPathFor(zip), error);
+        if (std::filesystem::exists(detailsPath, error)) {
+            std::filesystem::copy_file(detailsPath, releasePath, std::filesystem::copy_options::overwrite_existing, error);
+        } else {
+            std::filesystem::remove(releasePath, error);
+        }
+        Logger::log("Restored release " + version + ".", tasks.logPath);
+    }, { "restored release" }, { "installed release" });
+    connect(graph, &TaskGraph::finished, this, [this]() { emit releaseRestored(true); });
+    connect(graph, &TaskGraph::failed, this, [this, tasks]() {
+        // Don't leave the rebuilt release in the cache next to the installed release's archive
+        try {
+            Trash::remove(tasks.cacheDirectory + "\\latest_release", Trash::trashFor(tasks.cacheDirectory));
+        } catch (std::exception &e) {
+            Logger::log("ERROR: The rebuilt release could not be removed from the cache: " + std::string(e.what()), tasks.logPath);
+        }
+        emit releaseRestored(false);
+    });
+    graph->start();
 }
-void Manager::doUpdateFetch() {
-    std::string filename = "installation_release";
-    // Get the latest release URL
-    Logger::log("Grabbing latest release URL...", logPath);
-    std::string latestReleaseURL = this->fetchLatestReleaseURL("m-riley04", "TheWolfPack");
 
-    Downloader * worker     = new Downloader(latestReleaseURL, userDataDirectory, filename);
-    worker->moveToThread(&thread);
-
-    connect(&thread, &QThread::started, worker, &Downloader::doDownloadJson);
-    connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
-    connect(worker, &Downloader::downloadFinished, this, &Manager::onUpdateFetched);
-
-    thread.start();
-    Logger::log("Update fetch thread started.", logPath);
+// Removes a profile on the thread pool (collecting its unused stored files takes a while), emitting profileRemoved with whether it did
+void Manager::doRemoveProfile(const std::string &name) {
+    TaskGraph * graph = createPipeline();
+    ManagerTasks tasks(*this);
+    auto removed = std::make_shared<bool>(false);
+    graph->addTask("Removing profile", [tasks, name, removed]() {
+        *removed = tasks.removeProfile(name);
+    }, {}, { "removed profile" });
+    connect(graph, &TaskGraph::finished, this, [this, removed]() { emit profileRemoved(*removed); });
+    connect(graph, &TaskGraph::failed, this, [this]() { emit profileRemoved(false); });
+    graph->start();
 }
-void Manager::doUpdateDownload() {
-    std::string filename = "installation_release";
-
-    // Implement threading
-    Downloader* worker      = new Downloader(latestModpackZipUrl, cacheDirectory, filename);
-    worker->moveToThread(&thread);
 
-    connect(&thread, &QThread::started, worker, &Downloader::doDownload);
-    connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
-    connect(worker, &Downloader::downloadFinished, this, &Manager::onUpdateDownloaded);
-
-    thread.start();
-    Logger::log("Modpack update download thread started.", logPath);
+// Rolls back to the previous install on the thread pool, emitting installRolledBack with whether it did
+void Manager::doRollbackInstall() {
+    TaskGraph * graph = createPipeline();
+    ManagerTasks tasks(*this);
+    auto rolledBack = std::make_shared<bool>(false);
+    graph->addTask("Rolling back installation", [tasks, rolledBack]() {
+        *rolledBack = tasks.rollbackInstall();
+    }, {}, { "rolled back installation" });
+    connect(graph, &TaskGraph::finished, this, [this, rolledBack]() { emit installRolledBack(*rolledBack); });
+    connect(graph, &TaskGraph::failed, this, [this]() { emit installRolledBack(false); });
+    graph->start();
 }
-void Manager::doUpdateUnzip() {
-    std::string filename = "latest_release";
-    // Extract the zip file to the cache directory
-    Logger::log("Extracting downloaded zip file...", logPath);
-    std::string zip = cacheDirectory + "\\" + filename + ".zip";
-    std::string output = cacheDirectory + "\\" + filename;
-    ZipHandler::extract(zip, output);
-    Logger::log("Zip file has been extracted.", logPath);
 
-    onUpdateUnzipped();
+/* Plans the space an install or update needs on the thread pool, emitting storagePlanned with the plan for
+ * getRequiredStorage() (and which kind it is, as install and update checks may wait at the same time). An
+ * empty plan is emitted if planning failed, so nothing waits on it forever.
+*/
+void Manager::doPlanStorage(bool update) {
+    TaskGraph * graph = createPipeline();
+    ManagerTasks tasks(*this);
+    auto plan = std::make_shared<SpacePlan>();
+    graph->addTask("Planning storage", [tasks, update, plan]() {
+        *plan = tasks.planStorage(update);
+    }, {}, { "storage plan" });
+    connect(graph, &TaskGraph::finished, this, [this, update, plan]() { emit storagePlanned(update, *plan); });
+    connect(graph, &TaskGraph::failed, this, [this, update]() { emit storagePlanned(update, SpacePlan()); });
+    graph->start();
 }
-void Manager::doUpdateInstall() {
-    std::string installationFilesDirectory = cacheDirectory + "\\latest_release";
-    Installer * worker = new Installer(installationFilesDirectory, gameDirectory);
-    worker->moveToThread(&thread);
 
-    connect(&thread, &QThread::started, worker, &Installer::doInstallUpdate);
-    connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
-    connect(worker, &Installer::installUpdateFinished, this, &Manager::onUpdateInstalled);
-
-    thread.start();
-    Logger::log("Modpack update install thread started.", logPath);
-}
-/*void Manager::onBepInExFetched() {
-    thread.quit();
-    emit bepInExFetched();
-}*/
-void Manager::onBepInExDownloaded() {
-    thread.quit();
-    emit bepInExDownloaded();
-}
-void Manager::onBepInExUnzipped() {
-    emit bepInExUnzipped();
-}
-void Manager::onBepInExInstalled() {
-    thread.quit();
-    emit bepInExInstalled();
+void Manager::doUninstall() {
+    installer.doUninstall();
 }
-void Manager::onModpackFetched() {
-    // Quit the thread
-    thread.quit();
-
-    // Read the downloaded file
-    installedModpackZipUrl = getInstallationRelease().value("zipball_url").toString().toStdString();
 
-    // Emit signal
-    emit modpackFetched();
+//=== PIPELINES
+// Creates a pipeline on the manager's thread pool. It logs its stages and deletes itself once it has ended.
+TaskGraph * Manager::createPipeline() {
+    TaskGraph * graph = new TaskGraph(pool, this);
+    connect(graph, &TaskGraph::taskStarted, this, [this](QString task) {
+        Logger::log(task.toStdString() + "...", logPath);
+    });
+    connect(graph, &TaskGraph::failed, this, [this](QString task, QString error) {
+        Logger::log("ERROR: " + task.toStdString() + " failed: " + error.toStdString(), logPath);
+    });
+    connect(graph, &TaskGraph::finished, graph, &QObject::deleteLater);
+    connect(graph, &TaskGraph::failed, graph, &QObject::deleteLater);
+    return graph;
 }
-void Manager::onModpackDownloaded() {
-    thread.quit();
-    emit modpackDownloaded();
-}
-void Manager::onModpackUnzipped() {
-    emit modpackUnzipped();
-}
-void Manager::onModpackInstalled() {
-    //version = fetchLatestVersion(packUrl);
 
-    thread.quit();
-    emit modpackInstalled();
+/* Adds the tasks that verify a downloaded archive ("<label> archive") and unpack it ("<label> files"):
+ * into memory when it fits the staging budget (leaving the stage in "stage" for the install task),
+ * otherwise into the cache, or nowhere for direct installs. Modpack releases are also recorded in the
+ * chunk store.
+*/
+void Manager::addUnpackTasks(TaskGraph &graph, const ManagerTasks &tasks, const std::string &filename, const std::string &label,
+                             const std::shared_ptr<std::shared_ptr<MemoryStage>> &stage, bool record, void (Manager::*unzipped)()) {
+    graph.addTask("Verifying " + label, [tasks, filename, record]() {
+        // Catch truncated or corrupt downloads before anything is extracted
+        std::string zip = tasks.prepareArchive(filename);
+        if (zip.empty()) {
+            throw CorruptArchiveException();
+        }
+        if (record) {
+            tasks.recordRelease(zip);
+        }
+    }, { label + " archive" }, { label + " verified archive" });
+
+    graph.addTask("Unzipping " + label, [this, tasks, filename, stage, unzipped]() {
+        std::string zip = tasks.cachedArchive(filename);
+        if (tasks.directInstall) {
+            // Direct installs read the archive itself, so there is nothing to stage
+            Logger::log("Skipping extraction to cache (direct install).", tasks.logPath);
+        } else if (!tasks.stageInMemory(zip, *stage)) {
+            // Archives over the memory staging budget are extracted to the cache directory
+            Logger::log("Extracting downloaded zip file...", tasks.logPath);
+            ExtractStats stats;
+            int result = ZipHandler::extract(zip, tasks.cacheDirectory + "\\" + filename, &stats);
+            Logger::log(describeExtraction(stats), tasks.logPath);
+            if (result != 0) {
+                throw ExtractionFailedException();
+            }
+            Logger::log("Zip file has been extracted.", tasks.logPath);
+        }
+        emit (this->*unzipped)();
+    }, { label + " verified archive" }, { label + " files" });
 }
-void Manager::onFetched() {
-    // Quit the thread
-    thread.quit();
 
-    // Read the downloaded file
-    latestModpackZipUrl = getLatestRelease().value("zipball_url").toString().toStdString();
-
-    // Emit signal
-    emit fetched();
+// Installs the unpacked modpack release from wherever it was staged (in memory, when there is a stage)
+void ManagerTasks::installModpackFiles(const std::shared_ptr<MemoryStage> &stage) const {
+    Installer worker(cacheDirectory + "\\latest_release", gameDirectory);
+    if (directInstall) {
+        worker.setArchivePath(cachedArchive("latest_release"));
+    }
+    worker.setMemoryStage(stage);
+    worker.setStagedInstall(stagedInstall);
+    worker.setManifest(getManifestPath(), getInstallationRelease().value("tag_name").toString().toStdString());
+    worker.doInstall();
+
+    // The replaced install is kept for rollbackInstall(), so its release's details are too
+    if (stagedInstall) {
+        copyReleaseDetails(userDataDirectory + "\\replaced_release.json", userDataDirectory + "\\previous_release.json");
+    }
 }
-void Manager::onUpdateFetched() {
-    // Quit the thread
-    thread.quit();
-
-    // Read the downloaded file
-    installedModpackZipUrl = getInstallationRelease().value("zipball_url").toString().toStdString();
 
-    // Emit signal
-    emit updateFetched();
-}
-void Manager::onUpdateDownloaded() {
-    thread.quit();
-    emit updateDownloaded();
-}
-void Manager::onUpdateUnzipped() {
-    emit updateUnzipped();
-}
-void Manager::onUpdateInstalled() {
-    thread.quit();
-    emit updateInstalled();
-}
-void Manager::onUpdateFailed() {
-    thread.quit();
-    emit updateFailed();
+// Copies a release's details over another file's, or removes that file if there are no details to copy
+void ManagerTasks::copyReleaseDetails(const std::string &from, const std::string &to) {
+    std::error_code error;
+    if (std::filesystem::exists(from, error)) {
+        std::filesystem::copy_file(from, to, std::filesystem::copy_options::overwrite_existing, error);
+    } else {
+        std::filesystem::remove(to, error);
+    }
 }
+
 //=== GETTERS
-QJsonObject Manager::getInstallationRelease() {
+QJsonObject ManagerTasks::getInstallationRelease() const {
     std::string path = userDataDirectory + "\\installation_release.json";
     QFile file(QString(path.c_str()));
     if (file.exists() && file.open(QIODevice::ReadOnly)) {
@@ -611,6 +1169,32 @@ QJsonDocument& Manager::getRelease() { return this->release; }
 // Returns the current space avaliable on the game drive as an integer of bytes
 int Manager::getSpaceAvailable() { return std::filesystem::space(std::filesystem::path(gameDrive)).available; }
 
+// Returns the path of the manifest recording every installed file
+std::string ManagerTasks::getManifestPath() const { return userDataDirectory + "\\installed_files.manifest"; }
+
+// Returns the name of the active profile
+std::string Manager::getProfile() { return profile; }
+
+// Returns every profile, including the active one even before it has been saved to the store
+std::vector<Profile> Manager::getProfiles() {
+    std::vector<Profile> profiles = ProfileStore(getProfileStorePath()).profiles();
+    if (std::none_of(profiles.begin(), profiles.end(), [this](const Profile &p) { return p.name == profile; })) {
+        profiles.insert(profiles.begin(), { profile, packOwner, packRepo, version });
+    }
+    return profiles;
+}
+
+// Returns the last plugin inventory taken (see doScanPlugins())
+const PluginInventory &Manager::getInventory() const { return inventory; }
+
+// Returns the web page of the active profile's modpack repository
+std::string Manager::getGithubUrl() { return "https://github.com/" + packOwner + "/" + packRepo; }
+
+/* Returns the profile store's folder. It lives in the game's folder, on the same volume as BepInEx so its
+ * files can be linked, but outside of BepInEx so uninstalling (which may remove all of BepInEx) keeps it.
+*/
+std::string ManagerTasks::getProfileStorePath() const { return gameDirectory + "\\.modpack_profiles"; }
+
 //=== SETTERS
 void Manager::setVersion(std::string version) { this->version = version; }
 
@@ -621,3 +1205,25 @@ void Manager::setDataDirectory(std::string directory) {this->userDataDirectory =
 void Manager::setGameDirectory(std::string directory) { this->gameDirectory = directory; }
 
 void Manager::setLogPath(std::string path) { this->logPath = path; }
+
+void Manager::setDirectInstall(bool enabled) { this->directInstall = enabled; }
+
+void Manager::setRepackCache(bool enabled) { this->repackCache = enabled; }
+
+void Manager::setMemoryStageBudget(qint64 bytes) { this->memoryStageBudget = bytes; }
+
+void Manager::setChunkStore(bool enabled) { this->chunkStore = enabled; }
+
+void Manager::setRetainedReleases(int count) { this->retainedReleases = count; }
+
+void Manager::setStagedInstall(bool enabled) { this->stagedInstall = enabled; }
+
+// Sets the active profile, taking its modpack repository from the store if it has been saved there
+void Manager::setProfile(std::string name) {
+    this->profile = name;
+    Profile stored;
+    if (ProfileStore(getProfileStorePath()).getProfile(name, stored)) {
+        packOwner = stored.owner;
+        packRepo = stored.repo;
+    }
+}
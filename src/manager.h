@@ -2,16 +2,62 @@
 #define MANAGER_H
 
 #include <QObject>
-#include <QThread>
+#include <QThreadPool>
 #include <QStorageInfo>
 #include "downloader.h"
 #include "installer.h"
+#include "profilestore.h"
+#include "plugininventory.h"
+#include "spaceplanner.h"
+#include "taskgraph.h"
 #include <zip.h>
 
-class Manager : public QObject
+/* The settings the manager's tasks read, and the work they do on the pool with them. Each pipeline takes its
+ * own copy of these when it is built, so its tasks never read a setting while the GUI thread changes it.
+*/
+class ManagerTasks
+{
+    friend class Manager;
+public:
+    bool restoreRelease(const std::string &version) const;
+    bool rollbackInstall() const;
+    bool verifyInstall(bool repair) const;
+    PluginInventory scanPlugins() const;
+    bool switchProfile(const std::string &name, Profile &target) const;
+    bool removeProfile(const std::string &name) const;
+    SpacePlan planStorage(bool update) const;
+    bool isEnabled() const;
+    QJsonObject getInstallationRelease() const;
+    std::string getManifestPath() const;
+
+private:
+    bool verifyArchive(const std::string &zip) const;
+    std::string cachedArchive(const std::string &filename) const;
+    std::string prepareArchive(const std::string &filename) const;
+    bool stageInMemory(const std::string &zip, std::shared_ptr<MemoryStage> &stage) const;
+    void recordRelease(const std::string &zip) const;
+    void installModpackFiles(const std::shared_ptr<MemoryStage> &stage) const;
+    std::string getProfileStorePath() const;
+    static void copyReleaseDetails(const std::string &from, const std::string &to);
+
+    std::string gameDirectory;
+    std::string cacheDirectory;
+    std::string userDataDirectory;
+    std::string logPath;
+    bool directInstall = false;
+    bool repackCache = false;
+    qint64 memoryStageBudget = 0;
+    bool chunkStore = false;
+    int retainedReleases = 3;
+    bool stagedInstall = false;
+    std::string profile = "default";
+    std::string packOwner = "m-riley04";
+    std::string packRepo = "TheWolfPack";
+};
+
+class Manager : public QObject, public ManagerTasks
 {
     Q_OBJECT
-    QThread thread;
 public:
     Manager();
     Manager(Manager &m);
@@ -30,12 +76,17 @@ public:
     void clearPlugins();
     void clearConfig();
     void clearPatchers();
+    std::vector<std::string> getStoredReleases();
+
+    //=== PROFILES
+    bool createProfile(const std::string &name, const std::string &owner, const std::string &repo);
+    void setActiveProfile(const Profile &target);
 
     //=== FINDERS
     std::string locateGameLocation();
 
     //=== URL FETCHERS
-    std::string fetchLatestReleaseURL(std::string owner = "m-riley04", std::string repo = "TheWolfPack" );
+    std::string fetchLatestReleaseURL(std::string owner = "", std::string repo = "");
     QJsonDocument fetchLatestRelease(std::string &url);
     std::string fetchReleaseDownload(std::string &url);
     std::string fetchLatestVersion(std::string &url);
@@ -44,11 +95,12 @@ public:
     //=== STATUS
     bool isUpdated();
     bool isBepInExInstalled();
+    bool hasPreviousInstall();
     bool hasEnoughStorage(std::string path, qint64 bytes);
     qint64 getAvailableStorage(std::string path);
+    qint64 getRequiredStorage(std::string path, const SpacePlan &plan);
 
     //=== GETTERS
-    QJsonObject getInstallationRelease();
     QJsonObject getLatestRelease();
     std::string getVersion();
     Downloader &getDownloader();
@@ -56,6 +108,10 @@ public:
     QJsonDocument& getRelease();
     int getSpaceAvailable();
     int getSpaceTotal();
+    std::string getProfile();
+    std::vector<Profile> getProfiles();
+    const PluginInventory &getInventory() const;
+    std::string getGithubUrl();
 
     //=== SETTERS
     void setVersion(std::string version);
@@ -63,6 +119,13 @@ public:
     void setDataDirectory(std::string directory);
     void setGameDirectory(std::string directory);
     void setLogPath(std::string path);
+    void setDirectInstall(bool enabled);
+    void setRepackCache(bool enabled);
+    void setMemoryStageBudget(qint64 bytes);
+    void setChunkStore(bool enabled);
+    void setRetainedReleases(int count);
+    void setStagedInstall(bool enabled);
+    void setProfile(std::string name);
 
 signals:
     //void bepInExFetched();
@@ -85,60 +148,45 @@ signals:
     void updateInstalled();
     void updateFailed();
     void errorOccurred(QString error);
+    void stagesChanged(QString stages);
+    void installVerified(bool intact);
+    void pluginsScanned();
+    void profileSwitched(bool switched);
+    void profileRemoved(bool removed);
+    void releaseRestored(bool restored);
+    void installRolledBack(bool rolledBack);
+    void storagePlanned(bool update, SpacePlan plan);
 
 public slots:
-    // General Fetching
-    void doFetchModpack();
-    void doDownload();
-    void doUnzip();
-    void doInstall();
-    void doUninstall();
-
-    //void doFetchBepInEx();
-    void doDownloadBepInEx();
-    void doUnzipBepInEx();
-    void doInstallBepInEx();
-
-    void onModpackFetched();
-    void onModpackDownloaded();
-    void onModpackUnzipped();
-    void onModpackInstalled();
-
-    //void onBepInExFetched();
-    void onBepInExDownloaded();
-    void onBepInExUnzipped();
-    void onBepInExInstalled();
-
-    // Updating
-    void doUpdateFetch();
-    void doUpdateDownload();
-    void doUpdateUnzip();
-    void doUpdateInstall();
-    void onUpdateFetched();
-    void onUpdateDownloaded();
-    void onUpdateUnzipped();
-    void onUpdateInstalled();
-    void onUpdateFailed();
-
-    // General Fetching
+    // Pipelines
+    void doInstallModpack(bool withBepInEx);
+    void doUpdateModpack();
     void doFetch();
-    void onFetched();
+    void doVerifyInstall(bool repair);
+    void doScanPlugins();
+    void doSwitchProfile(const std::string &name);
+    void doRemoveProfile(const std::string &name);
+    void doRestoreRelease(const std::string &version);
+    void doRollbackInstall();
+    void doPlanStorage(bool update);
+    void doUninstall();
 
 private:
+    TaskGraph * createPipeline();
+    void addUnpackTasks(TaskGraph &graph, const ManagerTasks &tasks, const std::string &filename, const std::string &label,
+                        const std::shared_ptr<std::shared_ptr<MemoryStage>> &stage, bool record, void (Manager::*unzipped)());
+
+    QThreadPool pool;
+
     Downloader downloader;
     Installer installer;
 
     QJsonDocument release;
     std::string version;
-    std::string gameDirectory;
     std::string gameDrive;
 
     std::string packUrl;
-    std::string installedModpackZipUrl;
-    std::string latestModpackZipUrl;
-    std::string cacheDirectory;
-    std::string userDataDirectory;
-    std::string logPath;
+    PluginInventory inventory;
 };
 
 #endif // MANAGER_H
@@ -0,0 +1,35 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+#include <string>
+#include <cstddef>
+
+// A read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile();
+    MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const;
+    const unsigned char * data() const;
+    std::size_t size() const;
+
+private:
+    const unsigned char * mappedData = nullptr;
+    std::size_t mappedSize = 0;
+#ifdef _WIN32
+    void * fileHandle = nullptr;
+    void * mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,132 @@
+#include "memorystage.h"
+#include "iobackend.h"
+#include "backgroundmode.h"
+#include <filesystem>
+#include <iostream>
+#include <unordered_set>
+#include <chrono>
+#include <cstdio>
+
+// Size of an arena block. Files larger than half a block get a block of their own.
+static const std::uint64_t BLOCK_SIZE = 8ull << 20;
+
+MemoryStage::MemoryStage(std::uint64_t budget) : budget(budget) {}
+
+//=== FUNCTIONALITIES
+// Reserves space for a file's contents. Returns nullptr if it would take the stage over budget.
+char * MemoryStage::allocate(std::uint64_t size) {
+    if (size > budget - used) {
+        return nullptr;
+    }
+    used += size;
+
+    if (size > BLOCK_SIZE / 2) {
+        blocks.emplace_back(new char[static_cast<std::size_t>(size)]);
+        return blocks.back().get();
+    }
+    if (size > blockRemaining) {
+        blocks.emplace_back(new char[static_cast<std::size_t>(BLOCK_SIZE)]);
+        blockCursor = blocks.back().get();
+        blockRemaining = BLOCK_SIZE;
+    }
+    char * result = blockCursor;
+    blockCursor += size;
+    blockRemaining -= size;
+    return result;
+}
+
+// Records a staged file whose contents live in memory allocated from this stage
+void MemoryStage::addFile(const std::string &name, const char * data, std::uint64_t size) {
+    files.push_back({ name, data, size });
+}
+
+// Records a directory entry, so empty folders are still created when the stage is written out
+void MemoryStage::addDirectory(const std::string &name) {
+    directories.push_back(name);
+}
+
+/* Writes the staged files to disk, sending each one to the destination of the mapping with the longest
+ * matching prefix (see ZipHandler::extractMapped). Returns 0, or -1 if any file couldn't be written.
+*/
+int MemoryStage::writeTo(const std::vector<PathMapping> &mappings, ExtractStats * stats) const {
+    const auto startTime = std::chrono::steady_clock::now();
+
+    std::unordered_set<std::string> createdDirectories;
+    auto createDirectory = [&](const std::filesystem::path &directory) {
+        if (createdDirectories.insert(directory.string()).second) {
+            std::error_code error;
+            std::filesystem::create_directories(directory, error);
+        }
+    };
+
+    for (const std::string &name : directories) {
+        std::string fullPath;
+        if (ZipHandler::mapEntryPath(name, mappings, fullPath)) {
+            createDirectory(fullPath);
+        }
+    }
+
+    // The staged contents outlive the writes, so the backend can batch as many of them as it likes
+    std::uint64_t filesWritten = 0;
+    std::uint64_t filesFailed = 0;
+    std::uint64_t bytesWritten = 0;
+    std::unique_ptr<IoBackend> backend = IoBackend::create();
+    for (const StagedFile &file : files) {
+        std::string fullPath;
+        if (!ZipHandler::mapEntryPath(file.name, mappings, fullPath)) {
+            continue;
+        }
+        std::filesystem::path path(fullPath);
+        if (path.has_parent_path()) {
+            createDirectory(path.parent_path());
+        }
+
+        BackgroundMode::pace(file.size);
+        backend->write(fullPath, file.data, static_cast<std::size_t>(file.size), [&, fullPath, size = file.size](bool ok) {
+            if (!ok) {
+                std::cerr << "Error writing " << fullPath << "\n";
+                ++filesFailed;
+            } else {
+                ++filesWritten;
+                bytesWritten += size;
+            }
+        });
+    }
+    backend->finish();
+
+    if (stats != nullptr) {
+        stats->files = filesWritten;
+        stats->bytes = bytesWritten;
+        stats->skipped = 0;
+        stats->failed = filesFailed;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+    return filesFailed == 0 ? 0 : -1;
+}
+
+// Releases every staged file and the memory holding them
+void MemoryStage::clear() {
+    files.clear();
+    directories.clear();
+    blocks.clear();
+    blockCursor = nullptr;
+    blockRemaining = 0;
+    used = 0;
+}
+
+//=== GETTERS
+std::uint64_t MemoryStage::getBudget() const { return budget; }
+
+std::uint64_t MemoryStage::getUsed() const { return used; }
+
+// Returns the name of the staged archive's top-level folder (with a trailing slash), or an empty string if it has none
+std::string MemoryStage::findRootFolder() const {
+    std::string first = !directories.empty() ? directories.front() : (!files.empty() ? files.front().name : "");
+    if (!directories.empty() && !files.empty() && files.front().name < first) {
+        first = files.front().name;
+    }
+    size_t separator = first.find('/');
+    return separator != std::string::npos ? first.substr(0, separator + 1) : "";
+}
+
+const std::vector<StagedFile> &MemoryStage::getFiles() const { return files; }
@@ -0,0 +1,48 @@
+#ifndef MEMORYSTAGE_H
+#define MEMORYSTAGE_H
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "ziphandler.h"
+
+// A file held in a memory stage
+struct StagedFile
+{
+    std::string name;
+    const char * data = nullptr;
+    std::uint64_t size = 0;
+};
+
+/* An extracted archive held in memory instead of on disk. File contents are carved out of
+ * large arena blocks, and the total is capped by a budget set when the stage is created.
+*/
+class MemoryStage
+{
+public:
+    MemoryStage(std::uint64_t budget);
+
+    //=== FUNCTIONALITIES
+    char * allocate(std::uint64_t size);
+    void addFile(const std::string &name, const char * data, std::uint64_t size);
+    void addDirectory(const std::string &name);
+    int writeTo(const std::vector<PathMapping> &mappings, ExtractStats * stats = nullptr) const;
+    void clear();
+
+    //=== GETTERS
+    std::uint64_t getBudget() const;
+    std::uint64_t getUsed() const;
+    std::string findRootFolder() const;
+    const std::vector<StagedFile> &getFiles() const;
+
+private:
+    std::uint64_t budget;
+    std::uint64_t used = 0;
+    std::uint64_t blockRemaining = 0;
+    char * blockCursor = nullptr;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::vector<StagedFile> files;
+    std::vector<std::string> directories;
+};
+
+#endif // MEMORYSTAGE_H
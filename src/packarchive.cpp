@@ -0,0 +1,427 @@
+#include "packarchive.h"
+#include "mappedfile.h"
+#include "zipindex.h"
+#include "backgroundmode.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <zlib.h>
+#include <zstd.h>
+
+// Layout of the container
+static const char PACK_MAGIC[4] = { 'Z', 'P', 'K', '1' };
+static const char FOOTER_MAGIC[4] = { 'Z', 'P', 'K', 'F' };
+static const std::uint32_t PACK_VERSION = 1;
+static const std::size_t FOOTER_SIZE = 24;
+
+// Files are grouped into frames of about this many (uncompressed) bytes
+static const std::uint64_t FRAME_TARGET_SIZE = 4ull << 20;
+
+// A zstd frame within the container
+struct PackFrame
+{
+    std::uint64_t offset = 0;
+    std::uint64_t compressedSize = 0;
+    std::uint64_t uncompressedSize = 0;
+};
+
+// A file (or directory, when the name ends with '/') stored in a frame
+struct PackFile
+{
+    std::string name;
+    std::uint32_t frame = 0;
+    std::uint64_t offset = 0;
+    std::uint64_t size = 0;
+    std::uint32_t crc = 0;
+};
+
+// The frame and file tables of a container
+struct PackLayout
+{
+    std::vector<PackFrame> frames;
+    std::vector<PackFile> files;
+};
+
+// Little-endian encoding helpers
+static void put32(std::string &out, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) { out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF)); }
+}
+static void put64(std::string &out, std::uint64_t value) {
+    for (int i = 0; i < 8; ++i) { out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF)); }
+}
+static std::uint64_t get(const unsigned char * p, int bytes) {
+    std::uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; --i) { value = (value << 8) | p[i]; }
+    return value;
+}
+
+// Returns how many worker threads to run (fewer in background mode)
+static unsigned workerCount() {
+    return BackgroundMode::capWorkers(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+// Reads the frame and file tables of a mapped container. Returns false if they are missing or out of bounds.
+static bool readLayout(const MappedFile &pack, PackLayout &layout) {
+    const unsigned char * data = pack.data();
+    const std::size_t size = pack.size();
+    if (size < sizeof(PACK_MAGIC) + FOOTER_SIZE || std::memcmp(data, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0) {
+        return false;
+    }
+
+    const unsigned char * footer = data + size - FOOTER_SIZE;
+    if (std::memcmp(footer + 16, FOOTER_MAGIC, sizeof(FOOTER_MAGIC)) != 0 || get(footer + 20, 4) != PACK_VERSION) {
+        return false;
+    }
+    std::uint64_t tablesOffset = get(footer, 8);
+    std::uint64_t tablesSize = get(footer + 8, 8);
+    // Values read from the file are compared by subtraction, never summed, so a crafted one can't wrap around
+    if (tablesOffset < sizeof(PACK_MAGIC) || tablesOffset > size - FOOTER_SIZE || tablesSize != size - FOOTER_SIZE - tablesOffset) {
+        return false;
+    }
+
+    const unsigned char * cursor = data + tablesOffset;
+    const unsigned char * end = cursor + tablesSize;
+
+    // Frame table
+    if (end - cursor < 8) { return false; }
+    std::uint64_t frameCount = get(cursor, 8);
+    cursor += 8;
+    if (frameCount > static_cast<std::uint64_t>(end - cursor) / 24) { return false; }
+    layout.frames.resize(static_cast<std::size_t>(frameCount));
+    for (PackFrame &frame : layout.frames) {
+        frame.offset = get(cursor, 8);
+        frame.compressedSize = get(cursor + 8, 8);
+        frame.uncompressedSize = get(cursor + 16, 8);
+        cursor += 24;
+        if (frame.offset < sizeof(PACK_MAGIC) || frame.offset > tablesOffset || frame.compressedSize > tablesOffset - frame.offset) {
+            return false;
+        }
+    }
+
+    // File table
+    if (end - cursor < 8) { return false; }
+    std::uint64_t fileCount = get(cursor, 8);
+    cursor += 8;
+    layout.files.clear();
+    layout.files.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(fileCount, tablesSize / 28)));
+    for (std::uint64_t i = 0; i < fileCount; ++i) {
+        if (end - cursor < 28) { return false; }
+        PackFile file;
+        file.frame = static_cast<std::uint32_t>(get(cursor, 4));
+        file.offset = get(cursor + 4, 8);
+        file.size = get(cursor + 12, 8);
+        file.crc = static_cast<std::uint32_t>(get(cursor + 20, 4));
+        std::uint32_t nameLength = static_cast<std::uint32_t>(get(cursor + 24, 4));
+        cursor += 28;
+        if (nameLength > static_cast<std::uint64_t>(end - cursor) || file.frame >= layout.frames.size()
+            || file.offset > layout.frames[file.frame].uncompressedSize
+            || file.size > layout.frames[file.frame].uncompressedSize - file.offset) {
+            return false;
+        }
+        file.name.assign(reinterpret_cast<const char *>(cursor), nameLength);
+        cursor += nameLength;
+        layout.files.push_back(std::move(file));
+    }
+    return true;
+}
+
+PackArchive::PackArchive() {}
+
+//=== FUNCTIONALITIES
+// Returns where the repacked copy of an archive is stored
+std::string PackArchive::packPathFor(const std::string &archivePath) {
+    return archivePath + ".zpk";
+}
+
+// Returns whether a path names a repacked container
+bool PackArchive::isPack(const std::string &path) {
+    return path.size() > 4 && path.compare(path.size() - 4, 4, ".zpk") == 0;
+}
+
+/* Repacks a release zip into a zstd container. Every entry is decoded and CRC-checked first,
+ * frames are compressed in parallel, and the container only replaces packPath once it is complete.
+ * Returns false if the zip can't be fully decoded.
+*/
+bool PackArchive::transcode(const std::string &zipPath, const std::string &packPath, int level) {
+    MappedFile zip(zipPath);
+    if (!zip.isOpen()) {
+        return false;
+    }
+
+    // List the entries in name order
+    std::vector<ZipEntry> entries;
+    ZipIndex zipIndex;
+    if (zipIndex.open(zipPath)) {
+        entries = zipIndex.entries();
+    } else if (ZipHandler::readCentralDirectory(zip.data(), zip.size(), entries)) {
+        std::sort(entries.begin(), entries.end(), [](const ZipEntry &a, const ZipEntry &b) { return a.name < b.name; });
+    } else {
+        return false;
+    }
+    for (const ZipEntry &entry : entries) {
+        if ((entry.flags & 1) || (entry.method != 0 && entry.method != 8) || entry.uncompressedSize > 0xFFFFFFFFull) {
+            return false;
+        }
+    }
+
+    // Group the entries into frames
+    PackLayout layout;
+    std::vector<std::vector<std::size_t>> frameEntries;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        const ZipEntry &entry = entries[i];
+        if (frameEntries.empty() || (layout.frames.back().uncompressedSize > 0
+                                     && layout.frames.back().uncompressedSize + entry.uncompressedSize > FRAME_TARGET_SIZE)) {
+            layout.frames.emplace_back();
+            frameEntries.emplace_back();
+        }
+
+        PackFile file;
+        file.name = entry.name;
+        file.frame = static_cast<std::uint32_t>(layout.frames.size() - 1);
+        file.offset = layout.frames.back().uncompressedSize;
+        file.size = entry.uncompressedSize;
+        file.crc = entry.crc;
+        layout.files.push_back(file);
+
+        layout.frames.back().uncompressedSize += entry.uncompressedSize;
+        frameEntries.back().push_back(i);
+    }
+
+    std::string temporaryPath = packPath + ".tmp";
+    std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+    out.write(PACK_MAGIC, sizeof(PACK_MAGIC));
+    std::uint64_t position = sizeof(PACK_MAGIC);
+
+    // Compress the frames a batch at a time, writing each batch out in order
+    const std::size_t batchSize = workerCount();
+    bool failed = false;
+    for (std::size_t batchStart = 0; batchStart < layout.frames.size() && !failed; batchStart += batchSize) {
+        std::size_t batchEnd = std::min(layout.frames.size(), batchStart + batchSize);
+        std::vector<std::string> compressed(batchEnd - batchStart);
+        std::atomic<bool> batchFailed(false);
+
+        std::vector<std::thread> workers;
+        for (std::size_t frameIndex = batchStart; frameIndex < batchEnd; ++frameIndex) {
+            workers.emplace_back([&, frameIndex]() {
+                std::vector<char> raw(static_cast<std::size_t>(layout.frames[frameIndex].uncompressedSize));
+                std::size_t offset = 0;
+                for (std::size_t entryIndex : frameEntries[frameIndex]) {
+                    if (!ZipHandler::decodeEntry(zip.data(), zip.size(), entries[entryIndex], raw.data() + offset)) {
+                        std::cerr << "Error decoding " << entries[entryIndex].name << " for repacking\n";
+                        batchFailed = true;
+                        return;
+                    }
+                    offset += static_cast<std::size_t>(entries[entryIndex].uncompressedSize);
+                }
+
+                std::string &result = compressed[frameIndex - batchStart];
+                result.resize(ZSTD_compressBound(raw.size()));
+                std::size_t length = ZSTD_compress(&result[0], result.size(), raw.data(), raw.size(), level);
+                if (ZSTD_isError(length)) {
+                    std::cerr << "Error compressing frame: " << ZSTD_getErrorName(length) << "\n";
+                    batchFailed = true;
+                    return;
+                }
+                result.resize(length);
+            });
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        failed = batchFailed;
+
+        for (std::size_t frameIndex = batchStart; frameIndex < batchEnd && !failed; ++frameIndex) {
+            const std::string &frame = compressed[frameIndex - batchStart];
+            layout.frames[frameIndex].offset = position;
+            layout.frames[frameIndex].compressedSize = frame.size();
+            out.write(frame.data(), frame.size());
+            position += frame.size();
+        }
+    }
+
+    // Append the tables and the footer
+    std::string tables;
+    put64(tables, layout.frames.size());
+    for (const PackFrame &frame : layout.frames) {
+        put64(tables, frame.offset);
+        put64(tables, frame.compressedSize);
+        put64(tables, frame.uncompressedSize);
+    }
+    put64(tables, layout.files.size());
+    for (const PackFile &file : layout.files) {
+        put32(tables, file.frame);
+        put64(tables, file.offset);
+        put64(tables, file.size);
+        put32(tables, file.crc);
+        put32(tables, static_cast<std::uint32_t>(file.name.size()));
+        tables += file.name;
+    }
+
+    std::string footer;
+    put64(footer, position);
+    put64(footer, tables.size());
+    footer.append(FOOTER_MAGIC, sizeof(FOOTER_MAGIC));
+    put32(footer, PACK_VERSION);
+
+    out.write(tables.data(), tables.size());
+    out.write(footer.data(), footer.size());
+    out.close();
+
+    std::error_code error;
+    if (failed || !out) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    std::filesystem::rename(temporaryPath, packPath, error);
+    return !error;
+}
+
+/* Extracts the files under the given prefixes, decompressing frames in parallel.
+ * Frames holding no requested files are never decompressed. Returns 0, or -1 if the container
+ * can't be read or any frame or file failed.
+*/
+int PackArchive::extract(const std::string &packPath, const std::vector<PathMapping> &mappings, ExtractStats * stats) {
+    const auto startTime = std::chrono::steady_clock::now();
+
+    MappedFile pack(packPath);
+    PackLayout layout;
+    if (!pack.isOpen() || !readLayout(pack, layout)) {
+        std::cerr << "Error opening pack: " << packPath << "\n";
+        return -1;
+    }
+
+    // Work out where each file goes, and which frames are needed at all
+    std::vector<std::string> outputPaths(layout.files.size());
+    std::vector<std::vector<std::size_t>> frameFiles(layout.frames.size());
+    for (std::size_t i = 0; i < layout.files.size(); ++i) {
+        if (ZipHandler::mapEntryPath(layout.files[i].name, mappings, outputPaths[i])) {
+            frameFiles[layout.files[i].frame].push_back(i);
+        }
+    }
+
+    std::atomic<std::size_t> nextFrame(0);
+    std::atomic<std::uint64_t> filesWritten(0);
+    std::atomic<std::uint64_t> filesFailed(0);
+    std::atomic<std::uint64_t> bytesWritten(0);
+
+    auto work = [&]() {
+        BackgroundMode::lowerThreadPriority();
+        std::vector<char> buffer;
+        for (std::size_t frameIndex = nextFrame++; frameIndex < layout.frames.size(); frameIndex = nextFrame++) {
+            if (frameFiles[frameIndex].empty()) {
+                continue;
+            }
+
+            // Decompress the whole frame at once
+            const PackFrame &frame = layout.frames[frameIndex];
+            buffer.resize(static_cast<std::size_t>(frame.uncompressedSize));
+            std::size_t length = ZSTD_decompress(buffer.data(), buffer.size(), pack.data() + frame.offset,
+                                                 static_cast<std::size_t>(frame.compressedSize));
+            if (ZSTD_isError(length) || length != buffer.size()) {
+                std::cerr << "Error decompressing frame " << frameIndex << " of " << packPath << "\n";
+                filesFailed += frameFiles[frameIndex].size();
+                continue;
+            }
+
+            // Write out each file in the frame
+            for (std::size_t fileIndex : frameFiles[frameIndex]) {
+                const PackFile &file = layout.files[fileIndex];
+                const std::string &fullPath = outputPaths[fileIndex];
+                std::error_code error;
+                if (fullPath.back() == '/') {
+                    std::filesystem::create_directories(fullPath, error);
+                    continue;
+                }
+                std::filesystem::create_directories(std::filesystem::path(fullPath).parent_path(), error);
+
+                const char * contents = buffer.data() + file.offset;
+                std::uint32_t crc = static_cast<std::uint32_t>(crc32_z(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef *>(contents),
+                                                                       static_cast<z_size_t>(file.size)));
+                BackgroundMode::pace(file.size);
+                std::FILE * output = ZipHandler::createFile(fullPath);
+                bool written = crc == file.crc && output != nullptr
+                               && std::fwrite(contents, 1, static_cast<std::size_t>(file.size), output) == file.size;
+                if (output != nullptr && std::fclose(output) != 0) {
+                    written = false;
+                }
+                if (written) {
+                    ++filesWritten;
+                    bytesWritten += file.size;
+                } else {
+                    std::cerr << "Error extracting " << fullPath << "\n";
+                    ++filesFailed;
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < workerCount(); ++i) {
+        workers.emplace_back(work);
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    if (stats != nullptr) {
+        stats->files = filesWritten;
+        stats->bytes = bytesWritten;
+        stats->skipped = 0;
+        stats->failed = filesFailed;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+    return filesFailed > 0 ? -1 : 0;
+}
+
+// Checks that a container's tables are present and every frame lies inside it. Describes the first problem found in "problem".
+bool PackArchive::verify(const std::string &packPath, std::string &problem) {
+    MappedFile pack(packPath);
+    if (!pack.isOpen()) {
+        problem = "the pack could not be opened";
+        return false;
+    }
+
+    PackLayout layout;
+    if (!readLayout(pack, layout)) {
+        problem = "the pack's tables are missing or damaged";
+        return false;
+    }
+    return true;
+}
+
+// Returns the name of the pack's top-level folder (with a trailing slash), or an empty string if it has none
+std::string PackArchive::findRootFolder(const std::string &packPath) {
+    MappedFile pack(packPath);
+    PackLayout layout;
+    if (!pack.isOpen() || !readLayout(pack, layout) || layout.files.empty()) {
+        return "";
+    }
+
+    const std::string &name = layout.files.front().name;
+    std::size_t separator = name.find('/');
+    return separator != std::string::npos ? name.substr(0, separator + 1) : "";
+}
+
+// Returns the name, size and CRC of everything stored in the container, as archive entries
+std::vector<ZipEntry> PackArchive::listEntries(const std::string &packPath) {
+    std::vector<ZipEntry> entries;
+    MappedFile pack(packPath);
+    PackLayout layout;
+    if (!pack.isOpen() || !readLayout(pack, layout)) {
+        return entries;
+    }
+    for (const PackFile &file : layout.files) {
+        ZipEntry entry;
+        entry.name = file.name;
+        entry.uncompressedSize = file.size;
+        entry.crc = file.crc;
+        entries.push_back(entry);
+    }
+    return entries;
+}
@@ -0,0 +1,28 @@
+#ifndef PACKARCHIVE_H
+#define PACKARCHIVE_H
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "ziphandler.h"
+
+/* A cached release repacked into independent zstd frames, stored as "<archive>.zpk".
+ * Files are grouped (in name order) into frames of about 4 MB, or one frame each for larger
+ * files, so frames can be decompressed in parallel. The frame and file tables sit at the end
+ * of the container, followed by a fixed-size footer pointing back to them.
+*/
+class PackArchive
+{
+public:
+    PackArchive();
+
+    //=== FUNCTIONALITIES
+    static std::string packPathFor(const std::string &archivePath);
+    static bool isPack(const std::string &path);
+    static bool transcode(const std::string &zipPath, const std::string &packPath, int level = 12);
+    static int extract(const std::string &packPath, const std::vector<PathMapping> &mappings, ExtractStats * stats = nullptr);
+    static bool verify(const std::string &packPath, std::string &problem);
+    static std::string findRootFolder(const std::string &packPath);
+    static std::vector<ZipEntry> listEntries(const std::string &packPath);
+};
+
+#endif // PACKARCHIVE_H
@@ -0,0 +1,341 @@
+#include "packbuilder.h"
+#include "mappedfile.h"
+#include "zipindex.h"
+#include "sha256.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+// Files are compressed in blocks of this size, each primed with the 32 KB before it
+static const std::uint64_t BLOCK_SIZE = 256ull << 10;
+static const std::uint64_t DICTIONARY_SIZE = 32ull << 10;
+
+// Fixed MS-DOS date (1980-01-01) and time stamped on every entry
+static const std::uint16_t ENTRY_DATE = (1 << 5) | 1;
+static const std::uint16_t ENTRY_TIME = 0;
+
+// Folders taken from the pack directory
+static const char * PACK_FOLDERS[] = { "plugins", "patchers", "config" };
+
+// An entry to be written to the archive
+struct BuildEntry
+{
+    std::string name;
+    std::string sourcePath;
+    std::uint64_t size = 0;
+    std::vector<std::string> blocks;
+    std::vector<std::uint32_t> blockCrcs;
+    std::vector<char> blockFailed;
+    std::string hash;
+};
+
+// A block of a file to be compressed by a worker
+struct BuildUnit
+{
+    std::size_t entry = 0;
+    std::size_t block = 0;
+};
+
+// Little-endian encoding helpers
+static void put16(std::string &out, std::uint16_t value) {
+    for (int i = 0; i < 2; ++i) { out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF)); }
+}
+static void put32(std::string &out, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) { out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF)); }
+}
+
+static std::size_t blockCount(std::uint64_t size) {
+    return size == 0 ? 1 : static_cast<std::size_t>((size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+}
+
+/* Compresses one block of a file as part of a raw DEFLATE stream. Every block but the last ends on a
+ * sync flush (a byte boundary that isn't the final block), so the blocks can simply be joined.
+*/
+static bool compressBlock(const unsigned char * data, std::uint64_t size, std::size_t block, int level, std::string &output, std::uint32_t &crc) {
+    std::uint64_t start = block * BLOCK_SIZE;
+    std::uint64_t length = std::min<std::uint64_t>(BLOCK_SIZE, size - start);
+    bool last = start + length == size;
+
+    z_stream stream = {};
+    if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    if (start > 0) {
+        std::uint64_t dictionary = std::min(start, DICTIONARY_SIZE);
+        deflateSetDictionary(&stream, data + start - dictionary, static_cast<uInt>(dictionary));
+    }
+
+    output.resize(deflateBound(&stream, static_cast<uLong>(length)) + 16);
+    stream.next_in = const_cast<Bytef *>(length > 0 ? data + start : reinterpret_cast<const Bytef *>(""));
+    stream.avail_in = static_cast<uInt>(length);
+    stream.next_out = reinterpret_cast<Bytef *>(&output[0]);
+    stream.avail_out = static_cast<uInt>(output.size());
+    int status = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    bool complete = last ? status == Z_STREAM_END : (status == Z_OK && stream.avail_in == 0 && stream.avail_out > 0);
+    output.resize(output.size() - stream.avail_out);
+    deflateEnd(&stream);
+
+    crc = static_cast<std::uint32_t>(crc32_z(crc32(0L, Z_NULL, 0), length > 0 ? data + start : Z_NULL, static_cast<z_size_t>(length)));
+    return complete;
+}
+
+// Lists the pack's folders as archive entries under the root folder, sorted by name
+static std::vector<BuildEntry> listEntries(const std::filesystem::path &packDirectory, const std::string &root) {
+    std::vector<BuildEntry> entries;
+    BuildEntry rootEntry;
+    rootEntry.name = root;
+    entries.push_back(rootEntry);
+
+    for (const char * folder : PACK_FOLDERS) {
+        std::filesystem::path folderPath = packDirectory / folder;
+        if (!std::filesystem::is_directory(folderPath)) {
+            continue;
+        }
+
+        BuildEntry folderEntry;
+        folderEntry.name = root + folder + "/";
+        entries.push_back(folderEntry);
+        for (const auto &item : std::filesystem::recursive_directory_iterator(folderPath)) {
+            BuildEntry entry;
+            entry.name = root + std::filesystem::relative(item.path(), packDirectory).generic_string();
+            if (item.is_directory()) {
+                entry.name += "/";
+            } else if (item.is_regular_file()) {
+                entry.sourcePath = item.path().string();
+                entry.size = item.file_size();
+            } else {
+                continue;
+            }
+            entries.push_back(entry);
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const BuildEntry &a, const BuildEntry &b) { return a.name < b.name; });
+    return entries;
+}
+
+PackBuilder::PackBuilder() {}
+
+//=== FUNCTIONALITIES
+// Returns where the hash manifest for an archive is written
+std::string PackBuilder::manifestPathFor(const std::string &archivePath) {
+    return archivePath + ".sha256";
+}
+
+/* Builds the release archive. The archive and manifest only replace existing ones once they are
+ * complete and the archive has been read back. Returns false if any file couldn't be read or compressed.
+*/
+bool PackBuilder::build(const std::string &packDirectory, const std::string &archivePath, int level, unsigned threads) {
+    std::filesystem::path packPath = std::filesystem::path(packDirectory).lexically_normal();
+    if (!packPath.has_filename()) {
+        packPath = packPath.parent_path();
+    }
+    if (!std::filesystem::is_directory(packPath)) {
+        std::cerr << "Error: " << packDirectory << " is not a directory\n";
+        return false;
+    }
+    std::string root = packPath.filename().string() + "/";
+
+    std::vector<BuildEntry> entries = listEntries(packPath, root);
+    std::vector<BuildUnit> units;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].sourcePath.empty()) {
+            continue;
+        }
+        std::size_t count = blockCount(entries[i].size);
+        entries[i].blocks.resize(count);
+        entries[i].blockCrcs.resize(count);
+        entries[i].blockFailed.resize(count, 0);
+        for (std::size_t block = 0; block < count; ++block) {
+            units.push_back({ i, block });
+        }
+    }
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::string temporaryPath = archivePath + ".tmp";
+    std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+    std::string centralDirectory;
+    std::uint64_t position = 0;
+    std::size_t nextEntry = 0;
+    bool failed = false;
+
+    // Writes out every entry before "end" whose blocks are all compressed, releasing their blocks
+    auto writeEntries = [&](std::size_t end) {
+        for (; nextEntry < end && !failed; ++nextEntry) {
+            BuildEntry &entry = entries[nextEntry];
+            if (std::find(entry.blockFailed.begin(), entry.blockFailed.end(), 1) != entry.blockFailed.end()) {
+                std::cerr << "Error compressing " << entry.sourcePath << "\n";
+                failed = true;
+                break;
+            }
+
+            // Join the blocks, falling back to storing the file if compressing didn't help
+            std::uint32_t crc = static_cast<std::uint32_t>(crc32(0L, Z_NULL, 0));
+            std::uint64_t compressedSize = 0;
+            for (std::size_t block = 0; block < entry.blocks.size(); ++block) {
+                std::uint64_t length = std::min<std::uint64_t>(BLOCK_SIZE, entry.size - block * BLOCK_SIZE);
+                crc = static_cast<std::uint32_t>(crc32_combine(crc, entry.blockCrcs[block], static_cast<z_off_t>(length)));
+                compressedSize += entry.blocks[block].size();
+            }
+            bool isDirectory = entry.sourcePath.empty();
+            std::uint16_t method = (isDirectory || compressedSize >= entry.size) ? 0 : 8;
+            if (method == 0) {
+                compressedSize = entry.size;
+            }
+            if (position > 0xFFFFFFFEull || entry.size > 0xFFFFFFFEull) {
+                std::cerr << "Error: the pack is too large for a plain zip\n";
+                failed = true;
+                break;
+            }
+
+            std::string header;
+            put32(header, 0x04034b50);
+            put16(header, method == 8 ? 20 : 10);
+            put16(header, 0x0800);
+            put16(header, method);
+            put16(header, ENTRY_TIME);
+            put16(header, ENTRY_DATE);
+            put32(header, isDirectory ? 0 : crc);
+            put32(header, static_cast<std::uint32_t>(compressedSize));
+            put32(header, static_cast<std::uint32_t>(entry.size));
+            put16(header, static_cast<std::uint16_t>(entry.name.size()));
+            put16(header, 0);
+            header += entry.name;
+            out.write(header.data(), header.size());
+
+            if (method == 8) {
+                for (const std::string &block : entry.blocks) {
+                    out.write(block.data(), block.size());
+                }
+            } else if (entry.size > 0) {
+                MappedFile source(entry.sourcePath);
+                if (!source.isOpen() || source.size() != entry.size) {
+                    std::cerr << "Error reading " << entry.sourcePath << "\n";
+                    failed = true;
+                    break;
+                }
+                out.write(reinterpret_cast<const char *>(source.data()), source.size());
+            }
+
+            put32(centralDirectory, 0x02014b50);
+            put16(centralDirectory, 20);
+            put16(centralDirectory, method == 8 ? 20 : 10);
+            put16(centralDirectory, 0x0800);
+            put16(centralDirectory, method);
+            put16(centralDirectory, ENTRY_TIME);
+            put16(centralDirectory, ENTRY_DATE);
+            put32(centralDirectory, isDirectory ? 0 : crc);
+            put32(centralDirectory, static_cast<std::uint32_t>(compressedSize));
+            put32(centralDirectory, static_cast<std::uint32_t>(entry.size));
+            put16(centralDirectory, static_cast<std::uint16_t>(entry.name.size()));
+            put16(centralDirectory, 0);
+            put16(centralDirectory, 0);
+            put16(centralDirectory, 0);
+            put16(centralDirectory, 0);
+            put32(centralDirectory, isDirectory ? 0x10 : 0);
+            put32(centralDirectory, static_cast<std::uint32_t>(position));
+            centralDirectory += entry.name;
+
+            position += header.size() + compressedSize;
+            entry.blocks.clear();
+            entry.blocks.shrink_to_fit();
+        }
+    };
+
+    // Compress the blocks a batch at a time, writing out each entry once all of its blocks are done
+    const std::size_t batchSize = static_cast<std::size_t>(threads) * 8;
+    for (std::size_t batchStart = 0; batchStart < units.size() && !failed; batchStart += batchSize) {
+        std::size_t batchEnd = std::min(units.size(), batchStart + batchSize);
+        std::atomic<std::size_t> nextUnit(batchStart);
+
+        auto work = [&]() {
+            for (std::size_t unitIndex = nextUnit++; unitIndex < batchEnd; unitIndex = nextUnit++) {
+                BuildEntry &entry = entries[units[unitIndex].entry];
+                std::size_t block = units[unitIndex].block;
+                MappedFile source;
+                if (entry.size > 0 && (!source.open(entry.sourcePath) || source.size() != entry.size)) {
+                    entry.blockFailed[block] = 1;
+                    continue;
+                }
+                if (!compressBlock(source.data(), entry.size, block, level, entry.blocks[block], entry.blockCrcs[block])) {
+                    entry.blockFailed[block] = 1;
+                }
+
+                // The first block's worker also hashes the whole file for the manifest
+                if (block == 0) {
+                    entry.hash = Sha256::hash(source.data(), static_cast<std::size_t>(entry.size));
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < threads; ++i) {
+            workers.emplace_back(work);
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+
+        // Entries before the batch's last one are complete; the last may continue into the next batch
+        std::size_t lastEntry = units[batchEnd - 1].entry;
+        bool lastComplete = batchEnd == units.size() || units[batchEnd].entry != lastEntry;
+        writeEntries(lastComplete ? lastEntry + 1 : lastEntry);
+    }
+    writeEntries(entries.size());
+
+    // End of central directory record
+    if (!failed && (entries.size() > 0xFFFE || position + centralDirectory.size() > 0xFFFFFFFEull)) {
+        std::cerr << "Error: the pack is too large for a plain zip\n";
+        failed = true;
+    }
+    std::string end;
+    put32(end, 0x06054b50);
+    put16(end, 0);
+    put16(end, 0);
+    put16(end, static_cast<std::uint16_t>(entries.size()));
+    put16(end, static_cast<std::uint16_t>(entries.size()));
+    put32(end, static_cast<std::uint32_t>(centralDirectory.size()));
+    put32(end, static_cast<std::uint32_t>(position));
+    put16(end, 0);
+    out.write(centralDirectory.data(), centralDirectory.size());
+    out.write(end.data(), end.size());
+    out.close();
+
+    std::string problem;
+    if (failed || !out || !ZipIndex::verifyArchive(temporaryPath, problem)) {
+        if (!problem.empty()) {
+            std::cerr << "Error: the built archive is unreadable: " << problem << "\n";
+        }
+        std::error_code error;
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    // Write the manifest in the same order as the archive
+    std::string manifestPath = manifestPathFor(archivePath);
+    {
+        std::ofstream manifest(manifestPath + ".tmp", std::ios::binary | std::ios::trunc);
+        for (const BuildEntry &entry : entries) {
+            if (!entry.sourcePath.empty()) {
+                manifest << entry.hash << "  " << entry.name << "\n";
+            }
+        }
+        if (!manifest) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, archivePath, error);
+    if (!error) {
+        std::filesystem::rename(manifestPath + ".tmp", manifestPath, error);
+    }
+    return !error;
+}
@@ -0,0 +1,22 @@
+#ifndef PACKBUILDER_H
+#define PACKBUILDER_H
+#include <string>
+#include <cstdint>
+
+/* Builds a modpack release zip from a pack folder's plugins, patchers and config subtrees.
+ * Every entry is compressed as its own DEFLATE stream, and large files are split into blocks
+ * that are compressed in parallel and joined pigz-style. Entries are sorted and carry fixed
+ * timestamps, so the same input always produces the same archive. A "sha256sum"-style manifest
+ * of every file is written next to the archive.
+*/
+class PackBuilder
+{
+public:
+    PackBuilder();
+
+    //=== FUNCTIONALITIES
+    static std::string manifestPathFor(const std::string &archivePath);
+    static bool build(const std::string &packDirectory, const std::string &archivePath, int level = 9, unsigned threads = 0);
+};
+
+#endif // PACKBUILDER_H
@@ -0,0 +1,559 @@
+#include "plugininventory.h"
+#include "mappedfile.h"
+#include "backgroundmode.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+
+// First line of a cache file, so older or foreign files are rejected
+static const char * CACHE_HEADER = "INVENTORY 1";
+
+// Metadata tables this reader looks into, by number (ECMA-335 II.22)
+static const int TYPE_REF = 0x01;
+static const int MEMBER_REF = 0x0A;
+static const int CUSTOM_ATTRIBUTE = 0x0C;
+static const int ASSEMBLY = 0x20;
+
+// Column kinds of a metadata table
+enum ColumnKind { FIXED, STRING, GUID, BLOB, TABLE, CODED };
+
+struct Column
+{
+    ColumnKind kind;
+    int argument;       // Bytes for FIXED, table number for TABLE, coded index kind for CODED
+};
+
+// Coded index kinds, each a table number tagged with the low bits saying which table (-1 marks unused tags)
+enum CodedKind { TYPE_DEF_OR_REF, HAS_CONSTANT, HAS_CUSTOM_ATTRIBUTE, HAS_FIELD_MARSHAL, HAS_DECL_SECURITY, MEMBER_REF_PARENT,
+                 HAS_SEMANTICS, METHOD_DEF_OR_REF, MEMBER_FORWARDED, CUSTOM_ATTRIBUTE_TYPE, RESOLUTION_SCOPE };
+
+struct CodedIndex
+{
+    int tagBits;
+    std::vector<int> tables;
+};
+
+static const CodedIndex CODED_INDEXES[] = {
+    { 2, { 0x02, 0x01, 0x1B } },
+    { 2, { 0x04, 0x08, 0x17 } },
+    { 5, { 0x06, 0x04, 0x01, 0x02, 0x08, 0x09, 0x0A, 0x00, 0x0E, 0x17, 0x14, 0x11, 0x1A, 0x1B, 0x20, 0x23, 0x26, 0x27, 0x28, 0x2A, 0x2C, 0x2B } },
+    { 1, { 0x04, 0x08 } },
+    { 2, { 0x02, 0x06, 0x20 } },
+    { 3, { 0x02, 0x01, 0x1A, 0x06, 0x1B } },
+    { 1, { 0x14, 0x17 } },
+    { 1, { 0x06, 0x0A } },
+    { 1, { 0x04, 0x06 } },
+    { 3, { -1, -1, 0x06, 0x0A, -1 } },
+    { 2, { 0x00, 0x1A, 0x23, 0x01 } },
+};
+
+// Tag of a TypeRef in a MemberRefParent, and of a MemberRef in a CustomAttributeType
+static const std::uint32_t MEMBER_REF_PARENT_TYPE_REF = 1;
+static const std::uint32_t CUSTOM_ATTRIBUTE_TYPE_MEMBER_REF = 3;
+
+// Columns of every table up to Assembly, which is all that has to be sized to find the tables read here
+static const std::vector<Column> TABLE_COLUMNS[] = {
+    /* 0x00 Module */          { { FIXED, 2 }, { STRING, 0 }, { GUID, 0 }, { GUID, 0 }, { GUID, 0 } },
+    /* 0x01 TypeRef */         { { CODED, RESOLUTION_SCOPE }, { STRING, 0 }, { STRING, 0 } },
+    /* 0x02 TypeDef */         { { FIXED, 4 }, { STRING, 0 }, { STRING, 0 }, { CODED, TYPE_DEF_OR_REF }, { TABLE, 0x04 }, { TABLE, 0x06 } },
+    /* 0x03 FieldPtr */        { { TABLE, 0x04 } },
+    /* 0x04 Field */           { { FIXED, 2 }, { STRING, 0 }, { BLOB, 0 } },
+    /* 0x05 MethodPtr */       { { TABLE, 0x06 } },
+    /* 0x06 MethodDef */       { { FIXED, 4 }, { FIXED, 2 }, { FIXED, 2 }, { STRING, 0 }, { BLOB, 0 }, { TABLE, 0x08 } },
+    /* 0x07 ParamPtr */        { { TABLE, 0x08 } },
+    /* 0x08 Param */           { { FIXED, 2 }, { FIXED, 2 }, { STRING, 0 } },
+    /* 0x09 InterfaceImpl */   { { TABLE, 0x02 }, { CODED, TYPE_DEF_OR_REF } },
+    /* 0x0A MemberRef */       { { CODED, MEMBER_REF_PARENT }, { STRING, 0 }, { BLOB, 0 } },
+    /* 0x0B Constant */        { { FIXED, 2 }, { CODED, HAS_CONSTANT }, { BLOB, 0 } },
+    /* 0x0C CustomAttribute */ { { CODED, HAS_CUSTOM_ATTRIBUTE }, { CODED, CUSTOM_ATTRIBUTE_TYPE }, { BLOB, 0 } },
+    /* 0x0D FieldMarshal */    { { CODED, HAS_FIELD_MARSHAL }, { BLOB, 0 } },
+    /* 0x0E DeclSecurity */    { { FIXED, 2 }, { CODED, HAS_DECL_SECURITY }, { BLOB, 0 } },
+    /* 0x0F ClassLayout */     { { FIXED, 2 }, { FIXED, 4 }, { TABLE, 0x02 } },
+    /* 0x10 FieldLayout */     { { FIXED, 4 }, { TABLE, 0x04 } },
+    /* 0x11 StandAloneSig */   { { BLOB, 0 } },
+    /* 0x12 EventMap */        { { TABLE, 0x02 }, { TABLE, 0x14 } },
+    /* 0x13 EventPtr */        { { TABLE, 0x14 } },
+    /* 0x14 Event */           { { FIXED, 2 }, { STRING, 0 }, { CODED, TYPE_DEF_OR_REF } },
+    /* 0x15 PropertyMap */     { { TABLE, 0x02 }, { TABLE, 0x17 } },
+    /* 0x16 PropertyPtr */     { { TABLE, 0x17 } },
+    /* 0x17 Property */        { { FIXED, 2 }, { STRING, 0 }, { BLOB, 0 } },
+    /* 0x18 MethodSemantics */ { { FIXED, 2 }, { TABLE, 0x06 }, { CODED, HAS_SEMANTICS } },
+    /* 0x19 MethodImpl */      { { TABLE, 0x02 }, { CODED, METHOD_DEF_OR_REF }, { CODED, METHOD_DEF_OR_REF } },
+    /* 0x1A ModuleRef */       { { STRING, 0 } },
+    /* 0x1B TypeSpec */        { { BLOB, 0 } },
+    /* 0x1C ImplMap */         { { FIXED, 2 }, { CODED, MEMBER_FORWARDED }, { STRING, 0 }, { TABLE, 0x1A } },
+    /* 0x1D FieldRVA */        { { FIXED, 4 }, { TABLE, 0x04 } },
+    /* 0x1E EncLog */          { { FIXED, 4 }, { FIXED, 4 } },
+    /* 0x1F EncMap */          { { FIXED, 4 } },
+    /* 0x20 Assembly */        { { FIXED, 4 }, { FIXED, 2 }, { FIXED, 2 }, { FIXED, 2 }, { FIXED, 2 }, { FIXED, 4 }, { BLOB, 0 }, { STRING, 0 }, { STRING, 0 } },
+};
+
+static std::uint32_t read16(const unsigned char * p) {
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8);
+}
+
+static std::uint32_t read32(const unsigned char * p) {
+    return read16(p) | (read16(p + 2) << 16);
+}
+
+// Tabs and line breaks would break the cache's and report's lines
+static std::string clean(std::string text) {
+    std::replace_if(text.begin(), text.end(), [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+    return text;
+}
+
+// A mapped DLL's .NET metadata: its heaps and the position and layout of its tables
+class Metadata
+{
+public:
+    // Finds the metadata through the PE headers. Returns false for native DLLs and damaged files.
+    bool open(const unsigned char * file, std::size_t fileSize) {
+        data = file;
+        size = fileSize;
+        if (size < 0x40 || data[0] != 'M' || data[1] != 'Z') {
+            return false;
+        }
+        std::size_t pe = read32(data + 0x3C);
+        if (!within(pe, 24) || std::string(reinterpret_cast<const char *>(data + pe), 4) != std::string("PE\0\0", 4)) {
+            return false;
+        }
+        std::size_t sectionCount = read16(data + pe + 6);
+        std::size_t optionalSize = read16(data + pe + 20);
+        std::size_t optional = pe + 24;
+        if (!within(optional, optionalSize) || optionalSize < 2) {
+            return false;
+        }
+
+        // The CLI header is data directory 14, after the rest of the optional header (longer in PE32+)
+        std::uint32_t magic = read16(data + optional);
+        std::size_t directories = optional + (magic == 0x20B ? 112 : 96);
+        if (directories + 15 * 8 > optional + optionalSize || read32(data + directories - 4) <= 14) {
+            return false;
+        }
+        sections = optional + optionalSize;
+        sectionEnd = sections + sectionCount * 40;
+        if (!within(sections, sectionCount * 40)) {
+            return false;
+        }
+        std::size_t cli = 0;
+        if (!toOffset(read32(data + directories + 14 * 8), 72, cli)) {
+            return false;
+        }
+        std::size_t root = 0;
+        std::uint32_t rootSize = read32(data + cli + 12);
+        if (!toOffset(read32(data + cli + 8), rootSize, root) || rootSize < 20 || read32(data + root) != 0x424A5342) {
+            return false;
+        }
+
+        // Find the streams listed after the runtime version string
+        std::size_t position = root + 16 + read32(data + root + 12);
+        if (!within(position, 4)) {
+            return false;
+        }
+        std::size_t streamCount = read16(data + position + 2);
+        position += 4;
+        const unsigned char * tables = nullptr;
+        std::size_t tablesSize = 0;
+        for (std::size_t i = 0; i < streamCount; ++i) {
+            if (!within(position, 8)) {
+                return false;
+            }
+            std::size_t offset = root + read32(data + position);
+            std::size_t length = read32(data + position + 4);
+            std::size_t name = position + 8;
+            std::size_t nameEnd = name;
+            while (nameEnd < size && nameEnd < name + 32 && data[nameEnd] != 0) {
+                ++nameEnd;
+            }
+            if (!within(offset, length) || nameEnd >= size) {
+                return false;
+            }
+            std::string streamName(reinterpret_cast<const char *>(data + name), nameEnd - name);
+            if (streamName == "#~" || streamName == "#-") {
+                tables = data + offset;
+                tablesSize = length;
+            } else if (streamName == "#Strings") {
+                strings = data + offset;
+                stringsSize = length;
+            } else if (streamName == "#Blob") {
+                blobs = data + offset;
+                blobsSize = length;
+            }
+            // Names are padded to a multiple of 4 bytes, counting the terminating null
+            position = name + ((nameEnd - name + 1 + 3) & ~static_cast<std::size_t>(3));
+        }
+        return tables != nullptr && readTableLayout(tables, tablesSize);
+    }
+
+    // Returns a row's column, or 0 if the table or row doesn't exist
+    std::uint32_t get(int table, std::uint32_t row, std::size_t column) const {
+        if (row == 0 || row > rows[table] || tableOffsets[table] == nullptr) {
+            return 0;
+        }
+        const unsigned char * p = tableOffsets[table] + (row - 1) * rowSizes[table];
+        for (std::size_t i = 0; i < column; ++i) {
+            p += columnSize(TABLE_COLUMNS[table][i]);
+        }
+        return columnSize(TABLE_COLUMNS[table][column]) == 2 ? read16(p) : read32(p);
+    }
+
+    std::string string(std::uint32_t index) const {
+        if (index >= stringsSize) {
+            return "";
+        }
+        const char * begin = reinterpret_cast<const char *>(strings + index);
+        const char * end = static_cast<const char *>(std::memchr(begin, 0, stringsSize - index));
+        return std::string(begin, end == nullptr ? stringsSize - index : static_cast<std::size_t>(end - begin));
+    }
+
+    // Returns a blob's bytes, reading the compressed length in front of it. False if it is out of bounds.
+    bool blob(std::uint32_t index, const unsigned char * &bytes, std::size_t &length) const {
+        if (index >= blobsSize) {
+            return false;
+        }
+        const unsigned char * p = blobs + index;
+        std::size_t header = (p[0] & 0x80) == 0 ? 1 : (p[0] & 0xC0) == 0x80 ? 2 : 4;
+        if (index + header > blobsSize) {
+            return false;
+        }
+        length = header == 1 ? p[0] : header == 2 ? ((p[0] & 0x3F) << 8) | p[1]
+                                                  : ((p[0] & 0x1F) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+        bytes = p + header;
+        return index + header + length <= blobsSize;
+    }
+
+    std::uint32_t rowCount(int table) const { return rows[table]; }
+
+private:
+    bool within(std::size_t offset, std::size_t length) const {
+        return offset <= size && length <= size - offset;
+    }
+
+    // Turns a virtual address into a file offset through the section table
+    bool toOffset(std::uint32_t rva, std::size_t length, std::size_t &offset) const {
+        for (std::size_t section = sections; section < sectionEnd; section += 40) {
+            std::uint32_t virtualAddress = read32(data + section + 12);
+            std::uint32_t extent = std::max(read32(data + section + 8), read32(data + section + 16));
+            if (rva >= virtualAddress && rva - virtualAddress < extent) {
+                offset = read32(data + section + 20) + (rva - virtualAddress);
+                return within(offset, length);
+            }
+        }
+        return false;
+    }
+
+    std::size_t columnSize(const Column &column) const {
+        switch (column.kind) {
+        case FIXED:
+            return static_cast<std::size_t>(column.argument);
+        case STRING:
+            return (heapSizes & 1) ? 4 : 2;
+        case GUID:
+            return (heapSizes & 2) ? 4 : 2;
+        case BLOB:
+            return (heapSizes & 4) ? 4 : 2;
+        case TABLE:
+            return rows[column.argument] < 0x10000 ? 2 : 4;
+        case CODED: {
+            const CodedIndex &coded = CODED_INDEXES[column.argument];
+            std::uint32_t largest = 0;
+            for (int table : coded.tables) {
+                largest = table < 0 ? largest : std::max(largest, rows[table]);
+            }
+            return largest < (1u << (16 - coded.tagBits)) ? 2 : 4;
+        }
+        }
+        return 4;
+    }
+
+    // Reads the row counts, then works out where each table up to Assembly starts
+    bool readTableLayout(const unsigned char * tables, std::size_t tablesSize) {
+        if (tablesSize < 24) {
+            return false;
+        }
+        heapSizes = tables[6];
+        std::uint64_t valid = static_cast<std::uint64_t>(read32(tables + 8)) | (static_cast<std::uint64_t>(read32(tables + 12)) << 32);
+        std::size_t position = 24;
+        for (int table = 0; table < 64; ++table) {
+            rows[table] = 0;
+            if (valid & (1ull << table)) {
+                if (position + 4 > tablesSize) {
+                    return false;
+                }
+                rows[table] = read32(tables + position);
+                position += 4;
+            }
+        }
+        // Some writers put an extra 4 bytes after the row counts, flagged in the heap sizes
+        if (heapSizes & 0x40) {
+            position += 4;
+        }
+
+        for (int table = 0; table <= ASSEMBLY; ++table) {
+            rowSizes[table] = 0;
+            for (const Column &column : TABLE_COLUMNS[table]) {
+                rowSizes[table] += columnSize(column);
+            }
+            std::uint64_t tableSize = static_cast<std::uint64_t>(rows[table]) * rowSizes[table];
+            if (position + tableSize > tablesSize) {
+                return false;
+            }
+            tableOffsets[table] = rows[table] > 0 ? tables + position : nullptr;
+            position += static_cast<std::size_t>(tableSize);
+        }
+        return true;
+    }
+
+    const unsigned char * data = nullptr;
+    std::size_t size = 0;
+    std::size_t sections = 0;
+    std::size_t sectionEnd = 0;
+    const unsigned char * strings = nullptr;
+    std::size_t stringsSize = 0;
+    const unsigned char * blobs = nullptr;
+    std::size_t blobsSize = 0;
+    unsigned heapSizes = 0;
+    std::uint32_t rows[64] = {};
+    std::size_t rowSizes[ASSEMBLY + 1] = {};
+    const unsigned char * tableOffsets[ASSEMBLY + 1] = {};
+};
+
+// Reads a SerString from a custom attribute's arguments (a compressed length then UTF-8, or 0xFF for null)
+static bool readSerString(const unsigned char * &p, const unsigned char * end, std::string &text) {
+    if (p >= end) {
+        return false;
+    }
+    if (*p == 0xFF) {
+        ++p;
+        text.clear();
+        return true;
+    }
+    std::size_t header = (p[0] & 0x80) == 0 ? 1 : (p[0] & 0xC0) == 0x80 ? 2 : 4;
+    if (static_cast<std::size_t>(end - p) < header) {
+        return false;
+    }
+    std::size_t length = header == 1 ? p[0] : header == 2 ? ((p[0] & 0x3F) << 8) | p[1]
+                                                          : ((p[0] & 0x1F) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    p += header;
+    if (static_cast<std::size_t>(end - p) < length) {
+        return false;
+    }
+    text.assign(reinterpret_cast<const char *>(p), length);
+    p += length;
+    return true;
+}
+
+// Returns whether a file name ends in .dll, in any case
+static bool isDll(const std::filesystem::path &path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    return extension == ".dll";
+}
+
+PluginInventory::PluginInventory() {}
+
+//=== FUNCTIONALITIES
+// Reads records saved by save(). Returns false (leaving the inventory empty) if the cache is missing or unreadable.
+bool PluginInventory::load(const std::string &cachePath) {
+    records.clear();
+    std::ifstream in(cachePath);
+    std::string line;
+    if (!std::getline(in, line) || line != CACHE_HEADER) {
+        return false;
+    }
+
+    // One line per DLL, then one per plugin it declares
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields;
+        std::istringstream stream(line);
+        for (std::string field; std::getline(stream, field, '\t');) {
+            fields.push_back(field);
+        }
+        if (fields.size() == 7 && fields[0] == "D") {
+            PluginRecord record;
+            record.size = std::stoull(fields[1]);
+            record.time = std::stoll(fields[2]);
+            record.managed = fields[3] == "1";
+            record.assemblyName = fields[4];
+            record.assemblyVersion = fields[5];
+            record.path = fields[6];
+            records.push_back(record);
+        } else if (fields.size() == 4 && fields[0] == "P" && !records.empty()) {
+            records.back().plugins.push_back({ fields[1], fields[2], fields[3] });
+        }
+    }
+    return true;
+}
+
+// Writes the records to a temporary file, then swaps it in so a crash never leaves half a cache
+bool PluginInventory::save(const std::string &cachePath) const {
+    std::string temporaryPath = cachePath + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::trunc);
+        out << CACHE_HEADER << "\n";
+        for (const PluginRecord &record : records) {
+            out << "D\t" << record.size << "\t" << record.time << "\t" << (record.managed ? 1 : 0) << "\t" << clean(record.assemblyName) << "\t"
+                << clean(record.assemblyVersion) << "\t" << clean(record.path) << "\n";
+            for (const PluginDeclaration &plugin : record.plugins) {
+                out << "P\t" << clean(plugin.guid) << "\t" << clean(plugin.name) << "\t" << clean(plugin.version) << "\n";
+            }
+        }
+        if (!out) {
+            std::cerr << "Error writing plugin inventory " << cachePath << "\n";
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, cachePath, error);
+    if (error) {
+        std::cerr << "Error writing plugin inventory " << cachePath << ": " << error.message() << "\n";
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
+
+/* Brings the inventory in line with a plugins folder. DLLs with the size and time on record keep their
+ * record; the rest are mapped and read across worker threads. DLLs no longer there are dropped.
+*/
+InventoryResult PluginInventory::scan(const std::string &pluginsDirectory) {
+    const auto startTime = std::chrono::steady_clock::now();
+    std::unordered_map<std::string, PluginRecord> cached;
+    for (PluginRecord &record : records) {
+        std::string path = record.path;
+        cached.emplace(std::move(path), std::move(record));
+    }
+    records.clear();
+
+    std::vector<std::size_t> toRead;
+    std::error_code error;
+    std::filesystem::path directory(pluginsDirectory);
+    std::filesystem::recursive_directory_iterator it(directory, std::filesystem::directory_options::skip_permission_denied, error);
+    for (; !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+        if (!it->is_regular_file(error) || !isDll(it->path())) {
+            continue;
+        }
+        PluginRecord record;
+        record.path = it->path().lexically_relative(directory).string();
+        record.size = it->file_size(error);
+        record.time = it->last_write_time(error).time_since_epoch().count();
+
+        auto found = cached.find(record.path);
+        if (found != cached.end() && found->second.size == record.size && found->second.time == record.time) {
+            records.push_back(std::move(found->second));
+        } else {
+            toRead.push_back(records.size());
+            records.push_back(std::move(record));
+        }
+    }
+
+    std::atomic<std::size_t> next(0);
+    auto work = [&]() {
+        BackgroundMode::lowerThreadPriority();
+        for (std::size_t i = next++; i < toRead.size(); i = next++) {
+            PluginRecord &record = records[toRead[i]];
+            MappedFile file((directory / record.path).string());
+            record.managed = file.isOpen() && readAssembly(file.data(), file.size(), record);
+        }
+    };
+    unsigned threadCount = BackgroundMode::capWorkers(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < std::min<std::size_t>(threadCount, toRead.size()); ++i) {
+        workers.emplace_back(work);
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    std::sort(records.begin(), records.end(), [](const PluginRecord &a, const PluginRecord &b) { return a.path < b.path; });
+    InventoryResult result;
+    result.filesScanned = records.size();
+    result.filesRead = toRead.size();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return result;
+}
+
+// Lists every DLL as a tab-separated table with a header row, one row per declared plugin, for comparing installs
+std::string PluginInventory::report() const {
+    std::ostringstream out;
+    out << "Path\tSize\tAssembly\tAssembly Version\tPlugin GUID\tPlugin Name\tPlugin Version\n";
+    for (const PluginRecord &record : records) {
+        std::string prefix = clean(record.path) + "\t" + std::to_string(record.size) + "\t"
+                             + (record.managed ? clean(record.assemblyName) + "\t" + clean(record.assemblyVersion) : "(native)\t");
+        if (record.plugins.empty()) {
+            out << prefix << "\t\t\t\n";
+        }
+        for (const PluginDeclaration &plugin : record.plugins) {
+            out << prefix << "\t" << clean(plugin.guid) << "\t" << clean(plugin.name) << "\t" << clean(plugin.version) << "\n";
+        }
+    }
+    return out.str();
+}
+
+/* Reads a DLL's assembly name and version, and the plugins it declares with [BepInPlugin], straight from its
+ * metadata tables. Returns false if it isn't a .NET assembly (or is damaged), leaving the record's metadata empty.
+*/
+bool PluginInventory::readAssembly(const unsigned char * data, std::size_t size, PluginRecord &record) {
+    record.assemblyName.clear();
+    record.assemblyVersion.clear();
+    record.plugins.clear();
+
+    Metadata metadata;
+    if (!metadata.open(data, size) || metadata.rowCount(ASSEMBLY) == 0) {
+        return false;
+    }
+    record.assemblyName = metadata.string(metadata.get(ASSEMBLY, 1, 7));
+    record.assemblyVersion = std::to_string(metadata.get(ASSEMBLY, 1, 1)) + "." + std::to_string(metadata.get(ASSEMBLY, 1, 2)) + "."
+                             + std::to_string(metadata.get(ASSEMBLY, 1, 3)) + "." + std::to_string(metadata.get(ASSEMBLY, 1, 4));
+
+    // [BepInPlugin] is a constructor in BepInEx.dll, so it is referenced through a MemberRef to a TypeRef
+    for (std::uint32_t row = 1; row <= metadata.rowCount(CUSTOM_ATTRIBUTE); ++row) {
+        std::uint32_t type = metadata.get(CUSTOM_ATTRIBUTE, row, 1);
+        if ((type & 7) != CUSTOM_ATTRIBUTE_TYPE_MEMBER_REF) {
+            continue;
+        }
+        std::uint32_t parent = metadata.get(MEMBER_REF, type >> 3, 0);
+        if ((parent & 7) != MEMBER_REF_PARENT_TYPE_REF) {
+            continue;
+        }
+        std::uint32_t typeRef = parent >> 3;
+        if (metadata.string(metadata.get(TYPE_REF, typeRef, 1)) != "BepInPlugin" || metadata.string(metadata.get(TYPE_REF, typeRef, 2)) != "BepInEx") {
+            continue;
+        }
+
+        // The arguments start with the 0x0001 prolog, then the three constructor strings
+        const unsigned char * value = nullptr;
+        std::size_t length = 0;
+        if (!metadata.blob(metadata.get(CUSTOM_ATTRIBUTE, row, 2), value, length) || length < 2 || read16(value) != 1) {
+            continue;
+        }
+        const unsigned char * p = value + 2;
+        PluginDeclaration plugin;
+        if (readSerString(p, value + length, plugin.guid) && readSerString(p, value + length, plugin.name)
+            && readSerString(p, value + length, plugin.version)) {
+            record.plugins.push_back(plugin);
+        }
+    }
+    return true;
+}
+
+//=== GETTERS
+const std::vector<PluginRecord> &PluginInventory::getRecords() const { return records; }
+
+// Returns how many BepInEx plugins the DLLs declare between them
+std::size_t PluginInventory::countPlugins() const {
+    std::size_t count = 0;
+    for (const PluginRecord &record : records) {
+        count += record.plugins.size();
+    }
+    return count;
+}
@@ -0,0 +1,61 @@
+#ifndef PLUGININVENTORY_H
+#define PLUGININVENTORY_H
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// A plugin class an assembly declares with BepInEx's [BepInPlugin(GUID, Name, Version)] attribute
+struct PluginDeclaration
+{
+    std::string guid;
+    std::string name;
+    std::string version;
+};
+
+// What a DLL in the plugins folder is, read from its PE/.NET metadata
+struct PluginRecord
+{
+    std::string path;               // Relative to the plugins folder
+    std::uint64_t size = 0;
+    std::int64_t time = 0;
+    bool managed = false;           // A .NET assembly (false for native DLLs and unreadable files)
+    std::string assemblyName;
+    std::string assemblyVersion;
+    std::vector<PluginDeclaration> plugins;
+};
+
+// What a scan did
+struct InventoryResult
+{
+    std::uint64_t filesScanned = 0;
+    std::uint64_t filesRead = 0;    // Not in the cache, or changed since, so their metadata was read
+    double seconds = 0.0;
+};
+
+/* An inventory of the DLLs installed in a plugins folder: each one's assembly name and version and
+ * the BepInEx plugins it declares. DLLs are memory-mapped and read in parallel, straight from the
+ * metadata tables, without loading them. Records are kept in a cache file and reused for any DLL
+ * whose size and modification time haven't changed, so a rescan only reads what was updated.
+*/
+class PluginInventory
+{
+public:
+    PluginInventory();
+
+    //=== FUNCTIONALITIES
+    bool load(const std::string &cachePath);
+    bool save(const std::string &cachePath) const;
+    InventoryResult scan(const std::string &pluginsDirectory);
+    std::string report() const;
+    static bool readAssembly(const unsigned char * data, std::size_t size, PluginRecord &record);
+
+    //=== GETTERS
+    const std::vector<PluginRecord> &getRecords() const;
+    std::size_t countPlugins() const;
+
+private:
+    std::vector<PluginRecord> records;
+};
+
+#endif // PLUGININVENTORY_H
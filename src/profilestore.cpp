@@ -0,0 +1,258 @@
+#include "profilestore.h"
+#include "installmanifest.h"
+#include "copyengine.h"
+#include "filecopier.h"
+#include "ziphandler.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_set>
+
+static const char * PROFILE_HEADER = "PROFILE 1";
+
+// The BepInEx folders a profile owns (BepInEx itself is shared by every profile)
+static const char * PROFILE_FOLDERS[] = { "plugins", "patchers", "config" };
+
+// Separator used in manifest paths (see InstallManifest)
+static const char SEPARATOR = static_cast<char>(std::filesystem::path::preferred_separator);
+
+static unsigned workerCount() {
+    return std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+}
+
+ProfileStore::ProfileStore(const std::string &directory) : directory(directory) {}
+
+//=== FUNCTIONALITIES
+// Writes a profile's details, creating it (with no files yet) if it is new
+bool ProfileStore::addProfile(const Profile &profile) {
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(directory) / "profiles", error);
+
+    std::string path = profilePath(profile.name, ".profile");
+    {
+        std::ofstream out(path + ".tmp", std::ios::trunc);
+        out << PROFILE_HEADER << "\n";
+        out << "N " << profile.name << "\n";
+        out << "O " << profile.owner << "\n";
+        out << "R " << profile.repo << "\n";
+        out << "V " << profile.version << "\n";
+        if (!out) {
+            return false;
+        }
+    }
+    std::filesystem::rename(path + ".tmp", path, error);
+    return !error;
+}
+
+/* Records the modpack folders currently in the game as a profile's files, storing any file the store
+ * doesn't have yet. Files whose size and time haven't changed since the last capture aren't hashed
+ * again, and stored DLLs are hardlinked to the installed ones, so capturing is cheap after the first time.
+*/
+bool ProfileStore::capture(const std::string &name, const std::string &gameDirectory, const std::string &version) {
+    Profile profile;
+    if (!getProfile(name, profile)) {
+        return false;
+    }
+
+    std::string bepinexDirectory = gameDirectory + "\\BepInEx";
+    InstallManifest files;
+    files.load(profilePath(name, ".files"));
+    for (const char * folder : PROFILE_FOLDERS) {
+        files.recordTree(bepinexDirectory, folder, version);
+    }
+    files.prune(bepinexDirectory);
+
+    std::vector<ManifestEntry> entries = files.getEntries();
+    std::atomic<std::size_t> nextEntry(0);
+    std::atomic<bool> failed(false);
+    auto work = [&](unsigned worker) {
+        for (std::size_t i = nextEntry++; i < entries.size() && !failed; i = nextEntry++) {
+            if (!storeObject(bepinexDirectory + SEPARATOR + entries[i].path, entries[i].hash, worker)) {
+                std::cerr << "Error storing " << entries[i].path << "\n";
+                failed = true;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < std::min<std::size_t>(workerCount(), entries.size()); ++i) {
+        workers.emplace_back(work, i);
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    if (failed || !files.save(profilePath(name, ".files"))) {
+        return false;
+    }
+
+    profile.version = version;
+    return addProfile(profile);
+}
+
+/* Builds a profile's modpack folders in the game's BepInEx folder, each named with the given suffix
+ * (so they can be staged next to the live ones). Folders already there are replaced. Returns false if
+ * the profile is unknown, an object is missing, or any file can't be placed.
+*/
+bool ProfileStore::materialise(const std::string &name, const std::string &gameDirectory, const std::string &folderSuffix) const {
+    if (!hasProfile(name)) {
+        return false;
+    }
+
+    // A profile that was never captured has no files yet, and materialises as empty folders
+    InstallManifest files;
+    files.load(profilePath(name, ".files"));
+
+    std::string bepinexDirectory = gameDirectory + "\\BepInEx";
+    CopyEngine engine;
+    for (const char * folder : PROFILE_FOLDERS) {
+        std::string target = bepinexDirectory + SEPARATOR + folder + folderSuffix;
+        std::filesystem::remove_all(target);
+        engine.addDirectory(target);
+    }
+    for (const ManifestEntry &entry : files.getEntries()) {
+        std::size_t separator = entry.path.find(SEPARATOR);
+        std::string source = objectPath(entry.hash);
+        std::error_code error;
+        if (separator == std::string::npos || !std::filesystem::exists(source, error)) {
+            std::cerr << "Error materialising " << entry.path << ": it is missing from the store\n";
+            return false;
+        }
+        std::filesystem::path target(bepinexDirectory + SEPARATOR + entry.path.substr(0, separator) + folderSuffix + entry.path.substr(separator));
+        engine.addDirectory(target.parent_path().string());
+        engine.addFile(source, target.string(), entry.size);
+    }
+
+    CopyResult result = engine.run();
+    for (const CopyError &error : result.errors) {
+        std::cerr << "Error materialising " << error.path << ": " << error.message << "\n";
+    }
+    return result.errors.empty();
+}
+
+// Forgets a profile. Its files stay in the store until the next garbage collection.
+bool ProfileStore::removeProfile(const std::string &name) {
+    std::error_code error;
+    std::filesystem::remove(profilePath(name, ".files"), error);
+    std::filesystem::remove(releasePath(name), error);
+    return std::filesystem::remove(profilePath(name, ".profile"), error);
+}
+
+// Deletes every object no profile refers to (and any leftover temporary files). Returns the number of bytes freed.
+std::uint64_t ProfileStore::collectGarbage() {
+    std::unordered_set<std::string> referenced;
+    for (const Profile &profile : profiles()) {
+        InstallManifest files;
+        std::error_code error;
+        if (!files.load(profilePath(profile.name, ".files")) && std::filesystem::exists(profilePath(profile.name, ".files"), error)) {
+            // Keep everything rather than lose files a damaged manifest might still need
+            return 0;
+        }
+        for (const ManifestEntry &entry : files.getEntries()) {
+            referenced.insert(entry.hash);
+        }
+    }
+
+    std::uint64_t freed = 0;
+    std::error_code error;
+    std::filesystem::path objects = std::filesystem::path(directory) / "objects";
+    std::vector<std::filesystem::path> unreferenced;
+    for (const auto &item : std::filesystem::recursive_directory_iterator(objects, error)) {
+        if (!item.is_regular_file()) {
+            continue;
+        }
+        std::string hash = item.path().parent_path().filename().string() + item.path().filename().string();
+        if (referenced.count(hash) == 0) {
+            unreferenced.push_back(item.path());
+        }
+    }
+    for (const std::filesystem::path &path : unreferenced) {
+        // A hardlinked object frees nothing while the game still has its other link
+        std::uint64_t size = std::filesystem::hard_link_count(path, error) > 1 ? 0 : std::filesystem::file_size(path, error);
+        if (std::filesystem::remove(path, error)) {
+            freed += size;
+        }
+    }
+    return freed;
+}
+
+//=== GETTERS
+bool ProfileStore::hasProfile(const std::string &name) const {
+    std::error_code error;
+    return std::filesystem::exists(profilePath(name, ".profile"), error);
+}
+
+// Reads a profile's details. Returns false if it is missing or malformed.
+bool ProfileStore::getProfile(const std::string &name, Profile &profile) const {
+    std::ifstream in(profilePath(name, ".profile"));
+    std::string line;
+    if (!std::getline(in, line) || line != PROFILE_HEADER) {
+        return false;
+    }
+
+    profile = Profile();
+    while (std::getline(in, line)) {
+        std::string value = line.size() > 2 ? line.substr(2) : "";
+        switch (line.empty() ? ' ' : line[0]) {
+        case 'N': profile.name = value; break;
+        case 'O': profile.owner = value; break;
+        case 'R': profile.repo = value; break;
+        case 'V': profile.version = value; break;
+        default: break;
+        }
+    }
+    return !profile.name.empty();
+}
+
+// Returns every profile, sorted by name
+std::vector<Profile> ProfileStore::profiles() const {
+    std::vector<Profile> result;
+    std::error_code error;
+    for (const auto &item : std::filesystem::directory_iterator(std::filesystem::path(directory) / "profiles", error)) {
+        Profile profile;
+        if (item.path().extension() == ".profile" && getProfile(item.path().stem().string(), profile)) {
+            result.push_back(profile);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const Profile &a, const Profile &b) { return a.name < b.name; });
+    return result;
+}
+
+// Returns where a profile keeps a copy of its installed release's details, while another profile is active
+std::string ProfileStore::releasePath(const std::string &name) const {
+    return profilePath(name, ".json");
+}
+
+std::string ProfileStore::profilePath(const std::string &name, const std::string &extension) const {
+    std::string filename = name;
+    return (std::filesystem::path(directory) / "profiles" / (ZipHandler::sanitizeFilename(filename) + extension)).string();
+}
+
+// Objects are spread over 256 folders by the first byte of their hash
+std::string ProfileStore::objectPath(const std::string &hash) const {
+    return (std::filesystem::path(directory) / "objects" / hash.substr(0, 2) / hash.substr(2)).string();
+}
+
+// Puts a file into the store under its hash, unless the store already has it
+bool ProfileStore::storeObject(const std::string &source, const std::string &hash, unsigned worker) const {
+    std::string path = objectPath(hash);
+    std::error_code error;
+    if (std::filesystem::exists(path, error)) {
+        return true;
+    }
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+    // Each worker goes through its own temporary file, so two workers storing the same file can't collide
+    std::string temporaryPath = path + ".tmp" + std::to_string(worker);
+    CopyMethod method = FileCopier::copy(source, temporaryPath);
+    if (method == CopyMethod::Failed) {
+        return false;
+    }
+    if (method != CopyMethod::Hardlink) {
+        // Keep the time, so files materialised from the object still match the manifest without rehashing
+        std::filesystem::last_write_time(temporaryPath, std::filesystem::last_write_time(source, error), error);
+    }
+    std::filesystem::rename(temporaryPath, path, error);
+    return !error;
+}
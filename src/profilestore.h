@@ -0,0 +1,48 @@
+#ifndef PROFILESTORE_H
+#define PROFILESTORE_H
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// A named modpack setup: the GitHub repository its releases come from, and the release it last had installed
+struct Profile
+{
+    std::string name;
+    std::string owner;
+    std::string repo;
+    std::string version;
+};
+
+/* Named profiles and the files each one installs, kept on the game's volume (so files can be linked
+ * rather than copied). Every file is stored once, whole, under its SHA-256 in "objects", and each
+ * profile is a manifest of which object goes where in BepInEx. Materialising a profile clones or
+ * hardlinks its objects (see FileCopier), so profiles that share most of their plugins cost almost
+ * no extra space, and switching between them is a staged build made of links plus a folder swap.
+*/
+class ProfileStore
+{
+public:
+    ProfileStore(const std::string &directory);
+
+    //=== FUNCTIONALITIES
+    bool addProfile(const Profile &profile);
+    bool capture(const std::string &name, const std::string &gameDirectory, const std::string &version);
+    bool materialise(const std::string &name, const std::string &gameDirectory, const std::string &folderSuffix) const;
+    bool removeProfile(const std::string &name);
+    std::uint64_t collectGarbage();
+
+    //=== GETTERS
+    bool hasProfile(const std::string &name) const;
+    bool getProfile(const std::string &name, Profile &profile) const;
+    std::vector<Profile> profiles() const;
+    std::string releasePath(const std::string &name) const;
+
+private:
+    std::string profilePath(const std::string &name, const std::string &extension) const;
+    std::string objectPath(const std::string &hash) const;
+    bool storeObject(const std::string &source, const std::string &hash, unsigned worker) const;
+
+    std::string directory;
+};
+
+#endif // PROFILESTORE_H
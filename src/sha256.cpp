@@ -0,0 +1,134 @@
+#include "sha256.h"
+#include "mappedfile.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+// Round constants
+static const std::uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static std::uint32_t rotateRight(std::uint32_t value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+Sha256::Sha256() {
+    static const std::uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    std::memcpy(state, initial, sizeof(state));
+}
+
+//=== FUNCTIONALITIES
+// Feeds more bytes into the hash
+void Sha256::update(const void * data, std::size_t size) {
+    if (size == 0) {
+        return;
+    }
+    const unsigned char * input = static_cast<const unsigned char *>(data);
+    totalSize += size;
+
+    // Finish off a partly filled block first
+    if (bufferSize > 0) {
+        std::size_t take = std::min(size, sizeof(buffer) - bufferSize);
+        std::memcpy(buffer + bufferSize, input, take);
+        bufferSize += take;
+        input += take;
+        size -= take;
+        if (bufferSize < sizeof(buffer)) {
+            return;
+        }
+        transform(buffer);
+        bufferSize = 0;
+    }
+
+    // Hash whole blocks straight from the input
+    while (size >= sizeof(buffer)) {
+        transform(input);
+        input += sizeof(buffer);
+        size -= sizeof(buffer);
+    }
+
+    std::memcpy(buffer, input, size);
+    bufferSize = size;
+}
+
+// Pads the message and returns the digest as lowercase hex. The object can't be updated afterwards.
+std::string Sha256::finish() {
+    std::uint64_t bitLength = totalSize * 8;
+    unsigned char padding[72] = { 0x80 };
+    std::size_t paddingSize = (bufferSize < 56 ? 56 : 120) - bufferSize;
+    for (int i = 0; i < 8; ++i) {
+        padding[paddingSize + i] = static_cast<unsigned char>(bitLength >> (56 - 8 * i));
+    }
+    update(padding, paddingSize + 8);
+
+    static const char digits[] = "0123456789abcdef";
+    std::string result;
+    result.reserve(64);
+    for (std::uint32_t word : state) {
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            result.push_back(digits[(word >> shift) & 0xF]);
+        }
+    }
+    return result;
+}
+
+// Returns the hex digest of a block of bytes
+std::string Sha256::hash(const void * data, std::size_t size) {
+    Sha256 sha;
+    sha.update(data, size);
+    return sha.finish();
+}
+
+// Returns the hex digest of a file's contents. Sets ok to false if the file can't be read.
+std::string Sha256::hashFile(const std::string &path, bool &ok) {
+    std::error_code error;
+    std::uint64_t size = std::filesystem::file_size(path, error);
+    ok = !error;
+    if (error || size == 0) {
+        return hash(nullptr, 0);
+    }
+
+    MappedFile file(path);
+    ok = file.isOpen();
+    return ok ? hash(file.data(), file.size()) : "";
+}
+
+// Hashes a single 64-byte block into the state
+void Sha256::transform(const unsigned char * block) {
+    std::uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (std::uint32_t(block[4 * i]) << 24) | (std::uint32_t(block[4 * i + 1]) << 16)
+               | (std::uint32_t(block[4 * i + 2]) << 8) | std::uint32_t(block[4 * i + 3]);
+    }
+    for (int i = 16; i < 64; ++i) {
+        std::uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        std::uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    std::uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+        std::uint32_t s1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+        std::uint32_t choose = (e & f) ^ (~e & g);
+        std::uint32_t temp1 = h + s1 + choose + K[i] + w[i];
+        std::uint32_t s0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+        std::uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+        std::uint32_t temp2 = s0 + majority;
+        h = g; g = f; f = e; e = d + temp1;
+        d = c; c = b; b = a; a = temp1 + temp2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
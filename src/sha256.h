@@ -0,0 +1,28 @@
+#ifndef SHA256_H
+#define SHA256_H
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Incremental SHA-256, used for file manifests and content addressing
+class Sha256
+{
+public:
+    Sha256();
+
+    //=== FUNCTIONALITIES
+    void update(const void * data, std::size_t size);
+    std::string finish();
+    static std::string hash(const void * data, std::size_t size);
+    static std::string hashFile(const std::string &path, bool &ok);
+
+private:
+    void transform(const unsigned char * block);
+
+    std::uint32_t state[8];
+    unsigned char buffer[64];
+    std::size_t bufferSize = 0;
+    std::uint64_t totalSize = 0;
+};
+
+#endif // SHA256_H
@@ -0,0 +1,129 @@
+#include "spaceplanner.h"
+#include "ziphandler.h"
+#include "packarchive.h"
+#include <filesystem>
+#include <vector>
+
+// Allocation unit files are rounded up to (NTFS's default cluster size)
+static const std::uint64_t CLUSTER_SIZE = 4096;
+
+// Size assumed for the modpack when nothing about it is known yet
+static const std::uint64_t DEFAULT_ESTIMATE = 1000000000;
+
+// Size assumed for the BepInEx pack before it is downloaded, compressed and extracted
+static const std::uint64_t BEPINEX_ESTIMATE = 16000000;
+
+// Suffix of the previous install's folders, which a staged install starts from (see Installer::prepareStaging)
+static const char * PREVIOUS_SUFFIX = ".previous";
+
+SpacePlanner::SpacePlanner(const std::string &gameDirectory) : gameDirectory(gameDirectory) {}
+
+//=== FUNCTIONALITIES
+// Returns the bytes needed in the cache and in the game directory
+SpacePlan SpacePlanner::plan() const {
+    SpacePlan plan;
+
+    // The modpack: its archive, its extracted copy (unless it goes straight to the game) and what it writes to the game
+    std::vector<ZipEntry> entries;
+    if (!archivePath.empty() && std::filesystem::exists(archivePath)) {
+        entries = ZipHandler::listEntries(archivePath);
+    }
+    if (entries.empty()) {
+        std::uint64_t size = estimate > 0 ? estimate : DEFAULT_ESTIMATE;
+        bool inMemory = size <= memoryStageBudget;
+        plan.cacheBytes += size + (extractToCache && !inMemory ? size : 0);
+        plan.gameBytes += size;
+        plan.estimated = true;
+    } else {
+        // Installs from memory or straight from the archive clear the folders and write every file. The
+        // cleared folders are only freed once the trash empties, so the whole tree is needed up front.
+        std::uint64_t rawSize = 0;
+        for (const ZipEntry &entry : entries) {
+            rawSize += entry.uncompressedSize;
+        }
+        bool inMemory = memoryStageBudget > 0 && !PackArchive::isPack(archivePath) && rawSize <= memoryStageBudget;
+        bool wholeTree = inMemory || !extractToCache;
+
+        // An install from the extracted copy only writes what differs from the folders it builds on:
+        // the live ones, or for a staged install the previous install's (kept next to the live ones)
+        std::string root = ZipHandler::findRootFolder(archivePath);
+        std::string bepinexDirectory = gameDirectory + "\\BepInEx";
+        std::string suffix = stagedInstall ? PREVIOUS_SUFFIX : "";
+        std::vector<PathMapping> mappings = {
+            { root + "plugins/", bepinexDirectory + "\\plugins" + suffix },
+            { root + "patchers/", bepinexDirectory + "\\patchers" + suffix },
+            { root + "config/", bepinexDirectory + "\\config" + suffix },
+        };
+
+        std::uint64_t extracted = 0;
+        for (const ZipEntry &entry : entries) {
+            if (entry.name.empty() || entry.name.back() == '/') {
+                continue;
+            }
+            extracted += sizeOnDisk(entry.uncompressedSize);
+
+            std::string fullPath;
+            if (!gameDirectory.empty() && ZipHandler::mapEntryPath(entry.name, mappings, fullPath)) {
+                std::error_code error;
+                std::uint64_t installedSize = wholeTree ? 0 : std::filesystem::file_size(fullPath, error);
+                if (wholeTree || error || installedSize != entry.uncompressedSize) {
+                    plan.gameBytes += sizeOnDisk(entry.uncompressedSize);
+                }
+            }
+        }
+        // Only the extracted copy is still to come; the archive is already on disk
+        if (extractToCache && !inMemory) {
+            plan.cacheBytes += extracted;
+        }
+    }
+
+    // BepInEx, if it isn't installed yet
+    if (!bepinexInstalled) {
+        const std::string prefix = "BepInExPack/";
+        std::uint64_t extracted = 0;
+        std::uint64_t installed = 0;
+        bool cached = !bepinexArchivePath.empty() && std::filesystem::exists(bepinexArchivePath);
+        for (const ZipEntry &entry : cached ? ZipHandler::listEntries(bepinexArchivePath) : std::vector<ZipEntry>()) {
+            if (!entry.name.empty() && entry.name.back() != '/') {
+                extracted += sizeOnDisk(entry.uncompressedSize);
+                installed += entry.name.compare(0, prefix.size(), prefix) == 0 ? sizeOnDisk(entry.uncompressedSize) : 0;
+            }
+        }
+        if (extracted == 0) {
+            plan.cacheBytes += 2 * BEPINEX_ESTIMATE;
+            plan.gameBytes += BEPINEX_ESTIMATE;
+            plan.estimated = true;
+        } else {
+            plan.cacheBytes += extractToCache && extracted > memoryStageBudget ? extracted : 0;
+            plan.gameBytes += installed;
+        }
+    }
+    return plan;
+}
+
+// Returns the space a file of the given size takes up, rounded up to whole clusters
+std::uint64_t SpacePlanner::sizeOnDisk(std::uint64_t size) {
+    return (size + CLUSTER_SIZE - 1) / CLUSTER_SIZE * CLUSTER_SIZE;
+}
+
+//=== SETTERS
+// Sets the cached modpack archive (a zip or a pack), if it has been downloaded
+void SpacePlanner::setArchive(const std::string &path) { archivePath = path; }
+
+// Sets the cached BepInEx archive, and whether BepInEx is already installed (in which case it needs nothing)
+void SpacePlanner::setBepInExArchive(const std::string &path, bool installed) {
+    bepinexArchivePath = path;
+    bepinexInstalled = installed;
+}
+
+// Sets whether archives are extracted into the cache before installing, rather than straight into the game
+void SpacePlanner::setExtractToCache(bool enabled) { extractToCache = enabled; }
+
+// Sets whether installs are staged next to the live folders and swapped in (see Installer::prepareStaging)
+void SpacePlanner::setStagedInstall(bool enabled) { stagedInstall = enabled; }
+
+// Sets the memory staging budget; archives that fit are never extracted to disk
+void SpacePlanner::setMemoryStageBudget(std::uint64_t bytes) { memoryStageBudget = bytes; }
+
+// Sets the installed modpack's size, used to estimate a release that isn't downloaded yet
+void SpacePlanner::setEstimate(std::uint64_t bytes) { estimate = bytes; }
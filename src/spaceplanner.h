@@ -0,0 +1,50 @@
+#ifndef SPACEPLANNER_H
+#define SPACEPLANNER_H
+#include <string>
+#include <cstdint>
+
+// Bytes an install needs in each place it writes to
+struct SpacePlan
+{
+    std::uint64_t cacheBytes = 0;   // The downloads and their extracted copies in the app's cache
+    std::uint64_t gameBytes = 0;    // Files the install writes to the game directory
+    bool estimated = false;         // Some archives aren't downloaded yet, so their sizes were estimated
+};
+
+/* Works out how much free space an install or update needs, from the cached archives' uncompressed
+ * sizes and what is already installed, following the way the Installer will install. Installs from
+ * memory or straight from the archive clear the modpack's folders and rewrite all of it, so the
+ * whole tree counts. Installs from the extracted copy leave files that already have the right size
+ * in the folders they build on (the live ones, or the previous install's for a staged install), so
+ * only the rest counts. Everything is rounded up to whole clusters. Archives that aren't downloaded
+ * yet are estimated from the installed modpack's size.
+*/
+class SpacePlanner
+{
+public:
+    SpacePlanner(const std::string &gameDirectory);
+
+    //=== FUNCTIONALITIES
+    SpacePlan plan() const;
+    static std::uint64_t sizeOnDisk(std::uint64_t size);
+
+    //=== SETTERS
+    void setArchive(const std::string &path);
+    void setBepInExArchive(const std::string &path, bool installed);
+    void setExtractToCache(bool enabled);
+    void setStagedInstall(bool enabled);
+    void setMemoryStageBudget(std::uint64_t bytes);
+    void setEstimate(std::uint64_t bytes);
+
+private:
+    std::string gameDirectory;
+    std::string archivePath;
+    std::string bepinexArchivePath;
+    bool bepinexInstalled = true;
+    bool extractToCache = true;
+    bool stagedInstall = false;
+    std::uint64_t memoryStageBudget = 0;
+    std::uint64_t estimate = 0;
+};
+
+#endif // SPACEPLANNER_H
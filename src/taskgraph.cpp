@@ -0,0 +1,165 @@
+#include "taskgraph.h"
+#include <QMetaObject>
+#include <unordered_map>
+#include <exception>
+
+TaskGraph::TaskGraph(QThreadPool &pool, QObject * parent)
+    : QObject(parent), pool(pool)
+{}
+
+//=== FUNCTIONALITIES
+// Adds a task. Tasks can only be added before the graph is started.
+void TaskGraph::addTask(std::string name, std::function<void()> work, std::vector<std::string> inputs, std::vector<std::string> outputs) {
+    if (started) {
+        return;
+    }
+    Node node;
+    node.task = { std::move(name), std::move(work), std::move(inputs), std::move(outputs) };
+    nodes.push_back(std::move(node));
+}
+
+/* Links each task to the tasks making its inputs and starts every task that is ready. Returns false,
+ * starting nothing, if it was already started, two tasks make the same output or the tasks depend
+ * on each other in a cycle.
+*/
+bool TaskGraph::start() {
+    if (started) {
+        return false;
+    }
+
+    std::unordered_map<std::string, std::size_t> makers;
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        for (const std::string &output : nodes[i].task.outputs) {
+            if (!makers.emplace(output, i).second) {
+                return false;
+            }
+        }
+    }
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        for (const std::string &input : nodes[i].task.inputs) {
+            auto maker = makers.find(input);
+            if (maker != makers.end()) {
+                nodes[maker->second].dependents.push_back(i);
+                ++nodes[i].waiting;
+            }
+        }
+    }
+
+    // Every task has to be reachable from one that needs nothing, or the graph would never finish
+    std::vector<std::size_t> waiting(nodes.size());
+    std::vector<std::size_t> ready;
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        waiting[i] = nodes[i].waiting;
+        if (waiting[i] == 0) {
+            ready.push_back(i);
+        }
+    }
+    std::size_t reached = 0;
+    while (!ready.empty()) {
+        std::size_t node = ready.back();
+        ready.pop_back();
+        ++reached;
+        for (std::size_t dependent : nodes[node].dependents) {
+            if (--waiting[dependent] == 0) {
+                ready.push_back(dependent);
+            }
+        }
+    }
+    if (reached != nodes.size()) {
+        for (Node &node : nodes) {
+            node.dependents.clear();
+            node.waiting = 0;
+        }
+        return false;
+    }
+
+    started = true;
+    dispatch();
+    return true;
+}
+
+// Stops any more tasks from starting. failed() is emitted once the running ones have finished.
+void TaskGraph::cancel() {
+    if (stopped || !started) {
+        return;
+    }
+    stopped = true;
+    error = "The pipeline was cancelled.";
+    dispatch();
+}
+
+//=== STATUS
+bool TaskGraph::isRunning() const { return started && !ended; }
+
+// Returns the names of the tasks running right now
+std::vector<std::string> TaskGraph::getRunningTasks() const {
+    std::vector<std::string> tasks;
+    for (const Node &node : nodes) {
+        if (node.started && !node.done) {
+            tasks.push_back(node.task.name);
+        }
+    }
+    return tasks;
+}
+
+//=== PRIVATE
+// Hands every ready task to the pool, and ends the graph once nothing is left running
+void TaskGraph::dispatch() {
+    for (std::size_t i = 0; i < nodes.size() && !stopped; ++i) {
+        Node &node = nodes[i];
+        if (node.started || node.waiting > 0) {
+            continue;
+        }
+        node.started = true;
+        ++running;
+        emit taskStarted(QString::fromStdString(node.task.name));
+
+        // The work runs on the pool; its result comes back to this thread as a queued call
+        std::function<void()> work = node.task.work;
+        pool.start([this, i, work]() {
+            bool succeeded = false;
+            QString taskError;
+            try {
+                work();
+                succeeded = true;
+            } catch (std::exception &e) {
+                taskError = e.what();
+            } catch (...) {}
+            if (!succeeded && taskError.isEmpty()) {
+                taskError = "An unknown error occurred.";
+            }
+            QMetaObject::invokeMethod(this, [this, i, taskError]() { onTaskDone(i, taskError); }, Qt::QueuedConnection);
+        });
+    }
+
+    if (running > 0 || ended) {
+        return;
+    }
+    ended = true;
+    if (stopped) {
+        emit failed(failedTask, error);
+    } else {
+        emit finished();
+    }
+}
+
+// Records a task's result and starts whatever it was holding back
+void TaskGraph::onTaskDone(std::size_t index, QString taskError) {
+    Node &node = nodes[index];
+    node.done = true;
+    --running;
+
+    if (!taskError.isEmpty()) {
+        if (!stopped) {
+            stopped = true;
+            failedTask = QString::fromStdString(node.task.name);
+            error = taskError;
+        }
+    } else {
+        emit taskFinished(QString::fromStdString(node.task.name));
+        for (std::size_t dependent : node.dependents) {
+            --nodes[dependent].waiting;
+        }
+    }
+    dispatch();
+}
@@ -0,0 +1,71 @@
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A step of a pipeline: what it needs before it can run, and what it makes for the steps after it
+struct PipelineTask
+{
+    std::string name;
+    std::function<void()> work;             // Throws to fail the task
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+};
+
+/* Runs a pipeline's tasks on a thread pool in the order their inputs and outputs call for. A task
+ * starts once every task making one of its inputs has finished, so independent tasks run at the
+ * same time; an input no task makes is taken to be there already. The graph itself lives on the
+ * thread that created it (the GUI thread, for the manager's pipelines), which only schedules and
+ * signals: no task ever runs there. If a task fails, nothing new starts, and failed() is emitted
+ * once the running tasks have finished. Otherwise finished() is emitted after the last task.
+*/
+class TaskGraph : public QObject
+{
+    Q_OBJECT
+public:
+    TaskGraph(QThreadPool &pool, QObject * parent = nullptr);
+
+    //=== FUNCTIONALITIES
+    void addTask(std::string name, std::function<void()> work, std::vector<std::string> inputs, std::vector<std::string> outputs);
+    bool start();
+    void cancel();
+
+    //=== STATUS
+    bool isRunning() const;
+    std::vector<std::string> getRunningTasks() const;
+
+signals:
+    void taskStarted(QString task);
+    void taskFinished(QString task);
+    void finished();
+    void failed(QString task, QString error);
+
+private:
+    struct Node
+    {
+        PipelineTask task;
+        std::vector<std::size_t> dependents;
+        std::size_t waiting = 0;            // Tasks making its inputs that haven't finished yet
+        bool started = false;
+        bool done = false;
+    };
+
+    void dispatch();
+    void onTaskDone(std::size_t index, QString taskError);
+
+    QThreadPool &pool;
+    std::vector<Node> nodes;
+    std::size_t running = 0;
+    bool started = false;
+    bool stopped = false;                   // Failed or cancelled: nothing new starts
+    bool ended = false;
+    QString failedTask;
+    QString error;
+};
+
+#endif // TASKGRAPH_H
@@ -0,0 +1,179 @@
+#include "testing.h"
+#include "../configfile.h"
+
+/* Behaviour tests for BepInEx config files: parsing, and three-way merges of this machine's edits
+ * into a new release's file, including conflicts, local-only settings and dropped settings.
+*/
+
+static ConfigFile parsed(const std::string &text) {
+    ConfigFile file;
+    file.parse(text);
+    return file;
+}
+
+static void testParse() {
+    ConfigFile file = parsed("\xEF\xBB\xBF" "Global = 1\n"
+                             "## A comment = not a setting\n"
+                             "[ General ]\n"
+                             "  Name   =  Some Player  \r\n"
+                             "Command = a=b\n"
+                             "Name = Second\n"
+                             "not a setting\n"
+                             "Empty =\n"
+                             "[Graphics]\n"
+                             "Quality = High");
+    CHECK(file.getEntries().size() == 5);
+
+    const ConfigEntry * global = file.find("", "Global");
+    CHECK(global != nullptr && global->value == "1");
+    CHECK(file.find("", "## A comment") == nullptr);
+
+    // Names and values are trimmed, and the first of two settings with the same name counts
+    const ConfigEntry * name = file.find("General", "Name");
+    CHECK(name != nullptr && name->value == "Some Player");
+    if (name != nullptr) {
+        CHECK(file.getText().substr(name->valueOffset, name->valueLength) == "Some Player");
+    }
+    const ConfigEntry * command = file.find("General", "Command");
+    CHECK(command != nullptr && command->value == "a=b");
+    const ConfigEntry * empty = file.find("General", "Empty");
+    CHECK(empty != nullptr && empty->value.empty());
+
+    // The last line needs no line break
+    const ConfigEntry * quality = file.find("Graphics", "Quality");
+    CHECK(quality != nullptr && quality->value == "High");
+    CHECK(file.find("Graphics", "Name") == nullptr);
+}
+
+static void testMerge() {
+    ConfigFile base = parsed("## Settings file\n"
+                             "[General]\n"
+                             "\n"
+                             "# Whether it's on\n"
+                             "Enabled = true\n"
+                             "Volume = 50\n"
+                             "Name = Player\n"
+                             "Old = 1\n"
+                             "Same = a\n"
+                             "\n"
+                             "[Graphics]\n"
+                             "Quality = High\n");
+    ConfigFile local = parsed("## Settings file\n"
+                              "[General]\n"
+                              "Enabled = false\n"
+                              "Volume = 70\n"
+                              "Name = Player\n"
+                              "Old = 2\n"
+                              "Same = b\n"
+                              "Extra = yes\n"
+                              "[Graphics]\n"
+                              "Quality = High\n"
+                              "[Audio]\n"
+                              "Mute = true\n");
+    ConfigFile release = parsed("## Settings file\n"
+                                "[General]\n"
+                                "\n"
+                                "# Whether it's on\n"
+                                "Enabled = true\n"
+                                "Volume = 60\n"
+                                "Name = Crew\n"
+                                "Same = b\n"
+                                "New = 5\n"
+                                "\n"
+                                "[Graphics]\n"
+                                "Quality = Medium\n");
+
+    /* Enabled: changed here only, kept. Volume: changed on both sides, kept here and counted.
+     * Name: changed in the release only, taken. Old: dropped by the release, dropped.
+     * Same: both made the same change, no conflict. Extra and Mute: only here, kept.
+    */
+    std::size_t conflicts = 99;
+    std::string merged = ConfigFile::merge(base, local, release, &conflicts);
+    CHECK(conflicts == 1);
+    CHECK(merged == "## Settings file\n"
+                    "[General]\n"
+                    "\n"
+                    "# Whether it's on\n"
+                    "Enabled = false\n"
+                    "Volume = 70\n"
+                    "Name = Crew\n"
+                    "Same = b\n"
+                    "New = 5\n"
+                    "Extra = yes\n"
+                    "\n"
+                    "[Graphics]\n"
+                    "Quality = Medium\n"
+                    "\n"
+                    "[Audio]\n"
+                    "\n"
+                    "Mute = true\n");
+
+    // Nothing changed here: the release comes through untouched
+    CHECK(ConfigFile::merge(base, base, release, &conflicts) == release.getText());
+    CHECK(conflicts == 0);
+
+    // Without a base (no earlier release of this file) no value counts as a local edit, and every
+    // setting the release lacks is kept as a local-only one
+    ConfigFile none;
+    merged = ConfigFile::merge(none, local, release, &conflicts);
+    CHECK(conflicts == 0);
+    CHECK(merged == "## Settings file\n"
+                    "[General]\n"
+                    "\n"
+                    "# Whether it's on\n"
+                    "Enabled = true\n"
+                    "Volume = 60\n"
+                    "Name = Crew\n"
+                    "Same = b\n"
+                    "New = 5\n"
+                    "Old = 2\n"
+                    "Extra = yes\n"
+                    "\n"
+                    "[Graphics]\n"
+                    "Quality = Medium\n"
+                    "\n"
+                    "[Audio]\n"
+                    "\n"
+                    "Mute = true\n");
+}
+
+static void testMergeLineEndings() {
+    ConfigFile base = parsed("[General]\r\nValue = 1\r\n");
+    ConfigFile local = parsed("[General]\nValue = 2\nAdded = 3\n[Extra]\nKey = 4\n");
+    ConfigFile release = parsed("# Comment\r\n[General]\r\nValue = 1\r\nOther = 5");
+
+    // Lines added follow the release's line endings, and a last line without one gets one first
+    std::size_t conflicts = 99;
+    std::string merged = ConfigFile::merge(base, local, release, &conflicts);
+    CHECK(conflicts == 0);
+    CHECK(merged == "# Comment\r\n"
+                    "[General]\r\n"
+                    "Value = 2\r\n"
+                    "Other = 5\r\n"
+                    "Added = 3\r\n"
+                    "\r\n"
+                    "[Extra]\r\n"
+                    "\r\n"
+                    "Key = 4\r\n");
+}
+
+static void testLoad(const std::string &directory) {
+    std::string path = directory + "/BepInEx.cfg";
+    writeFile(path, "[Logging]\nEnabled = true\n");
+    ConfigFile file;
+    CHECK(file.load(path));
+    const ConfigEntry * enabled = file.find("Logging", "Enabled");
+    CHECK(enabled != nullptr && enabled->value == "true");
+    CHECK(!file.load(directory + "/missing.cfg"));
+}
+
+int main() {
+    std::string directory = scratchDirectory("config");
+    testParse();
+    testMerge();
+    testMergeLineEndings();
+    testLoad(directory);
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    return finishTests("configtests");
+}
@@ -0,0 +1,120 @@
+#include "testing.h"
+#include "../installplan.h"
+#include <chrono>
+
+/* Behaviour tests for install plans: compare() picks the right action for each kind of difference
+ * between a staged and an installed tree, and apply() turns the installed tree into a copy of the
+ * staged one, so comparing them again leaves nothing to do.
+*/
+
+static const std::filesystem::file_time_type STAGED_TIME = std::filesystem::file_time_type::clock::now() - std::chrono::hours(48);
+static const std::filesystem::file_time_type INSTALLED_TIME = STAGED_TIME - std::chrono::hours(24);
+
+static void writeFileAt(const std::string &path, const std::string &contents, std::filesystem::file_time_type time) {
+    writeFile(path, contents);
+    std::filesystem::last_write_time(path, time);
+}
+
+static const PlanItem * findItem(const InstallPlan &plan, const std::string &path) {
+    for (const PlanItem &item : plan.getItems()) {
+        if (std::filesystem::path(item.path) == std::filesystem::path(path)) {
+            return &item;
+        }
+    }
+    return nullptr;
+}
+
+static bool hasAction(const InstallPlan &plan, const std::string &path, PlanAction action) {
+    const PlanItem * item = findItem(plan, path);
+    return item != nullptr && item->action == action;
+}
+
+/* A staged and an installed tree with one file for each action:
+ *  added.txt      only staged
+ *  resized.txt    different sizes
+ *  retimed.txt    same contents, different times
+ *  rewritten.txt  same size, different contents and times
+ *  kept.txt       same size and time (the contents aren't read, so they may differ)
+ *  extra/old.txt  only installed
+*/
+static void makeTrees(const std::string &staged, const std::string &installed) {
+    writeFileAt(staged + "/added.txt", "new file", STAGED_TIME);
+    writeFileAt(staged + "/sub/resized.txt", "longer contents", STAGED_TIME);
+    writeFileAt(installed + "/sub/resized.txt", "short", INSTALLED_TIME);
+    writeFileAt(staged + "/retimed.txt", "same contents", STAGED_TIME);
+    writeFileAt(installed + "/retimed.txt", "same contents", INSTALLED_TIME);
+    writeFileAt(staged + "/rewritten.txt", "version 2", STAGED_TIME);
+    writeFileAt(installed + "/rewritten.txt", "version 1", INSTALLED_TIME);
+    writeFileAt(staged + "/kept.txt", "unchanged", STAGED_TIME);
+    writeFileAt(installed + "/kept.txt", "unchanged", STAGED_TIME);
+    writeFileAt(installed + "/extra/old.txt", "dropped from the release", INSTALLED_TIME);
+    std::filesystem::create_directories(staged + "/empty");
+}
+
+static void testCompare(const std::string &directory) {
+    std::string staged = directory + "/compare/staged";
+    std::string installed = directory + "/compare/installed";
+    makeTrees(staged, installed);
+
+    InstallPlan plan = InstallPlan::compare(staged, installed);
+    CHECK(plan.getItems().size() == 6);
+    CHECK(hasAction(plan, "added.txt", PlanAction::Add));
+    CHECK(hasAction(plan, "sub/resized.txt", PlanAction::Replace));
+    CHECK(hasAction(plan, "retimed.txt", PlanAction::Touch));
+    CHECK(hasAction(plan, "rewritten.txt", PlanAction::Replace));
+    CHECK(hasAction(plan, "kept.txt", PlanAction::Keep));
+    CHECK(hasAction(plan, "extra/old.txt", PlanAction::Delete));
+    CHECK(plan.count(PlanAction::Replace) == 2);
+    CHECK(plan.bytesToWrite() == 8 + 15 + 9);
+
+    // Items come sorted by path
+    for (std::size_t i = 1; i < plan.getItems().size(); ++i) {
+        CHECK(plan.getItems()[i - 1].path < plan.getItems()[i].path);
+    }
+    CHECK(plan.describe() == "1 to add, 2 to replace, 1 to delete, 1 to retime, 1 unchanged (0 MB to write)");
+
+    // Installed files that aren't staged are left alone in shared trees
+    InstallPlan shared = InstallPlan::compare(staged, installed, false);
+    CHECK(shared.getItems().size() == 5);
+    CHECK(shared.count(PlanAction::Delete) == 0);
+    CHECK(findItem(shared, "extra/old.txt") == nullptr);
+
+    // Nothing installed yet: everything is added
+    InstallPlan fresh = InstallPlan::compare(staged, directory + "/compare/missing");
+    CHECK(fresh.getItems().size() == 5);
+    CHECK(fresh.count(PlanAction::Add) == 5);
+}
+
+static void testApply(const std::string &directory) {
+    std::string staged = directory + "/apply/staged";
+    std::string installed = directory + "/apply/installed";
+    makeTrees(staged, installed);
+
+    PlanResult result = InstallPlan::compare(staged, installed).apply();
+    CHECK(result.failed == 0);
+    CHECK(result.filesWritten + result.filesCloned + result.filesLinked == 3);
+    CHECK(result.filesDeleted == 1);
+
+    CHECK(readFile(installed + "/added.txt") == "new file");
+    CHECK(readFile(installed + "/sub/resized.txt") == "longer contents");
+    CHECK(readFile(installed + "/rewritten.txt") == "version 2");
+    CHECK(std::filesystem::last_write_time(installed + "/retimed.txt") == STAGED_TIME);
+    CHECK(!std::filesystem::exists(installed + "/extra/old.txt"));
+    CHECK(!std::filesystem::exists(installed + "/extra"));
+    CHECK(std::filesystem::is_directory(installed + "/empty"));
+
+    // The trees now match, so a second plan has nothing to do and reads no file to say so
+    InstallPlan again = InstallPlan::compare(staged, installed);
+    CHECK(again.getItems().size() == 5);
+    CHECK(again.count(PlanAction::Keep) == 5);
+    CHECK(again.bytesToWrite() == 0);
+}
+
+int main() {
+    std::string directory = scratchDirectory("installplan");
+    testCompare(directory);
+    testApply(directory);
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    return finishTests("installplantests");
+}
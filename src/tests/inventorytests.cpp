@@ -0,0 +1,310 @@
+#include "testing.h"
+#include "../plugininventory.h"
+#include <memory>
+#include <cstring>
+
+/* Behaviour tests for the plugin inventory: a minimal .NET assembly is built here byte by byte (PE
+ * headers, CLI header, metadata root, streams and the four tables the reader looks into), read with
+ * readAssembly, then truncated and damaged to check that the reader refuses it without reading out
+ * of bounds. The scan and its cache are checked on a plugins folder holding such DLLs.
+*/
+
+// Where things sit in the assembly built below
+static const std::size_t PE_OFFSET = 0x80;
+static const std::size_t SECTION_OFFSET = 0x200;
+static const std::uint32_t SECTION_RVA = 0x2000;
+static const std::size_t ROOT_OFFSET = 0x250;
+
+struct AssemblyLayout
+{
+    std::size_t optionalHeader = 0;
+    std::size_t directoryCount = 0;     // Where NumberOfRvaAndSizes is
+    std::size_t cliDirectory = 0;
+    std::size_t streamHeaders = 0;      // The #~ stream's header; #Strings and #Blob follow it
+};
+
+static std::string serString(const std::string &text) {
+    return std::string(1, static_cast<char>(text.size())) + text;
+}
+
+// Builds a DLL declaring [BepInPlugin("com.example.mymod", "My Mod", "1.0.0")], as a PE32 or a PE32+ file
+static std::string buildAssembly(bool pe32Plus, AssemblyLayout &layout) {
+    // Heaps. Index 0 of each is the empty entry.
+    std::string strings = std::string("\0", 1) + "BepInPlugin" + '\0' + "BepInEx" + '\0' + ".ctor" + '\0' + "MyMod" + '\0';
+    const std::uint32_t pluginName = 1, pluginNamespace = 13, constructorName = 21, assemblyName = 27;
+    std::string pluginArguments = std::string("\x01\x00", 2) + serString("com.example.mymod") + serString("My Mod") + serString("1.0.0")
+                                  + std::string("\x00\x00", 2);
+    std::string brokenArguments = std::string("\x01\x00", 2) + serString("com.example.broken") + "\x7F";
+    std::string blobs = std::string("\0", 1);
+    const std::uint32_t pluginBlob = static_cast<std::uint32_t>(blobs.size());
+    blobs += static_cast<char>(pluginArguments.size()) + pluginArguments;
+    const std::uint32_t brokenBlob = static_cast<std::uint32_t>(blobs.size());
+    blobs += static_cast<char>(brokenArguments.size()) + brokenArguments;
+    while (blobs.size() % 4 != 0) {
+        blobs.push_back('\0');
+    }
+    while (strings.size() % 4 != 0) {
+        strings.push_back('\0');
+    }
+
+    // Tables: TypeRef, MemberRef, CustomAttribute (a plugin and one with broken arguments) and Assembly
+    std::string tables;
+    put32(tables, 0);
+    tables.push_back(2);
+    tables.push_back(0);
+    tables.push_back(0);    // Heap sizes: every heap index is 2 bytes
+    tables.push_back(1);
+    put64(tables, (1ull << 0x01) | (1ull << 0x0A) | (1ull << 0x0C) | (1ull << 0x20));
+    put64(tables, 0);
+    put32(tables, 1);
+    put32(tables, 1);
+    put32(tables, 2);
+    put32(tables, 1);
+    put16(tables, 0);
+    put16(tables, pluginName);
+    put16(tables, pluginNamespace);
+    put16(tables, (1 << 3) | 1);
+    put16(tables, constructorName);
+    put16(tables, 0);
+    put16(tables, (1 << 5) | 14);
+    put16(tables, (1 << 3) | 3);
+    put16(tables, pluginBlob);
+    put16(tables, (1 << 5) | 14);
+    put16(tables, (1 << 3) | 3);
+    put16(tables, brokenBlob);
+    put32(tables, 0x8004);
+    put16(tables, 1);
+    put16(tables, 2);
+    put16(tables, 3);
+    put16(tables, 4);
+    put32(tables, 0);
+    put16(tables, 0);
+    put16(tables, assemblyName);
+    put16(tables, 0);
+    while (tables.size() % 4 != 0) {
+        tables.push_back('\0');
+    }
+
+    // Metadata root, then the stream headers and the streams
+    std::string root;
+    put32(root, 0x424A5342);
+    put16(root, 1);
+    put16(root, 1);
+    put32(root, 0);
+    put32(root, 12);
+    root += std::string("v4.0.30319\0\0", 12);
+    put16(root, 0);
+    put16(root, 3);
+    const std::size_t streamHeaders = root.size();
+    const std::size_t streamsStart = streamHeaders + 12 + 20 + 16;
+    put32(root, static_cast<std::uint32_t>(streamsStart));
+    put32(root, static_cast<std::uint32_t>(tables.size()));
+    root += std::string("#~\0\0", 4);
+    put32(root, static_cast<std::uint32_t>(streamsStart + tables.size()));
+    put32(root, static_cast<std::uint32_t>(strings.size()));
+    root += std::string("#Strings\0\0\0\0", 12);
+    put32(root, static_cast<std::uint32_t>(streamsStart + tables.size() + strings.size()));
+    put32(root, static_cast<std::uint32_t>(blobs.size()));
+    root += std::string("#Blob\0\0\0", 8);
+    root += tables + strings + blobs;
+
+    // DOS header, PE signature and file header
+    std::string file(PE_OFFSET, '\0');
+    file[0] = 'M';
+    file[1] = 'Z';
+    patch32(file, 0x3C, static_cast<std::uint32_t>(PE_OFFSET));
+    file += std::string("PE\0\0", 4);
+    const std::size_t optionalSize = (pe32Plus ? 112 : 96) + 16 * 8;
+    put16(file, pe32Plus ? 0x8664 : 0x14C);
+    put16(file, 1);
+    put32(file, 0);
+    put32(file, 0);
+    put32(file, 0);
+    put16(file, static_cast<std::uint32_t>(optionalSize));
+    put16(file, 0x2102);
+
+    // Optional header: only the magic and the data directories matter here
+    layout.optionalHeader = file.size();
+    std::string optional(optionalSize, '\0');
+    patch32(optional, 0, pe32Plus ? 0x20B : 0x10B);
+    const std::size_t directories = pe32Plus ? 112 : 96;
+    patch32(optional, directories - 4, 16);
+    patch32(optional, directories + 14 * 8, SECTION_RVA);
+    patch32(optional, directories + 14 * 8 + 4, 72);
+    layout.directoryCount = layout.optionalHeader + directories - 4;
+    layout.cliDirectory = layout.optionalHeader + directories + 14 * 8;
+    file += optional;
+
+    // One section holding the CLI header and the metadata
+    const std::size_t sectionLength = ROOT_OFFSET - SECTION_OFFSET + root.size();
+    std::string section(40, '\0');
+    std::memcpy(&section[0], ".text", 5);
+    patch32(section, 8, static_cast<std::uint32_t>(sectionLength));
+    patch32(section, 12, SECTION_RVA);
+    patch32(section, 16, static_cast<std::uint32_t>(sectionLength));
+    patch32(section, 20, static_cast<std::uint32_t>(SECTION_OFFSET));
+    file += section;
+    file.resize(SECTION_OFFSET, '\0');
+
+    std::string cli(72, '\0');
+    patch32(cli, 0, 72);
+    patch32(cli, 8, static_cast<std::uint32_t>(SECTION_RVA + ROOT_OFFSET - SECTION_OFFSET));
+    patch32(cli, 12, static_cast<std::uint32_t>(root.size()));
+    file += cli;
+    file.resize(ROOT_OFFSET, '\0');
+    layout.streamHeaders = ROOT_OFFSET + streamHeaders;
+    file += root;
+    return file;
+}
+
+// Reads a DLL from a buffer of exactly its size, so reading past its end is caught by sanitizers
+static bool read(const std::string &bytes, std::size_t size, PluginRecord &record) {
+    std::unique_ptr<unsigned char[]> copy(new unsigned char[size > 0 ? size : 1]);
+    std::memcpy(copy.get(), bytes.data(), size);
+    return PluginInventory::readAssembly(copy.get(), size, record);
+}
+
+static void testReadAssembly() {
+    for (bool pe32Plus : { false, true }) {
+        AssemblyLayout layout;
+        std::string dll = buildAssembly(pe32Plus, layout);
+        PluginRecord record;
+        CHECK(read(dll, dll.size(), record));
+        CHECK(record.assemblyName == "MyMod");
+        CHECK(record.assemblyVersion == "1.2.3.4");
+
+        // The attribute whose arguments run out is skipped, not read past
+        CHECK(record.plugins.size() == 1);
+        if (record.plugins.size() == 1) {
+            CHECK(record.plugins[0].guid == "com.example.mymod");
+            CHECK(record.plugins[0].name == "My Mod");
+            CHECK(record.plugins[0].version == "1.0.0");
+        }
+    }
+}
+
+static void testTruncatedAssembly() {
+    AssemblyLayout layout;
+    std::string dll = buildAssembly(false, layout);
+    for (std::size_t length = 0; length < dll.size(); ++length) {
+        PluginRecord record;
+        CHECK(!read(dll, length, record));
+        CHECK(record.plugins.empty());
+    }
+}
+
+static void testDamagedAssembly() {
+    AssemblyLayout layout;
+    const std::string dll = buildAssembly(false, layout);
+    PluginRecord record;
+
+    // A native DLL: no CLI header directory, or one left empty
+    std::string native = dll;
+    patch32(native, layout.directoryCount, 14);
+    CHECK(!read(native, native.size(), record));
+    native = dll;
+    patch32(native, layout.cliDirectory, 0);
+    CHECK(!read(native, native.size(), record));
+
+    // Not a PE file at all
+    std::string damaged = dll;
+    damaged[0] = 'X';
+    CHECK(!read(damaged, damaged.size(), record));
+    damaged = dll;
+    patch32(damaged, 0x3C, 0xFFFFFFF0u);
+    CHECK(!read(damaged, damaged.size(), record));
+
+    // Section and optional header sizes reaching past the file
+    damaged = dll;
+    damaged[PE_OFFSET + 6] = static_cast<char>(0xFF);
+    damaged[PE_OFFSET + 7] = static_cast<char>(0xFF);
+    CHECK(!read(damaged, damaged.size(), record));
+    damaged = dll;
+    damaged[PE_OFFSET + 20] = static_cast<char>(0xFF);
+    damaged[PE_OFFSET + 21] = static_cast<char>(0xFF);
+    CHECK(!read(damaged, damaged.size(), record));
+
+    // Metadata root moved outside of the section, or missing its signature
+    damaged = dll;
+    patch32(damaged, SECTION_OFFSET + 8, 0xFFFFFF00u);
+    CHECK(!read(damaged, damaged.size(), record));
+    damaged = dll;
+    damaged[ROOT_OFFSET] = 'X';
+    CHECK(!read(damaged, damaged.size(), record));
+
+    // A stream offset or length past the end of the file
+    damaged = dll;
+    patch32(damaged, layout.streamHeaders, 0xFFFFFF00u);
+    CHECK(!read(damaged, damaged.size(), record));
+    damaged = dll;
+    patch32(damaged, layout.streamHeaders + 4, 0x7FFFFFFFu);
+    CHECK(!read(damaged, damaged.size(), record));
+
+    // A row count larger than the tables stream
+    damaged = dll;
+    const std::size_t tables = layout.streamHeaders + 48;
+    patch32(damaged, tables + 24, 0x00FFFFFFu);
+    CHECK(!read(damaged, damaged.size(), record));
+
+    // Heap indexes past the end of their heaps read as empty rather than out of bounds
+    damaged = dll;
+    const std::size_t assemblyName = tables + 24 + 16 + 6 + 6 + 12 + 18;
+    damaged[assemblyName] = static_cast<char>(0xFF);
+    damaged[assemblyName + 1] = static_cast<char>(0xFF);
+    CHECK(read(damaged, damaged.size(), record));
+    CHECK(record.assemblyName.empty());
+}
+
+static void testScan(const std::string &directory) {
+    AssemblyLayout layout;
+    std::string plugins = directory + "/plugins";
+    writeFile(plugins + "/MyMod/MyMod.dll", buildAssembly(false, layout));
+    writeFile(plugins + "/native.DLL", "MZ not a managed assembly");
+    writeFile(plugins + "/readme.txt", "not a dll");
+
+    PluginInventory inventory;
+    InventoryResult result = inventory.scan(plugins);
+    CHECK(result.filesScanned == 2);
+    CHECK(result.filesRead == 2);
+    CHECK(inventory.countPlugins() == 1);
+    const std::vector<PluginRecord> &records = inventory.getRecords();
+    CHECK(records.size() == 2);
+    if (records.size() == 2) {
+        CHECK(std::filesystem::path(records[0].path) == std::filesystem::path("MyMod/MyMod.dll"));
+        CHECK(records[0].managed && records[0].assemblyName == "MyMod");
+        CHECK(!records[1].managed);
+    }
+    CHECK(inventory.report().find("com.example.mymod") != std::string::npos);
+
+    // Unchanged DLLs aren't read again, in the same inventory or in one loaded from the cache
+    CHECK(inventory.scan(plugins).filesRead == 0);
+    std::string cachePath = directory + "/inventory.cache";
+    CHECK(inventory.save(cachePath));
+    PluginInventory cached;
+    CHECK(cached.load(cachePath));
+    CHECK(cached.countPlugins() == 1);
+    result = cached.scan(plugins);
+    CHECK(result.filesScanned == 2);
+    CHECK(result.filesRead == 0);
+    CHECK(cached.report() == inventory.report());
+
+    // A removed DLL is dropped
+    std::filesystem::remove(plugins + "/MyMod/MyMod.dll");
+    CHECK(cached.scan(plugins).filesScanned == 1);
+    CHECK(cached.countPlugins() == 0);
+
+    writeFile(cachePath, "SOMETHING ELSE\n");
+    CHECK(!cached.load(cachePath));
+    CHECK(cached.getRecords().empty());
+}
+
+int main() {
+    std::string directory = scratchDirectory("inventory");
+    testReadAssembly();
+    testTruncatedAssembly();
+    testDamagedAssembly();
+    testScan(directory);
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    return finishTests("inventorytests");
+}
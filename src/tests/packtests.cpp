@@ -0,0 +1,185 @@
+#include "testing.h"
+#include "../packarchive.h"
+
+/* Behaviour tests for the zstd pack container: a zip repacked and extracted again comes back
+ * byte for byte, and truncated, corrupt or crafted containers are refused by readLayout (through
+ * verify, extract and listEntries) instead of being read out of bounds.
+*/
+
+static const std::size_t FOOTER_SIZE = 24;
+
+static std::string largeContents() {
+    std::string contents;
+    for (std::uint32_t i = 0; contents.size() < (5u << 20); ++i) {
+        contents += std::to_string(i * 2654435761u) + ",";
+    }
+    return contents;
+}
+
+// Builds a release zip and its pack. The large file gets a frame of its own.
+static bool makePack(const std::string &directory, std::string &packPath) {
+    ZipWriter writer;
+    writer.add("pack/", "");
+    writer.add("pack/BepInEx/plugins/a.dll", "plugin contents", true);
+    writer.add("pack/BepInEx/config/b.cfg", "[General]\nValue = 1\n");
+    writer.add("pack/BepInEx/large.bin", largeContents(), true);
+    std::string zipPath = directory + "/release.zip";
+    writeFile(zipPath, writer.finish());
+    packPath = PackArchive::packPathFor(zipPath);
+    return PackArchive::transcode(zipPath, packPath, 3);
+}
+
+// Reads the footer's offset of the frame and file tables
+static std::uint64_t tablesOffset(const std::string &bytes) {
+    std::uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | static_cast<unsigned char>(bytes[bytes.size() - FOOTER_SIZE + i]);
+    }
+    return value;
+}
+
+static bool verifies(const std::string &path, const std::string &bytes) {
+    writeFile(path, bytes);
+    std::string problem;
+    return PackArchive::verify(path, problem);
+}
+
+static void testRoundTrip(const std::string &directory, const std::string &packPath) {
+    std::string problem;
+    CHECK(PackArchive::isPack(packPath));
+    CHECK(PackArchive::verify(packPath, problem));
+    CHECK(PackArchive::findRootFolder(packPath) == "pack/");
+    std::vector<ZipEntry> entries = PackArchive::listEntries(packPath);
+    CHECK(entries.size() == 4);
+
+    std::string target = directory + "/extracted";
+    ExtractStats stats;
+    CHECK(PackArchive::extract(packPath, { { "pack/", target } }, &stats) == 0);
+    CHECK(stats.files == 3);
+    CHECK(stats.failed == 0);
+    CHECK(readFile(target + "/BepInEx/plugins/a.dll") == "plugin contents");
+    CHECK(readFile(target + "/BepInEx/config/b.cfg") == "[General]\nValue = 1\n");
+    CHECK(readFile(target + "/BepInEx/large.bin") == largeContents());
+
+    // Only the requested subtree is written
+    std::string partial = directory + "/partial";
+    CHECK(PackArchive::extract(packPath, { { "pack/BepInEx/plugins/", partial } }, &stats) == 0);
+    CHECK(stats.files == 1);
+    CHECK(std::filesystem::exists(partial + "/a.dll"));
+    CHECK(!std::filesystem::exists(partial + "/b.cfg"));
+}
+
+static void testCorruptFrame(const std::string &directory, const std::string &packPath) {
+    std::string bytes = readFile(packPath);
+
+    // Damage the end of the large file's frame (only the plugin's small frame follows it)
+    std::string damaged = bytes;
+    std::size_t middle = static_cast<std::size_t>(tablesOffset(bytes)) - 100;
+    for (std::size_t i = middle; i < middle + 16; ++i) {
+        damaged[i] = static_cast<char>(damaged[i] ^ 0x5A);
+    }
+    std::string damagedPath = directory + "/damaged.zpk";
+    writeFile(damagedPath, damaged);
+
+    // The tables still read, but extraction reports the failed file instead of succeeding
+    std::string problem;
+    CHECK(PackArchive::verify(damagedPath, problem));
+    ExtractStats stats;
+    CHECK(PackArchive::extract(damagedPath, { { "pack/", directory + "/damaged" } }, &stats) == -1);
+    CHECK(stats.failed == 1);
+    CHECK(stats.files == 2);
+
+    // Frames holding no requested files aren't decompressed, so they can't fail the extraction
+    CHECK(PackArchive::extract(damagedPath, { { "pack/BepInEx/plugins/", directory + "/untouched" } }, &stats) == 0);
+    CHECK(stats.files == 1);
+}
+
+static void testTruncatedPack(const std::string &directory, const std::string &packPath) {
+    std::string bytes = readFile(packPath);
+    std::string truncatedPath = directory + "/truncated.zpk";
+
+    // Cut short anywhere in the tables or footer (and at a sample of points in the frames)
+    std::size_t tables = static_cast<std::size_t>(tablesOffset(bytes));
+    for (std::size_t length = 0; length < bytes.size(); length += (length < 64 || length >= tables) ? 1 : 4093) {
+        CHECK(!verifies(truncatedPath, bytes.substr(0, length)));
+    }
+    CHECK(PackArchive::extract(truncatedPath, { { "pack/", directory + "/truncated" } }) == -1);
+    CHECK(PackArchive::listEntries(truncatedPath).empty());
+    CHECK(PackArchive::findRootFolder(truncatedPath).empty());
+
+    std::string problem;
+    CHECK(!PackArchive::verify(directory + "/missing.zpk", problem));
+}
+
+static void testCraftedLayout(const std::string &directory, const std::string &packPath) {
+    std::string bytes = readFile(packPath);
+    std::string craftedPath = directory + "/crafted.zpk";
+    const std::size_t footer = bytes.size() - FOOTER_SIZE;
+    const std::size_t tables = static_cast<std::size_t>(tablesOffset(bytes));
+    const std::size_t frames = tables + 8;
+
+    CHECK(verifies(craftedPath, bytes));
+
+    // Footer pointing the tables past the end, or wrapping around
+    std::string crafted = bytes;
+    patch64(crafted, footer, 0xFFFFFFFFFFFFFFF0ull);
+    patch64(crafted, footer + 8, 0x10 + bytes.size() - FOOTER_SIZE);
+    CHECK(!verifies(craftedPath, crafted));
+    crafted = bytes;
+    patch64(crafted, footer + 8, 0xFFFFFFFFFFFFFFFFull);
+    CHECK(!verifies(craftedPath, crafted));
+
+    // Missing magic, or a version this build doesn't read
+    crafted = bytes;
+    crafted[0] = 'X';
+    CHECK(!verifies(craftedPath, crafted));
+    crafted = bytes;
+    crafted[footer + 20] = 2;
+    CHECK(!verifies(craftedPath, crafted));
+
+    // More frames than the tables hold
+    crafted = bytes;
+    patch64(crafted, tables, 0xFFFFFFFFFFFFFFFFull);
+    CHECK(!verifies(craftedPath, crafted));
+
+    // A frame reaching into the tables, or wrapping around
+    crafted = bytes;
+    patch64(crafted, frames + 8, tables);
+    CHECK(!verifies(craftedPath, crafted));
+    crafted = bytes;
+    patch64(crafted, frames, 0xFFFFFFFFFFFFFF00ull);
+    CHECK(!verifies(craftedPath, crafted));
+
+    // The first file record: frame index, then offset and size within the frame, CRC and name length
+    std::uint64_t frameCount = 0;
+    for (int i = 7; i >= 0; --i) {
+        frameCount = (frameCount << 8) | static_cast<unsigned char>(bytes[tables + i]);
+    }
+    const std::size_t file = frames + static_cast<std::size_t>(frameCount) * 24 + 8;
+
+    crafted = bytes;
+    patch32(crafted, file, static_cast<std::uint32_t>(frameCount));
+    CHECK(!verifies(craftedPath, crafted));
+    crafted = bytes;
+    patch64(crafted, file + 4, 1);
+    patch64(crafted, file + 12, 0xFFFFFFFFFFFFFFFFull);
+    CHECK(!verifies(craftedPath, crafted));
+    crafted = bytes;
+    patch32(crafted, file + 24, 0xFFFFFFFFu);
+    CHECK(!verifies(craftedPath, crafted));
+}
+
+int main() {
+    std::string directory = scratchDirectory("pack");
+    std::string packPath;
+    CHECK(makePack(directory, packPath));
+    if (checksFailed == 0) {
+        testRoundTrip(directory, packPath);
+        testCorruptFrame(directory, packPath);
+        testTruncatedPack(directory, packPath);
+        testCraftedLayout(directory, packPath);
+    }
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    return finishTests("packtests");
+}
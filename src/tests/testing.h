@@ -0,0 +1,170 @@
+#ifndef TESTING_H
+#define TESTING_H
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <zlib.h>
+
+/* What the behaviour tests share: a CHECK that reports the failing line and keeps going, a scratch
+ * folder per test program, and a writer for small zip archives, so every test builds the exact
+ * bytes it needs (including damaged ones) instead of depending on files checked into the repo.
+*/
+
+static int checksFailed = 0;
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++checksFailed;                                                                    \
+        }                                                                                      \
+    } while (0)
+
+// Returns the exit code for the test program: 0 only if every check passed
+inline int finishTests(const char * name) {
+    if (checksFailed > 0) {
+        std::fprintf(stderr, "%s: %d check(s) failed\n", name, checksFailed);
+        return 1;
+    }
+    std::printf("%s: all checks passed\n", name);
+    return 0;
+}
+
+// Creates an empty scratch folder for a test program, under the system's temporary folder
+inline std::string scratchDirectory(const std::string &name) {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / ("modpack_tests_" + name);
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    std::filesystem::create_directories(directory);
+    return directory.string();
+}
+
+inline void writeFile(const std::string &path, const std::string &contents) {
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+}
+
+inline std::string readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Little-endian encoding into a byte string
+inline void put16(std::string &out, std::uint32_t value) {
+    for (int i = 0; i < 2; ++i) { out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF)); }
+}
+inline void put32(std::string &out, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) { out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF)); }
+}
+inline void put64(std::string &out, std::uint64_t value) {
+    for (int i = 0; i < 8; ++i) { out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF)); }
+}
+inline void patch32(std::string &bytes, std::size_t offset, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) { bytes[offset + i] = static_cast<char>((value >> (8 * i)) & 0xFF); }
+}
+inline void patch64(std::string &bytes, std::size_t offset, std::uint64_t value) {
+    for (int i = 0; i < 8; ++i) { bytes[offset + i] = static_cast<char>((value >> (8 * i)) & 0xFF); }
+}
+
+// A small zip archive built in memory: stored or deflated entries, a central directory and its end record
+class ZipWriter
+{
+public:
+    void add(const std::string &name, const std::string &contents, bool deflate = false) {
+        Entry entry;
+        entry.name = name;
+        entry.size = contents.size();
+        entry.crc = static_cast<std::uint32_t>(crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef *>(contents.data()),
+                                                      static_cast<uInt>(contents.size())));
+        entry.method = deflate ? 8 : 0;
+        entry.data = deflate ? rawDeflate(contents) : contents;
+        entry.offset = bytes.size();
+
+        put32(bytes, 0x04034b50);
+        put16(bytes, 20);
+        put16(bytes, 0);
+        put16(bytes, entry.method);
+        put32(bytes, 0);
+        put32(bytes, entry.crc);
+        put32(bytes, static_cast<std::uint32_t>(entry.data.size()));
+        put32(bytes, static_cast<std::uint32_t>(entry.size));
+        put16(bytes, static_cast<std::uint32_t>(name.size()));
+        put16(bytes, 0);
+        bytes += name;
+        bytes += entry.data;
+        entries.push_back(entry);
+    }
+
+    // Returns the finished archive. directoryOffset is where the central directory starts.
+    std::string finish() {
+        directoryOffset = bytes.size();
+        for (const Entry &entry : entries) {
+            put32(bytes, 0x02014b50);
+            put16(bytes, 20);
+            put16(bytes, 20);
+            put16(bytes, 0);
+            put16(bytes, entry.method);
+            put32(bytes, 0);
+            put32(bytes, entry.crc);
+            put32(bytes, static_cast<std::uint32_t>(entry.data.size()));
+            put32(bytes, static_cast<std::uint32_t>(entry.size));
+            put16(bytes, static_cast<std::uint32_t>(entry.name.size()));
+            put16(bytes, 0);
+            put16(bytes, 0);
+            put16(bytes, 0);
+            put16(bytes, 0);
+            put32(bytes, 0);
+            put32(bytes, static_cast<std::uint32_t>(entry.offset));
+            bytes += entry.name;
+        }
+        std::size_t directorySize = bytes.size() - directoryOffset;
+        endOffset = bytes.size();
+        put32(bytes, 0x06054b50);
+        put16(bytes, 0);
+        put16(bytes, 0);
+        put16(bytes, static_cast<std::uint32_t>(entries.size()));
+        put16(bytes, static_cast<std::uint32_t>(entries.size()));
+        put32(bytes, static_cast<std::uint32_t>(directorySize));
+        put32(bytes, static_cast<std::uint32_t>(directoryOffset));
+        put16(bytes, 0);
+        return bytes;
+    }
+
+    std::size_t directoryOffset = 0;    // Set by finish()
+    std::size_t endOffset = 0;          // Where the end of central directory record starts, set by finish()
+
+private:
+    struct Entry
+    {
+        std::string name;
+        std::string data;
+        std::uint64_t size = 0;
+        std::uint32_t crc = 0;
+        std::uint32_t method = 0;
+        std::size_t offset = 0;
+    };
+
+    static std::string rawDeflate(const std::string &contents) {
+        z_stream stream = {};
+        deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+        std::string output(deflateBound(&stream, static_cast<uLong>(contents.size())), '\0');
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(contents.data()));
+        stream.avail_in = static_cast<uInt>(contents.size());
+        stream.next_out = reinterpret_cast<Bytef *>(&output[0]);
+        stream.avail_out = static_cast<uInt>(output.size());
+        deflate(&stream, Z_FINISH);
+        output.resize(stream.total_out);
+        deflateEnd(&stream);
+        return output;
+    }
+
+    std::string bytes;
+    std::vector<Entry> entries;
+};
+
+#endif // TESTING_H
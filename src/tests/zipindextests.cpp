@@ -0,0 +1,111 @@
+#include "testing.h"
+#include "../zipindex.h"
+
+/* Behaviour tests for the zip entry index: building, lookups and recovery from a stale or damaged
+ * index, and verifyArchive on complete, truncated and inconsistent archives.
+*/
+
+static std::string sampleArchive(ZipWriter &writer) {
+    writer.add("BepInEx/plugins/a.dll", "first plugin");
+    writer.add("BepInEx/config/b.cfg", std::string(4000, 'x') + "end", true);
+    writer.add("BepInEx/empty.txt", "");
+    return writer.finish();
+}
+
+static void testZipIndex(const std::string &directory) {
+    ZipWriter writer;
+    writer.add("b.txt", "bee");
+    writer.add("a.txt", "ay");
+    writer.add("c/d.txt", "dee", true);
+    std::string bytes = writer.finish();
+    std::string archivePath = directory + "/release.zip";
+    writeFile(archivePath, bytes);
+
+    // No index yet
+    ZipIndex index;
+    CHECK(!index.open(archivePath));
+
+    CHECK(ZipIndex::build(archivePath));
+    CHECK(index.open(archivePath));
+    CHECK(index.size() == 3);
+    CHECK(index.totalUncompressedSize() == 8);
+    ZipEntry found;
+    CHECK(index.find("a.txt", found));
+    CHECK(found.uncompressedSize == 2);
+    CHECK(index.find("c/d.txt", found));
+    CHECK(found.method == 8);
+    CHECK(!index.find("missing.txt", found));
+    CHECK(!index.find("", found));
+    std::vector<ZipEntry> sorted = index.entries();
+    CHECK(sorted.size() == 3 && sorted[0].name == "a.txt" && sorted[1].name == "b.txt" && sorted[2].name == "c/d.txt");
+    index.close();
+
+    // A record whose name lies outside of the name table is rebuilt on open
+    std::string indexPath = ZipIndex::indexPathFor(archivePath);
+    std::string stored = readFile(indexPath);
+    std::string damaged = stored;
+    patch32(damaged, 40, 0xFFFFFF00u);
+    writeFile(indexPath, damaged);
+    CHECK(index.open(archivePath));
+    CHECK(index.find("b.txt", found));
+    index.close();
+    CHECK(readFile(indexPath) == stored);
+
+    // So is one claiming more records than the file holds
+    damaged = stored;
+    patch64(damaged, 24, 0xFFFFFFFFFFFFFFFFull);
+    writeFile(indexPath, damaged);
+    CHECK(index.open(archivePath));
+    CHECK(index.size() == 3);
+    index.close();
+
+    // An index left behind by a different archive isn't used
+    ZipWriter other;
+    other.add("only.txt", "a different release");
+    writeFile(archivePath, other.finish());
+    CHECK(!index.open(archivePath));
+    CHECK(ZipIndex::build(archivePath));
+    CHECK(index.open(archivePath));
+    CHECK(index.size() == 1);
+    index.close();
+
+    // A damaged archive can't be indexed
+    std::string truncatedPath = directory + "/truncated.zip";
+    writeFile(truncatedPath, bytes.substr(0, bytes.size() - 30));
+    CHECK(!ZipIndex::build(truncatedPath));
+}
+
+static void testVerifyArchive(const std::string &directory) {
+    ZipWriter writer;
+    std::string bytes = sampleArchive(writer);
+    std::string problem;
+
+    std::string validPath = directory + "/valid.zip";
+    writeFile(validPath, bytes);
+    CHECK(ZipIndex::verifyArchive(validPath, problem));
+
+    // A download cut short loses its central directory
+    std::string truncatedPath = directory + "/truncated.zip";
+    writeFile(truncatedPath, bytes.substr(0, bytes.size() / 2));
+    CHECK(!ZipIndex::verifyArchive(truncatedPath, problem));
+    CHECK(problem.find("central directory") != std::string::npos);
+
+    // An entry pointing past the end of the archive
+    std::string misplacedPath = directory + "/misplaced.zip";
+    std::string misplaced = bytes;
+    patch32(misplaced, writer.directoryOffset + 42, static_cast<std::uint32_t>(bytes.size() - 4));
+    writeFile(misplacedPath, misplaced);
+    CHECK(!ZipIndex::verifyArchive(misplacedPath, problem));
+    CHECK(problem.find("BepInEx/plugins/a.dll") != std::string::npos);
+
+    CHECK(!ZipIndex::verifyArchive(directory + "/missing.zip", problem));
+}
+
+int main() {
+    std::string directory = scratchDirectory("zipindex");
+    testZipIndex(directory);
+    testVerifyArchive(directory);
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    return finishTests("zipindextests");
+}
@@ -0,0 +1,231 @@
+#include "testing.h"
+#include "../ziphandler.h"
+#include <memory>
+#include <cstring>
+
+/* Behaviour tests for the zip layout code: readCentralDirectory, findEntryData and decodeEntry on
+ * valid, truncated and crafted archives, and mapEntryPath keeping entries inside their destination.
+*/
+
+// Copies bytes into a buffer of exactly that size, so reading past its end is caught by sanitizers
+static std::unique_ptr<unsigned char[]> exactCopy(const std::string &bytes, std::size_t size) {
+    std::unique_ptr<unsigned char[]> copy(new unsigned char[size > 0 ? size : 1]);
+    std::memcpy(copy.get(), bytes.data(), size);
+    return copy;
+}
+
+static bool parse(const std::string &bytes, std::vector<ZipEntry> &entries) {
+    std::unique_ptr<unsigned char[]> copy = exactCopy(bytes, bytes.size());
+    return ZipHandler::readCentralDirectory(copy.get(), bytes.size(), entries);
+}
+
+static std::string sampleArchive(ZipWriter &writer) {
+    writer.add("BepInEx/plugins/a.dll", "first plugin");
+    writer.add("BepInEx/config/b.cfg", std::string(4000, 'x') + "end", true);
+    writer.add("BepInEx/empty.txt", "");
+    return writer.finish();
+}
+
+static void testValidArchive() {
+    ZipWriter writer;
+    std::string bytes = sampleArchive(writer);
+    std::vector<ZipEntry> entries;
+    CHECK(parse(bytes, entries));
+    CHECK(entries.size() == 3);
+    if (entries.size() != 3) {
+        return;
+    }
+    CHECK(entries[0].name == "BepInEx/plugins/a.dll");
+    CHECK(entries[0].method == 0);
+    CHECK(entries[0].uncompressedSize == 12);
+    CHECK(entries[1].method == 8);
+    CHECK(entries[1].uncompressedSize == 4003);
+    CHECK(entries[1].compressedSize < entries[1].uncompressedSize);
+
+    // Every entry decodes to its original contents
+    std::unique_ptr<unsigned char[]> data = exactCopy(bytes, bytes.size());
+    std::string first(12, '\0');
+    CHECK(ZipHandler::decodeEntry(data.get(), bytes.size(), entries[0], &first[0]));
+    CHECK(first == "first plugin");
+    std::string second(4003, '\0');
+    CHECK(ZipHandler::decodeEntry(data.get(), bytes.size(), entries[1], &second[0]));
+    CHECK(second == std::string(4000, 'x') + "end");
+    CHECK(ZipHandler::decodeEntry(data.get(), bytes.size(), entries[2], nullptr));
+
+    // A comment after the end record doesn't hide it
+    std::string commented = bytes;
+    commented[writer.endOffset + 20] = 5;
+    commented += "hello";
+    CHECK(parse(commented, entries));
+    CHECK(entries.size() == 3);
+}
+
+static void testTruncatedArchive() {
+    ZipWriter writer;
+    std::string bytes = sampleArchive(writer);
+    std::vector<ZipEntry> entries;
+    for (std::size_t length = 0; length < bytes.size(); ++length) {
+        std::unique_ptr<unsigned char[]> copy = exactCopy(bytes, length);
+        CHECK(!ZipHandler::readCentralDirectory(copy.get(), length, entries));
+    }
+    CHECK(!ZipHandler::readCentralDirectory(nullptr, 0, entries));
+}
+
+static void testCorruptDirectory() {
+    ZipWriter writer;
+    std::string bytes = sampleArchive(writer);
+    std::vector<ZipEntry> entries;
+
+    // Directory offset past the end, or directory size reaching past it
+    std::string offset = bytes;
+    patch32(offset, writer.endOffset + 16, 0xFFFFFFF0u);
+    CHECK(!parse(offset, entries));
+    std::string size = bytes;
+    patch32(size, writer.endOffset + 12, static_cast<std::uint32_t>(bytes.size()));
+    CHECK(!parse(size, entries));
+
+    // More entries than the directory holds
+    std::string count = bytes;
+    count[writer.endOffset + 10] = 4;
+    CHECK(!parse(count, entries));
+
+    // A name running past the end of the directory
+    std::string name = bytes;
+    name[writer.directoryOffset + 28] = static_cast<char>(0xFF);
+    name[writer.directoryOffset + 29] = static_cast<char>(0xFF);
+    CHECK(!parse(name, entries));
+
+    // A damaged header signature
+    std::string signature = bytes;
+    signature[writer.directoryOffset] = 'X';
+    CHECK(!parse(signature, entries));
+}
+
+static void testZip64Locator() {
+    ZipWriter writer;
+    std::string bytes = sampleArchive(writer);
+    std::vector<ZipEntry> entries;
+
+    // Marks the end record as Zip64 and puts a locator in front of it, pointing at zip64Offset
+    auto withLocator = [&](std::uint64_t zip64Offset) {
+        std::string crafted = bytes.substr(0, writer.endOffset);
+        put32(crafted, 0x07064b50);
+        put32(crafted, 0);
+        put64(crafted, zip64Offset);
+        put32(crafted, 1);
+        std::string end = bytes.substr(writer.endOffset);
+        patch32(end, 16, 0xFFFFFFFFu);
+        return crafted + end;
+    };
+
+    // Offsets that would wrap around when the record size is added to them
+    CHECK(!parse(withLocator(0xFFFFFFFFFFFFFFF0ull), entries));
+    CHECK(!parse(withLocator(bytes.size() + 24 - 8), entries));
+
+    // A locator that points at something other than a Zip64 record
+    CHECK(!parse(withLocator(0), entries));
+
+    // The Zip64 marker without any locator
+    std::string missing = bytes;
+    patch32(missing, writer.endOffset + 16, 0xFFFFFFFFu);
+    CHECK(!parse(missing, entries));
+}
+
+static void testEntryData() {
+    ZipWriter writer;
+    std::string bytes = sampleArchive(writer);
+    std::vector<ZipEntry> entries;
+    CHECK(parse(bytes, entries));
+    if (entries.size() != 3) {
+        return;
+    }
+    std::unique_ptr<unsigned char[]> data = exactCopy(bytes, bytes.size());
+
+    CHECK(ZipHandler::findEntryData(data.get(), bytes.size(), entries[0]) != nullptr);
+
+    // Header offsets past the end, including ones that wrap around
+    ZipEntry outside = entries[0];
+    outside.localHeaderOffset = bytes.size() - 10;
+    CHECK(ZipHandler::findEntryData(data.get(), bytes.size(), outside) == nullptr);
+    outside.localHeaderOffset = 0xFFFFFFFFFFFFFFF0ull;
+    CHECK(ZipHandler::findEntryData(data.get(), bytes.size(), outside) == nullptr);
+
+    // Data running past the end
+    ZipEntry tooLong = entries[0];
+    tooLong.compressedSize = bytes.size();
+    CHECK(ZipHandler::findEntryData(data.get(), bytes.size(), tooLong) == nullptr);
+    tooLong.compressedSize = 0xFFFFFFFFFFFFFFFFull;
+    CHECK(ZipHandler::findEntryData(data.get(), bytes.size(), tooLong) == nullptr);
+
+    // Not pointing at a local header
+    ZipEntry misplaced = entries[0];
+    misplaced.localHeaderOffset = 1;
+    CHECK(ZipHandler::findEntryData(data.get(), bytes.size(), misplaced) == nullptr);
+
+    // Damaged contents fail the CRC check, for stored and deflated entries alike
+    std::string damaged = bytes;
+    damaged[30 + entries[0].name.size()] ^= 0x01;
+    std::unique_ptr<unsigned char[]> damagedData = exactCopy(damaged, damaged.size());
+    std::string output(12, '\0');
+    CHECK(!ZipHandler::decodeEntry(damagedData.get(), damaged.size(), entries[0], &output[0]));
+
+    ZipEntry wrongCrc = entries[1];
+    wrongCrc.crc ^= 1;
+    std::string second(4003, '\0');
+    CHECK(!ZipHandler::decodeEntry(data.get(), bytes.size(), wrongCrc, &second[0]));
+
+    // A deflated entry claiming more data than its stream holds
+    ZipEntry wrongSize = entries[1];
+    wrongSize.uncompressedSize = 5000;
+    std::string larger(5000, '\0');
+    CHECK(!ZipHandler::decodeEntry(data.get(), bytes.size(), wrongSize, &larger[0]));
+}
+
+static void testContainedPaths(const std::string &directory) {
+    std::string destination = directory + "/out";
+    std::vector<PathMapping> mappings = { { "pack/", destination } };
+    std::vector<PathMapping> whole = { { "", destination } };
+    std::string fullPath;
+
+    CHECK(ZipHandler::mapEntryPath("pack/BepInEx/a.dll", mappings, fullPath));
+    CHECK(fullPath == destination + "/BepInEx/a.dll");
+    CHECK(ZipHandler::mapEntryPath("pack/..data/a..b", mappings, fullPath));
+
+    // Parent segments, roots and drives, with either slash
+    CHECK(!ZipHandler::mapEntryPath("pack/../evil.txt", mappings, fullPath));
+    CHECK(!ZipHandler::mapEntryPath("pack/BepInEx/../../evil.txt", mappings, fullPath));
+    CHECK(!ZipHandler::mapEntryPath("pack/..\\evil.txt", mappings, fullPath));
+    CHECK(!ZipHandler::mapEntryPath("pack/..", mappings, fullPath));
+    CHECK(!ZipHandler::mapEntryPath("pack//etc/evil.txt", mappings, fullPath));
+    CHECK(!ZipHandler::mapEntryPath("pack/\\evil.txt", mappings, fullPath));
+    CHECK(!ZipHandler::mapEntryPath("pack/C:/evil.txt", mappings, fullPath));
+    CHECK(!ZipHandler::mapEntryPath("../evil.txt", whole, fullPath));
+    CHECK(!ZipHandler::mapEntryPath("/evil.txt", whole, fullPath));
+
+    // Extraction writes the contained entries and nothing outside of the destination
+    ZipWriter writer;
+    writer.add("pack/", "");
+    writer.add("pack/good.txt", "kept");
+    writer.add("pack/../evil.txt", "escaped", true);
+    writer.add("pack/sub/../../evil2.txt", "escaped");
+    std::string archivePath = directory + "/slip.zip";
+    writeFile(archivePath, writer.finish());
+    ZipHandler::setIncremental(false);
+    ZipHandler::extractMapped(archivePath, mappings);
+    CHECK(readFile(destination + "/good.txt") == "kept");
+    CHECK(!std::filesystem::exists(directory + "/evil.txt"));
+    CHECK(!std::filesystem::exists(directory + "/evil2.txt"));
+}
+
+int main() {
+    std::string directory = scratchDirectory("zip");
+    testValidArchive();
+    testTruncatedArchive();
+    testCorruptDirectory();
+    testZip64Locator();
+    testEntryData();
+    testContainedPaths(directory);
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    return finishTests("ziptests");
+}
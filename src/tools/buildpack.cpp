@@ -0,0 +1,33 @@
+#include "../packbuilder.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+/* Builds a modpack release zip from a pack folder holding plugins/, patchers/ and config/.
+ * Usage: buildpack <pack directory> <output.zip> [level] [threads]
+ *
+ * The archive's root folder is named after the pack directory, and a hash manifest is
+ * written to <output.zip>.sha256.
+*/
+int main(int argc, char * argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: buildpack <pack directory> <output.zip> [level] [threads]\n";
+        return 1;
+    }
+
+    std::string packDirectory = argv[1];
+    std::string archive = argv[2];
+    int level = argc > 3 ? std::stoi(argv[3]) : 9;
+    unsigned threads = argc > 4 ? static_cast<unsigned>(std::stoul(argv[4])) : 0;
+
+    const auto startTime = std::chrono::steady_clock::now();
+    if (!PackBuilder::build(packDirectory, archive, level, threads)) {
+        std::cerr << "Build failed.\n";
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::cout << "Built " << archive << " in " << seconds << "s\n"
+              << "Manifest: " << PackBuilder::manifestPathFor(archive) << "\n";
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include "../ziphandler.h"
+#include "../iobackend.h"
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+/* Benchmarks ZipHandler::extract against a given archive.
+ * Usage: extractbench <archive.zip> <output directory> [runs] [libzip|mapped] [sync|uring]
+ *
+ * The output directory is wiped before every run so each run is a cold write.
+*/
+int main(int argc, char * argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: extractbench <archive.zip> <output directory> [runs] [libzip|mapped] [sync|uring]\n";
+        return 1;
+    }
+
+    std::string archive = argv[1];
+    std::string output = argv[2];
+    int runs = argc > 3 ? std::stoi(argv[3]) : 5;
+    std::string engine = argc > 4 ? argv[4] : "mapped";
+    ZipHandler::setEngine(engine == "libzip" ? ExtractEngine::Libzip : ExtractEngine::Mapped);
+    std::string io = argc > 5 ? argv[5] : "sync";
+    IoBackend::setEngine(io == "uring" ? IoEngine::Uring : IoEngine::Sync);
+    if (io == "uring" && !IoBackend::isAvailable(IoEngine::Uring)) {
+        std::cout << "io_uring is not available; writing synchronously.\n";
+    }
+    std::cout << "Engine: " << engine << ", I/O: " << io << "\n";
+
+    double totalFilesPerSecond = 0.0;
+    double totalMegabytesPerSecond = 0.0;
+    for (int run = 1; run <= runs; ++run) {
+        std::filesystem::remove_all(output);
+
+        ExtractStats stats;
+        if (ZipHandler::extract(archive, output, &stats) != 0) {
+            std::cerr << "Extraction failed.\n";
+            return 1;
+        }
+
+        std::cout << "Run " << run << ": " << stats.files << " files, " << stats.bytes << " bytes, "
+                  << stats.seconds << "s, " << stats.filesPerSecond() << " files/s, "
+                  << stats.megabytesPerSecond() << " MB/s\n";
+        totalFilesPerSecond += stats.filesPerSecond();
+        totalMegabytesPerSecond += stats.megabytesPerSecond();
+    }
+
+    std::cout << "Average: " << totalFilesPerSecond / runs << " files/s, "
+              << totalMegabytesPerSecond / runs << " MB/s\n";
+    return 0;
+}
@@ -0,0 +1,30 @@
+#include "../plugininventory.h"
+#include <iostream>
+#include <string>
+
+/* Prints an inventory of the DLLs in a plugins folder as a tab-separated table, for comparing installs across machines.
+ * Usage: inventory <plugins directory> [cache file]
+ *
+ * With a cache file, DLLs whose size and modification time haven't changed since the last run aren't read again.
+*/
+int main(int argc, char * argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: inventory <plugins directory> [cache file]\n";
+        return 1;
+    }
+
+    PluginInventory inventory;
+    std::string cachePath = argc > 2 ? argv[2] : "";
+    if (!cachePath.empty()) {
+        inventory.load(cachePath);
+    }
+    InventoryResult result = inventory.scan(argv[1]);
+    if (!cachePath.empty() && !inventory.save(cachePath)) {
+        return 1;
+    }
+
+    std::cout << inventory.report();
+    std::cerr << result.filesScanned << " DLLs declaring " << inventory.countPlugins() << " BepInEx plugins, "
+              << result.filesRead << " read in " << result.seconds << "s\n";
+    return 0;
+}
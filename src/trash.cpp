@@ -0,0 +1,96 @@
+#include "trash.h"
+#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Name of the trash folder kept next to removed folders
+static const char * TRASH_NAME = ".modpack_trash";
+
+// Distinguishes folders trashed within the same clock tick
+static std::atomic<unsigned> trashCounter(0);
+
+// Number of threads deleting the files of one trashed folder
+static unsigned workerCount() {
+    return std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+}
+
+// Deletes a trashed folder's files across several threads, then the folders left behind (only this entry of the trash)
+static void deleteTrashed(const std::filesystem::path &path) {
+    std::vector<std::filesystem::path> files;
+    std::error_code error;
+    for (const auto &item : std::filesystem::recursive_directory_iterator(path, error)) {
+        if (!item.is_directory(error)) {
+            files.push_back(item.path());
+        }
+    }
+
+    std::atomic<std::size_t> nextFile(0);
+    auto work = [&]() {
+        for (std::size_t i = nextFile++; i < files.size(); i = nextFile++) {
+            std::error_code removeError;
+            std::filesystem::remove(files[i], removeError);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < std::min<std::size_t>(workerCount(), files.size()); ++i) {
+        workers.emplace_back(work);
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    std::filesystem::remove_all(path, error);
+    if (error) {
+        std::cerr << "Error deleting " << path.string() << ": " << error.message() << "\n";
+    }
+    // The trash folder itself stays: another remove() may be renaming something into it meanwhile
+}
+
+Trash::Trash() {}
+
+//=== FUNCTIONALITIES
+/* Removes a file or folder. It is renamed into the given trash folder (which must be on the same volume)
+ * and deleted in the background; if it can't be renamed, it is deleted in place instead (which throws
+ * on failure, like remove_all).
+*/
+void Trash::remove(const std::string &path, const std::string &trashDirectory) {
+    std::filesystem::path target(path);
+    std::error_code error;
+    if (!std::filesystem::exists(target, error)) {
+        return;
+    }
+
+    std::filesystem::path trash(trashDirectory);
+    std::string name = target.filename().string() + "." + std::to_string(std::chrono::system_clock::now().time_since_epoch().count())
+                       + "." + std::to_string(trashCounter++);
+    std::filesystem::path trashed = trash / name;
+    std::filesystem::create_directories(trash, error);
+    std::filesystem::rename(target, trashed, error);
+    if (error) {
+        std::cerr << "Could not move " << path << " to the trash (" << error.message() << "); deleting it in place.\n";
+        std::filesystem::remove_all(target);
+        return;
+    }
+
+    std::thread(deleteTrashed, trashed).detach();
+}
+
+// Deletes everything left in a trash folder, in the background
+void Trash::emptyInBackground(const std::string &trashDirectory) {
+    std::error_code error;
+    if (!std::filesystem::is_directory(trashDirectory, error)) {
+        return;
+    }
+    for (const auto &item : std::filesystem::directory_iterator(trashDirectory, error)) {
+        std::thread(deleteTrashed, item.path()).detach();
+    }
+}
+
+// Returns the trash folder used for a path: one next to it, so renaming into it never crosses volumes
+std::string Trash::trashFor(const std::string &path) {
+    return (std::filesystem::path(path).parent_path() / TRASH_NAME).string();
+}
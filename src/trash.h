@@ -0,0 +1,22 @@
+#ifndef TRASH_H
+#define TRASH_H
+#include <string>
+
+/* Removes folders without making the caller wait for every file to be deleted. The folder is
+ * renamed into a trash folder on the same volume (making the rename instant), and its contents are
+ * then deleted by a background job spread over several threads. Anything still in a trash folder
+ * when the app exits is deleted the next time it starts, so callers only use the trash folders the
+ * app empties on startup: the ones trashFor() gives for the cache and BepInEx folders.
+*/
+class Trash
+{
+public:
+    Trash();
+
+    //=== FUNCTIONALITIES
+    static void remove(const std::string &path, const std::string &trashDirectory);
+    static void emptyInBackground(const std::string &trashDirectory);
+    static std::string trashFor(const std::string &path);
+};
+
+#endif // TRASH_H
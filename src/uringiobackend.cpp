@@ -0,0 +1,286 @@
+#include "uringiobackend.h"
+
+#ifdef MODPACK_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+#include <algorithm>
+
+// Files written per batch, each in its own registered file slot
+static const unsigned BATCH_FILES = 128;
+
+// Requests per file: open, write, close
+static const unsigned REQUESTS_PER_FILE = 3;
+
+// Files at least this big are written straight away (a single ring write is limited to 32 bits)
+static const std::size_t DIRECT_WRITE_LIMIT = 1u << 30;
+
+// Request kinds, kept in the low bits of each request's user data
+enum RequestKind : std::uint64_t { OPEN = 0, WRITE = 1, CLOSE = 2 };
+
+static int uringSetup(unsigned entries, io_uring_params * params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int uringEnter(int fd, unsigned submit, unsigned wait, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, submit, wait, flags, nullptr, 0));
+}
+
+static int uringRegister(int fd, unsigned opcode, const void * arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+UringIoBackend::UringIoBackend() {
+    open = setUp() && supportsDirectFiles();
+    pending.reserve(BATCH_FILES);
+}
+
+UringIoBackend::~UringIoBackend() {
+    if (open) {
+        finish();
+    }
+    if (sqes != nullptr) {
+        munmap(sqes, sqesSize);
+    }
+    if (cqRing != nullptr && cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+    }
+    if (sqRing != nullptr) {
+        munmap(sqRing, sqRingSize);
+    }
+    if (ringFd >= 0) {
+        close(ringFd);
+    }
+}
+
+//=== FUNCTIONALITIES
+// Queues a file, writing the batch once it is full
+void UringIoBackend::write(const std::string &path, const char * data, std::size_t size, Completion done) {
+    if (!open || size >= DIRECT_WRITE_LIMIT) {
+        SyncIoBackend().write(path, data, size, done);
+        return;
+    }
+    pending.push_back({ path, data, size, std::move(done) });
+    if (pending.size() == BATCH_FILES) {
+        submitBatch();
+    }
+}
+
+// Writes everything still queued and waits for it
+void UringIoBackend::finish() {
+    submitBatch();
+}
+
+//=== GETTERS
+bool UringIoBackend::isOpen() const { return open; }
+
+// Creates the ring, maps its queues into memory and registers the empty file slots
+bool UringIoBackend::setUp() {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ringFd = uringSetup(BATCH_FILES * REQUESTS_PER_FILE, &params);
+    if (ringFd < 0) {
+        ringFd = -1;
+        return false;
+    }
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMapping) {
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+    }
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        sqRing = nullptr;
+        return false;
+    }
+    cqRing = singleMapping ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    if (cqRing == MAP_FAILED) {
+        cqRing = nullptr;
+        return false;
+    }
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void * sqeMapping = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (sqeMapping == MAP_FAILED) {
+        return false;
+    }
+    sqes = static_cast<io_uring_sqe *>(sqeMapping);
+
+    char * sq = static_cast<char *>(sqRing);
+    char * cq = static_cast<char *>(cqRing);
+    sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    // One empty slot per file of a batch; opens fill them and closes empty them again
+    std::vector<int> slots(BATCH_FILES, -1);
+    return uringRegister(ringFd, IORING_REGISTER_FILES, slots.data(), BATCH_FILES) == 0;
+}
+
+/* Checks that the kernel has every request this backend uses, and that opens really go into a slot.
+ * Kernels before 5.15 ignore the slot and hand back a descriptor, which must not be mistaken for success.
+*/
+bool UringIoBackend::supportsDirectFiles() {
+    std::vector<char> buffer(sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op), 0);
+    io_uring_probe * probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+    if (uringRegister(ringFd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) != 0) {
+        return false;
+    }
+    for (int opcode : { IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE }) {
+        if (opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+
+    io_uring_sqe * sqe = nextSqe();
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = reinterpret_cast<std::uint64_t>("/dev/null");
+    sqe->open_flags = O_WRONLY;
+    sqe->file_index = 1;
+    std::vector<io_uring_cqe> completions;
+    if (!submitAndWait(1, completions)) {
+        return false;
+    }
+    if (completions[0].res > 0) {
+        close(completions[0].res);
+        return false;
+    }
+    if (completions[0].res < 0) {
+        return false;
+    }
+
+    sqe = nextSqe();
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->file_index = 1;
+    return submitAndWait(1, completions) && completions[0].res == 0;
+}
+
+// Returns a cleared submission entry at the tail of the queue (the queue always has room for a whole batch)
+io_uring_sqe * UringIoBackend::nextSqe() {
+    unsigned tail = *sqTail + queued;
+    unsigned index = tail & *sqMask;
+    io_uring_sqe * sqe = &sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    ++queued;
+    return sqe;
+}
+
+// Submits the queued requests and collects exactly as many completions. Returns false if the ring fails.
+bool UringIoBackend::submitAndWait(unsigned requests, std::vector<io_uring_cqe> &completions) {
+    __atomic_store_n(sqTail, *sqTail + queued, __ATOMIC_RELEASE);
+    unsigned toSubmit = queued;
+    queued = 0;
+
+    completions.clear();
+    while (completions.size() < requests) {
+        int entered = uringEnter(ringFd, toSubmit, 1, IORING_ENTER_GETEVENTS);
+        if (entered < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            std::cerr << "io_uring_enter failed: " << std::strerror(errno) << "\n";
+            return false;
+        }
+        if (entered > 0) {
+            toSubmit -= std::min<unsigned>(toSubmit, static_cast<unsigned>(entered));
+        }
+
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            completions.push_back(cqes[head & *cqMask]);
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+/* Writes every queued file as a linked open (into the file's slot), write and close. New files, the common
+ * case when installing into cleared folders, take no other system calls; files that already exist are
+ * unlinked and written again synchronously.
+*/
+void UringIoBackend::submitBatch() {
+    if (pending.empty()) {
+        return;
+    }
+
+    unsigned requests = 0;
+    for (std::size_t i = 0; i < pending.size(); ++i) {
+        const PendingWrite &file = pending[i];
+        std::uint32_t slot = static_cast<std::uint32_t>(i);
+
+        // Exclusive, so an existing file is never truncated in place (it is replaced synchronously below)
+        io_uring_sqe * sqe = nextSqe();
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<std::uint64_t>(file.path.c_str());
+        sqe->len = 0644;
+        sqe->open_flags = O_WRONLY | O_CREAT | O_EXCL;
+        sqe->file_index = slot + 1;
+        sqe->flags = IOSQE_IO_LINK;
+        sqe->user_data = i * REQUESTS_PER_FILE + OPEN;
+        ++requests;
+
+        if (file.size > 0) {
+            // Hard-linked to the close, so the slot is emptied even if the write fails
+            sqe = nextSqe();
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = static_cast<int>(slot);
+            sqe->addr = reinterpret_cast<std::uint64_t>(file.data);
+            sqe->len = static_cast<std::uint32_t>(file.size);
+            sqe->off = 0;
+            sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+            sqe->user_data = i * REQUESTS_PER_FILE + WRITE;
+            ++requests;
+        }
+
+        sqe = nextSqe();
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->file_index = slot + 1;
+        sqe->user_data = i * REQUESTS_PER_FILE + CLOSE;
+        ++requests;
+    }
+
+    std::vector<io_uring_cqe> completions;
+    bool submitted = submitAndWait(requests, completions);
+    if (!submitted) {
+        // Whatever went wrong with the ring, later files are written synchronously
+        open = false;
+    }
+    std::vector<bool> ok(pending.size(), submitted);
+    std::vector<bool> existed(pending.size(), false);
+    for (const io_uring_cqe &completion : completions) {
+        std::size_t file = static_cast<std::size_t>(completion.user_data / REQUESTS_PER_FILE);
+        std::uint64_t kind = completion.user_data % REQUESTS_PER_FILE;
+        bool failed = (kind == OPEN && completion.res < 0) || (kind == CLOSE && completion.res < 0)
+                      || (kind == WRITE && static_cast<std::size_t>(completion.res) != pending[file].size);
+        if (failed) {
+            ok[file] = false;
+        }
+        if (kind == OPEN && completion.res == -EEXIST) {
+            existed[file] = true;
+        }
+    }
+
+    std::vector<PendingWrite> batch;
+    batch.swap(pending);
+    pending.reserve(BATCH_FILES);
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        if (existed[i]) {
+            // Replacing a file means unlinking it first (it may be hardlinked), which the synchronous path does
+            SyncIoBackend().write(batch[i].path, batch[i].data, batch[i].size, batch[i].done);
+        } else if (batch[i].done) {
+            batch[i].done(ok[i]);
+        }
+    }
+}
+#endif
@@ -0,0 +1,74 @@
+#ifndef URINGIOBACKEND_H
+#define URINGIOBACKEND_H
+#include "iobackend.h"
+#include <vector>
+#include <cstdint>
+
+// The io_uring backend is built on Linux, against kernel headers new enough to open files straight into ring slots
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(IORING_SETUP_SUBMIT_ALL)
+#define MODPACK_IO_URING
+#endif
+#endif
+#endif
+
+#ifdef MODPACK_IO_URING
+/* Writes files in batches through io_uring, talking to the kernel directly (no liburing needed).
+ * Each file becomes a linked chain of open, write and close requests, with the open putting the
+ * file straight into a registered slot so no descriptor ever comes back to user space. A whole
+ * batch of files is then one system call instead of three or four per file. isOpen() is false if the
+ * kernel lacks anything this needs (Linux 5.15+), in which case IoBackend::create() uses SyncIoBackend.
+*/
+class UringIoBackend : public IoBackend
+{
+public:
+    UringIoBackend();
+    ~UringIoBackend() override;
+
+    //=== FUNCTIONALITIES
+    void write(const std::string &path, const char * data, std::size_t size, Completion done = nullptr) override;
+    void finish() override;
+
+    //=== GETTERS
+    bool isOpen() const;
+
+private:
+    // A file waiting for the next batch
+    struct PendingWrite
+    {
+        std::string path;
+        const char * data;
+        std::size_t size;
+        Completion done;
+    };
+
+    bool setUp();
+    bool supportsDirectFiles();
+    io_uring_sqe * nextSqe();
+    bool submitAndWait(unsigned requests, std::vector<io_uring_cqe> &completions);
+    void submitBatch();
+
+    int ringFd = -1;
+    void * sqRing = nullptr;
+    void * cqRing = nullptr;
+    std::size_t sqRingSize = 0;
+    std::size_t cqRingSize = 0;
+    io_uring_sqe * sqes = nullptr;
+    std::size_t sqesSize = 0;
+    unsigned * sqHead = nullptr;
+    unsigned * sqTail = nullptr;
+    unsigned * sqMask = nullptr;
+    unsigned * sqArray = nullptr;
+    unsigned * cqHead = nullptr;
+    unsigned * cqTail = nullptr;
+    unsigned * cqMask = nullptr;
+    io_uring_cqe * cqes = nullptr;
+    unsigned queued = 0;
+    bool open = false;
+    std::vector<PendingWrite> pending;
+};
+#endif
+
+#endif // URINGIOBACKEND_H
@@ -1,15 +1,577 @@
 #include "ziphandler.h"
+#include "mappedfile.h"
+#include "zipindex.h"
+#include "packarchive.h"
+#include "memorystage.h"
+#include "iobackend.h"
+#include "backgroundmode.h"
 #include <filesystem>
 #include <zip.h>
+#include <zlib.h>
 #include <iostream>
 #include <vector>
+#include <cstdio>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <unordered_set>
+#include <unordered_map>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+// Whole entries are inflated with libdeflate when it is available, and with zlib otherwise
+#if defined(__has_include)
+#if __has_include(<libdeflate.h>)
+#include <libdeflate.h>
+#define MODPACK_LIBDEFLATE
+#endif
+#endif
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Size of a single write issued to disk
+static const size_t WRITE_CHUNK_SIZE = 1 << 20;
+
+// Largest entry the mapped engine will inflate whole, in a single call; larger ones are streamed through zlib
+static const std::uint64_t WHOLE_BUFFER_LIMIT = 64ull << 20;
+
+// Entries up to this size are decoded into memory and handed to the I/O backend, which may batch them
+static const std::uint64_t BATCHED_FILE_LIMIT = 256 << 10;
+
+// Decoded bytes held for the I/O backend before it is made to write them out
+static const std::uint64_t BATCHED_BYTES_LIMIT = 32ull << 20;
+
+// Engine used by extractMapped()
+static std::atomic<ExtractEngine> currentEngine(ExtractEngine::Mapped);
+
+// Whether extract() skips files that are already on disk unchanged
+static std::atomic<bool> incrementalExtraction(true);
+
+// Name of the index kept in an extraction's target directory
+static const char * EXTRACT_INDEX_NAME = ".extract_index";
+
+// What was last written for an extracted file
+struct IndexRecord
+{
+    std::uint32_t crc = 0;
+    std::uint64_t size = 0;
+    std::int64_t mtime = 0;
+};
+
+// Extracted files (by full output path) mapped to what was written for them
+typedef std::unordered_map<std::string, IndexRecord> ExtractIndex;
+
+// Hands out large write buffers so they are not reallocated for every entry
+class BufferPool
+{
+public:
+    std::vector<char> acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (buffers.empty()) {
+            return std::vector<char>(WRITE_CHUNK_SIZE);
+        }
+        std::vector<char> buffer = std::move(buffers.back());
+        buffers.pop_back();
+        return buffer;
+    }
+
+    void release(std::vector<char> buffer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffers.push_back(std::move(buffer));
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<std::vector<char>> buffers;
+};
+
+static BufferPool bufferPool;
+
+// Reads little-endian integers out of archive bytes
+static std::uint16_t read16(const unsigned char * p) {
+    return static_cast<std::uint16_t>(p[0] | (p[1] << 8));
+}
+static std::uint32_t read32(const unsigned char * p) {
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8)
+           | (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+static std::uint64_t read64(const unsigned char * p) {
+    return static_cast<std::uint64_t>(read32(p)) | (static_cast<std::uint64_t>(read32(p + 4)) << 32);
+}
+
+// Whether [offset, offset + length) lies within size bytes. Offsets and lengths come straight from the
+// archive, so this never adds them: a crafted value could wrap around and pass the check.
+static bool within(std::uint64_t offset, std::uint64_t length, std::uint64_t size) {
+    return offset <= size && length <= size - offset;
+}
+
+// Creates a directory (and its parents) unless it has already been created during this extraction
+static void createDirectoryCached(const std::filesystem::path &directory, std::unordered_set<std::string> &createdDirectories) {
+    if (directory.empty() || createdDirectories.count(directory.string())) {
+        return;
+    }
+    std::filesystem::create_directories(directory);
+
+    // Remember the directory and every parent of it
+    for (std::filesystem::path path = directory; !path.empty() && path != path.root_path(); path = path.parent_path()) {
+        if (!createdDirectories.insert(path.string()).second) {
+            break;
+        }
+    }
+}
+
+/* Reserves the full size of a file on disk before it is written to, so it is laid out in one piece.
+ * Only the allocation is reserved: the file's length and contents are left alone, so nothing is
+ * written twice (setting the length instead would zero-fill the file first). Returns false if the
+ * filesystem refused; the file can still be written, just without the reservation.
+*/
+static bool preallocate(std::FILE * file, std::uint64_t size) {
+    if (size == 0) {
+        return true;
+    }
+#ifdef _WIN32
+    FILE_ALLOCATION_INFO allocation;
+    allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+    HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file)));
+    return handle != INVALID_HANDLE_VALUE && SetFileInformationByHandle(handle, FileAllocationInfo, &allocation, sizeof(allocation)) != 0;
+#elif defined(__linux__)
+    // Unlike posix_fallocate, this never falls back to writing zeros on filesystems without support
+    return fallocate(fileno(file), FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size)) == 0;
+#else
+    (void)file;
+    return true;
+#endif
+}
+
+// Cuts a file back down to the number of bytes that were actually written
+static void truncateTo(std::FILE * file, std::uint64_t size) {
+    std::fflush(file);
+#ifdef _WIN32
+    _chsize_s(_fileno(file), static_cast<__int64>(size));
+#else
+    if (ftruncate(fileno(file), static_cast<off_t>(size)) != 0) {
+        std::cerr << "Error truncating file to " << size << " bytes\n";
+    }
+#endif
+}
+
+// Returns the mapping with the longest prefix matching an entry name, or nullptr if none match
+static const PathMapping * findMapping(const std::string &name, const std::vector<PathMapping> &mappings) {
+    const PathMapping * best = nullptr;
+    for (const PathMapping &mapping : mappings) {
+        bool singleFile = !mapping.prefix.empty() && mapping.prefix.back() != '/';
+        if (singleFile ? name != mapping.prefix : name.compare(0, mapping.prefix.size(), mapping.prefix) != 0) {
+            continue;
+        }
+        if (best == nullptr || mapping.prefix.size() > best->prefix.size()) {
+            best = &mapping;
+        }
+    }
+    return best;
+}
+
+/* Whether an entry name, relative to its mapping, stays inside the mapping's destination: no root
+ * or drive (a leading slash or backslash, or any colon), and no ".." segment. Archives may use
+ * either slash, so both count as separators whatever the platform.
+*/
+static bool isContainedName(const std::string &relativeName) {
+    if (relativeName.front() == '/' || relativeName.front() == '\\' || relativeName.find(':') != std::string::npos) {
+        return false;
+    }
+    std::size_t start = 0;
+    while (start <= relativeName.size()) {
+        std::size_t end = relativeName.find_first_of("/\\", start);
+        if (end == std::string::npos) {
+            end = relativeName.size();
+        }
+        if (relativeName.compare(start, end - start, "..") == 0) {
+            return false;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+/* Works out where an archive entry should be written. Creates the folder for directory
+ * entries and the parent folder for file entries. Returns false if the entry should be skipped.
+*/
+static bool prepareOutputPath(const std::string &filename, const std::vector<PathMapping> &mappings,
+                              std::unordered_set<std::string> &createdDirectories, std::string &fullPath) {
+    if (!ZipHandler::mapEntryPath(filename, mappings, fullPath)) {
+        return false;
+    }
+    std::filesystem::path path(fullPath);
+
+    // Directory entries only need their folder created
+    if (fullPath.back() == '/') {
+        createDirectoryCached(path, createdDirectories);
+        return false;
+    }
+
+    // Create directories if they don't exist
+    if (path.has_parent_path()) {
+        createDirectoryCached(path.parent_path(), createdDirectories);
+    }
+    return true;
+}
+
+// Opens an output file unbuffered (every write is already a large chunk) with its full size reserved
+static std::FILE * openOutputFile(const std::string &fullPath, std::uint64_t expectedSize) {
+    std::FILE * file = ZipHandler::createFile(fullPath);
+    if (file == nullptr) {
+        std::cerr << "Error opening " << fullPath << "\n";
+        return nullptr;
+    }
+    std::setvbuf(file, nullptr, _IONBF, 0);
+    if (!preallocate(file, expectedSize)) {
+        static std::atomic<bool> reported(false);
+        if (!reported.exchange(true)) {
+            std::cerr << "Could not preallocate " << fullPath << "; writing without reserving space\n";
+        }
+    }
+    return file;
+}
+
+// Closes an output file, without leaving preallocated space behind if the entry came up short
+static void closeOutputFile(std::FILE * file, std::uint64_t written, std::uint64_t expectedSize) {
+    if (written != expectedSize) {
+        truncateTo(file, written);
+    }
+    std::fclose(file);
+}
+
+// Writes a block of bytes in large chunks. Returns false if the disk write fails.
+static bool writeAll(std::FILE * file, const char * data, std::uint64_t size) {
+    while (size > 0) {
+        size_t chunk = static_cast<size_t>(std::min<std::uint64_t>(size, WRITE_CHUNK_SIZE * 16));
+        BackgroundMode::pace(chunk);
+        if (std::fwrite(data, 1, chunk, file) != chunk) {
+            return false;
+        }
+        data += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+#ifdef MODPACK_LIBDEFLATE
+// Owns the calling thread's libdeflate decompressor, which is reused for every entry the thread inflates
+struct DeflateDecompressor
+{
+    libdeflate_decompressor * handle = libdeflate_alloc_decompressor();
+    ~DeflateDecompressor() { libdeflate_free_decompressor(handle); }
+};
+#endif
+
+/* Inflates a whole raw DEFLATE stream into a buffer of its uncompressed size, in one call. libdeflate
+ * decodes whole buffers several times faster than zlib, which is only used when libdeflate is missing
+ * or can't allocate a decompressor. Returns false unless the stream decodes to exactly outputSize bytes.
+*/
+static bool inflateWhole(const unsigned char * input, std::uint64_t inputSize, char * output, std::uint64_t outputSize) {
+#ifdef MODPACK_LIBDEFLATE
+    thread_local DeflateDecompressor decompressor;
+    if (decompressor.handle != nullptr) {
+        std::size_t produced = 0;
+        return libdeflate_deflate_decompress(decompressor.handle, input, static_cast<std::size_t>(inputSize), output,
+                                             static_cast<std::size_t>(outputSize), &produced) == LIBDEFLATE_SUCCESS
+               && produced == outputSize;
+    }
+#endif
+    z_stream stream = {};
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        return false;
+    }
+    stream.next_in = const_cast<Bytef *>(input);
+    stream.avail_in = static_cast<uInt>(inputSize);
+    stream.next_out = reinterpret_cast<Bytef *>(output);
+    stream.avail_out = static_cast<uInt>(outputSize);
+    int status = inflate(&stream, Z_FINISH);
+    bool complete = status == Z_STREAM_END && stream.total_out == outputSize;
+    inflateEnd(&stream);
+    return complete;
+}
+
+/* Inflates a raw DEFLATE stream into a file through the buffer, a buffer's worth at a time. Used for
+ * entries too large to decode whole. Returns the number of bytes written, or -1 on error.
+*/
+static std::int64_t inflateToFile(const unsigned char * input, std::uint64_t inputSize, std::vector<char> &buffer,
+                                  std::FILE * file, std::uint32_t &crc) {
+    z_stream stream = {};
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        return -1;
+    }
+
+    std::int64_t written = 0;
+    int status = Z_OK;
+    while (status != Z_STREAM_END) {
+        // Top up the input (zlib counts input in 32-bit lengths)
+        if (stream.avail_in == 0 && inputSize > 0) {
+            uInt feed = static_cast<uInt>(std::min<std::uint64_t>(inputSize, 1u << 30));
+            stream.next_in = const_cast<Bytef *>(input);
+            stream.avail_in = feed;
+            input += feed;
+            inputSize -= feed;
+        }
+
+        stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+        stream.avail_out = static_cast<uInt>(buffer.size());
+        status = inflate(&stream, inputSize == 0 ? Z_FINISH : Z_NO_FLUSH);
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+            written = -1;
+            break;
+        }
+
+        uInt produced = static_cast<uInt>(buffer.size()) - stream.avail_out;
+        if (produced == 0 && stream.avail_in == 0 && inputSize == 0 && status != Z_STREAM_END) {
+            // Ran out of input before the end of the stream
+            written = -1;
+            break;
+        }
+        crc = static_cast<std::uint32_t>(crc32(crc, reinterpret_cast<const Bytef *>(buffer.data()), produced));
+        if (!writeAll(file, buffer.data(), produced)) {
+            written = -1;
+            break;
+        }
+        written += produced;
+    }
+
+    inflateEnd(&stream);
+    return written;
+}
+
+// Returns a file's modification time as a plain number, or 0 if it can't be read
+static std::int64_t modificationTime(const std::string &path) {
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(path, error);
+    return error ? 0 : static_cast<std::int64_t>(time.time_since_epoch().count());
+}
+
+// Reads an extraction index from disk. A missing or unreadable index is simply empty.
+static ExtractIndex loadExtractIndex(const std::string &path) {
+    ExtractIndex index;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        IndexRecord record;
+        std::string name;
+        if (fields >> record.crc >> record.size >> record.mtime && std::getline(fields >> std::ws, name)) {
+            index[name] = record;
+        }
+    }
+    return index;
+}
+
+// Writes an extraction index to disk, replacing the previous one in a single rename
+static void saveExtractIndex(const std::string &path, const ExtractIndex &index) {
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::trunc);
+        for (const auto &item : index) {
+            file << item.second.crc << ' ' << item.second.size << ' ' << item.second.mtime << ' ' << item.first << '\n';
+        }
+        if (!file) {
+            std::cerr << "Error writing extraction index " << path << "\n";
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+}
+
+/* Returns true if the file at fullPath already holds an entry with the given CRC and size.
+ * Files whose size and modification time match the index are trusted without being read;
+ * anything else with the right size has its CRC computed and compared.
+*/
+static bool isUnchanged(const std::string &fullPath, std::uint32_t crc, std::uint64_t size, ExtractIndex &index) {
+    std::error_code error;
+    std::uint64_t currentSize = std::filesystem::file_size(fullPath, error);
+    if (error || currentSize != size) {
+        return false;
+    }
+
+    std::int64_t mtime = modificationTime(fullPath);
+    auto record = index.find(fullPath);
+    if (record != index.end() && record->second.crc == crc && record->second.size == size && record->second.mtime == mtime) {
+        return true;
+    }
+
+    bool ok = false;
+    if (ZipHandler::fileCrc(fullPath, ok) != crc || !ok) {
+        return false;
+    }
+    index[fullPath] = IndexRecord{ crc, size, mtime };
+    return true;
+}
+
+// Records a freshly written file in the index
+static void recordExtracted(const std::string &fullPath, std::uint32_t crc, std::uint64_t size, ExtractIndex * index) {
+    if (index != nullptr) {
+        (*index)[fullPath] = IndexRecord{ crc, size, modificationTime(fullPath) };
+    }
+}
+
+static int extractArchive(std::string &filePath, const std::vector<PathMapping> &mappings, ExtractStats * stats, ExtractIndex * index);
+static int decodeIntoStage(std::string &filePath, MemoryStage &stage, ExtractStats * stats);
+static int extractWithLibzip(std::string &filePath, const std::vector<PathMapping> &mappings, ExtractStats * stats, ExtractIndex * index);
+static int extractWithMapping(const unsigned char * data, std::size_t size, const std::vector<ZipEntry> &entries,
+                              const std::vector<PathMapping> &mappings, ExtractStats * stats, ExtractIndex * index);
 
 ZipHandler::ZipHandler() {}
 
-int ZipHandler::extract(std::string filePath, std::string targetPath) {
+/* Extracts a whole archive into a target directory. When incremental extraction is on,
+ * files already there with a matching CRC and size are left alone. Returns 0, or -1 if the
+ * archive can't be read or any file couldn't be extracted.
+*/
+int ZipHandler::extract(std::string filePath, std::string targetPath, ExtractStats * stats) {
+    std::vector<PathMapping> mappings = { PathMapping{ "", targetPath } };
+    if (!isIncremental() || PackArchive::isPack(filePath)) {
+        return extractMapped(filePath, mappings, stats);
+    }
+
+    int result = -1;
+    BackgroundMode::run([&]() {
+        std::string indexPath = targetPath + "/" + EXTRACT_INDEX_NAME;
+        ExtractIndex index = loadExtractIndex(indexPath);
+        result = extractArchive(filePath, mappings, stats, &index);
+
+        // The index only records files that were written whole, so it is kept even when some failed
+        saveExtractIndex(indexPath, index);
+    });
+    return result;
+}
+
+/* Extracts only the entries that fall under one of the given prefixes, writing each
+ * straight into its mapping's destination with the prefix stripped off. Returns 0, or -1 if
+ * the archive can't be read or any file couldn't be extracted.
+*/
+int ZipHandler::extractMapped(std::string filePath, const std::vector<PathMapping> &mappings, ExtractStats * stats) {
+    int result = -1;
+    BackgroundMode::run([&]() {
+        if (PackArchive::isPack(filePath)) {
+            result = PackArchive::extract(filePath, mappings, stats);
+        } else {
+            result = extractArchive(filePath, mappings, stats, nullptr);
+        }
+    });
+    return result;
+}
+
+/* Decodes a whole archive into a memory stage instead of onto disk. Returns 1 without decoding
+ * anything if the archive won't fit in the stage's budget or has entries only libzip can read
+ * (the caller should stage on disk instead), 0 on success and -1 on error.
+*/
+int ZipHandler::extractToMemory(std::string filePath, MemoryStage &stage, ExtractStats * stats) {
+    int result = -1;
+    BackgroundMode::run([&]() { result = decodeIntoStage(filePath, stage, stats); });
+    return result;
+}
+
+// Decodes every entry of a zip archive into a memory stage (see extractToMemory())
+static int decodeIntoStage(std::string &filePath, MemoryStage &stage, ExtractStats * stats) {
+    const auto startTime = std::chrono::steady_clock::now();
+    if (PackArchive::isPack(filePath)) {
+        return 1;
+    }
+
+    MappedFile archive(filePath);
+    if (!archive.isOpen()) {
+        std::cerr << "Error opening archive: " << filePath << "\n";
+        return -1;
+    }
+
+    // List the entries, preferring the stored index
+    std::vector<ZipEntry> entries;
+    ZipIndex zipIndex;
+    if (zipIndex.open(filePath)) {
+        entries = zipIndex.entries();
+    } else if (!ZipHandler::readCentralDirectory(archive.data(), archive.size(), entries)) {
+        std::cerr << "Error reading central directory of " << filePath << "\n";
+        return -1;
+    }
+
+    // Check the budget before decoding anything
+    std::uint64_t totalSize = 0;
+    for (const ZipEntry &entry : entries) {
+        if ((entry.flags & 1) || (entry.method != 0 && entry.method != 8) || entry.uncompressedSize > 0xFFFFFFFFull) {
+            return 1;
+        }
+        totalSize += entry.uncompressedSize;
+    }
+    if (totalSize > stage.getBudget() - stage.getUsed()) {
+        return 1;
+    }
+
+    std::uint64_t filesStaged = 0;
+    std::uint64_t bytesStaged = 0;
+    for (const ZipEntry &entry : entries) {
+        if (!entry.name.empty() && entry.name.back() == '/') {
+            stage.addDirectory(entry.name);
+            continue;
+        }
+
+        char * output = stage.allocate(entry.uncompressedSize);
+        if (output == nullptr || !ZipHandler::decodeEntry(archive.data(), archive.size(), entry, output)) {
+            std::cerr << "Error extracting " << entry.name << " into memory\n";
+            stage.clear();
+            return -1;
+        }
+        stage.addFile(entry.name, output, entry.uncompressedSize);
+        ++filesStaged;
+        bytesStaged += entry.uncompressedSize;
+    }
+
+    if (stats != nullptr) {
+        stats->files = filesStaged;
+        stats->bytes = bytesStaged;
+        stats->skipped = 0;
+        stats->failed = 0;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+    return 0;
+}
+
+// Extracts with the current engine, skipping unchanged files if given an index
+static int extractArchive(std::string &filePath, const std::vector<PathMapping> &mappings, ExtractStats * stats, ExtractIndex * index) {
+    if (ZipHandler::getEngine() == ExtractEngine::Mapped) {
+        MappedFile archive(filePath);
+        std::vector<ZipEntry> entries;
+
+        // Use the stored index when there is one, otherwise read the central directory
+        ZipIndex zipIndex;
+        bool listed = archive.isOpen() && zipIndex.open(filePath);
+        if (listed) {
+            entries = zipIndex.entries();
+        } else if (archive.isOpen()) {
+            listed = ZipHandler::readCentralDirectory(archive.data(), archive.size(), entries);
+        }
+        if (listed) {
+            // Encrypted entries and methods other than store/deflate are left to libzip
+            bool supported = std::all_of(entries.begin(), entries.end(), [](const ZipEntry &entry) {
+                return !(entry.flags & 1) && (entry.method == 0 || entry.method == 8);
+            });
+            if (supported) {
+                return extractWithMapping(archive.data(), archive.size(), entries, mappings, stats, index);
+            }
+        }
+        std::cerr << "Falling back to libzip for " << filePath << "\n";
+    }
+    return extractWithLibzip(filePath, mappings, stats, index);
+}
+
+// Extracts by streaming every entry through libzip
+static int extractWithLibzip(std::string &filePath, const std::vector<PathMapping> &mappings, ExtractStats * stats, ExtractIndex * index) {
+    const auto startTime = std::chrono::steady_clock::now();
+
     int err = 0;
-    zip* za = zip_open(filePath.c_str(), ZIP_CREATE, &err);
+    zip* za = zip_open(filePath.c_str(), ZIP_RDONLY, &err);
     if (za == nullptr) {
         std::cerr << "Error opening archive: " << err << "\n";
         return -1;
@@ -18,57 +580,343 @@ int ZipHandler::extract(std::string filePath, std::string targetPath) {
     // Get the number of entries in the archive
     zip_int64_t numEntries = zip_get_num_entries(za, 0);
 
+    std::unordered_set<std::string> createdDirectories;
+    std::vector<char> buffer = bufferPool.acquire();
+    std::uint64_t filesWritten = 0;
+    std::uint64_t filesSkipped = 0;
+    std::uint64_t filesFailed = 0;
+    std::uint64_t bytesWritten = 0;
+
     for (zip_int64_t i = 0; i < numEntries; ++i) {
+        // Get the name and size of the file
+        zip_stat_t st;
+        zip_stat_init(&st);
+        if (zip_stat_index(za, i, 0, &st) != 0 || !(st.valid & ZIP_STAT_NAME) || st.name == nullptr) {
+            std::cerr << "Error reading file info at index " << i << "\n";
+            ++filesFailed;
+            continue;
+        }
+
+        std::string fullPath;
+        if (!prepareOutputPath(st.name, mappings, createdDirectories, fullPath)) {
+            continue;
+        }
+
+        // Skip files that are already extracted
+        const std::uint64_t expectedSize = (st.valid & ZIP_STAT_SIZE) ? st.size : 0;
+        const bool hasCrc = (st.valid & ZIP_STAT_CRC) && (st.valid & ZIP_STAT_SIZE);
+        if (index != nullptr && hasCrc && isUnchanged(fullPath, st.crc, expectedSize, *index)) {
+            ++filesSkipped;
+            continue;
+        }
+
         // Open zip file index
         zip_file* zf = zip_fopen_index(za, i, 0);
         if (!zf) {
             std::cerr << "Error opening file at index " << i << "\n";
+            ++filesFailed;
             continue;
         }
 
-        // Get the name of the file
-        const char* filename = zip_get_name(za, i, 0);
-        if (!filename) {
+        std::FILE * file = openOutputFile(fullPath, expectedSize);
+        if (file == nullptr) {
             zip_fclose(zf);
+            ++filesFailed;
             continue;
         }
 
-        std::string fullPath = targetPath + "/" + std::string(filename);
-        std::filesystem::path path(fullPath);
+        // Read contents of zip file and write to disk
+        std::uint64_t fileBytes = 0;
+        zip_int64_t bytesRead;
+        bool writeFailed = false;
+        while ((bytesRead = zip_fread(zf, buffer.data(), WRITE_CHUNK_SIZE)) > 0) {
+            BackgroundMode::pace(static_cast<std::uint64_t>(bytesRead));
+            if (std::fwrite(buffer.data(), 1, static_cast<size_t>(bytesRead), file) != static_cast<size_t>(bytesRead)) {
+                std::cerr << "Error writing " << fullPath << "\n";
+                writeFailed = true;
+                break;
+            }
+            fileBytes += static_cast<std::uint64_t>(bytesRead);
+        }
 
-        // Create directories if they don't exist
-        if (path.has_parent_path()) {
-            std::filesystem::create_directories(path.parent_path());
+        closeOutputFile(file, fileBytes, expectedSize);
+        zip_fclose(zf);
+        if (writeFailed || bytesRead < 0 || ((st.valid & ZIP_STAT_SIZE) && fileBytes != expectedSize)) {
+            ++filesFailed;
+            continue;
+        }
+        if (hasCrc) {
+            recordExtracted(fullPath, st.crc, fileBytes, index);
         }
 
-        // Check if the path is too long
-        if (isPathTooLong(fullPath)) {
-            std::cerr << "Error: Path too long for " << fullPath << "\n";
-            zip_fclose(zf);
+        ++filesWritten;
+        bytesWritten += fileBytes;
+    }
+
+    bufferPool.release(std::move(buffer));
+    zip_close(za);
+
+    if (stats != nullptr) {
+        stats->files = filesWritten;
+        stats->bytes = bytesWritten;
+        stats->skipped = filesSkipped;
+        stats->failed = filesFailed;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+    return filesFailed > 0 ? -1 : 0;
+}
+
+// Extracts from a memory-mapped archive: stored entries are copied straight out of the mapping, deflated ones inflated whole
+static int extractWithMapping(const unsigned char * data, std::size_t size, const std::vector<ZipEntry> &entries,
+                              const std::vector<PathMapping> &mappings, ExtractStats * stats, ExtractIndex * index) {
+    const auto startTime = std::chrono::steady_clock::now();
+
+    std::unordered_set<std::string> createdDirectories;
+    std::vector<char> buffer = bufferPool.acquire();
+    std::uint64_t filesWritten = 0;
+    std::uint64_t filesSkipped = 0;
+    std::uint64_t filesFailed = 0;
+    std::uint64_t bytesWritten = 0;
+
+    // Small files are decoded whole and written through the I/O backend; their buffers live until it has written them
+    std::unique_ptr<IoBackend> backend = IoBackend::create();
+    std::vector<std::unique_ptr<char[]>> decoded;
+    std::uint64_t decodedBytes = 0;
+    auto writeSmallFile = [&](const std::string &fullPath, const ZipEntry &entry, const char * contents) {
+        BackgroundMode::pace(entry.uncompressedSize);
+        backend->write(fullPath, contents, static_cast<std::size_t>(entry.uncompressedSize), [&, fullPath, crc = entry.crc, fileSize = entry.uncompressedSize](bool ok) {
+            if (!ok) {
+                std::cerr << "Error extracting " << fullPath << "\n";
+                ++filesFailed;
+                return;
+            }
+            ++filesWritten;
+            bytesWritten += fileSize;
+            recordExtracted(fullPath, crc, fileSize, index);
+        });
+    };
+
+    for (const ZipEntry &entry : entries) {
+        std::string fullPath;
+        if (!prepareOutputPath(entry.name, mappings, createdDirectories, fullPath)) {
             continue;
         }
 
-        // Open the file
-        std::ofstream file(fullPath, std::ios::binary);
-        if (!file.is_open() && !std::filesystem::is_directory(path)) {
-            std::cerr << "Error opening " << fullPath << "\n";
-            zip_fclose(zf);
+        // Skip files that are already extracted
+        if (index != nullptr && isUnchanged(fullPath, entry.crc, entry.uncompressedSize, *index)) {
+            ++filesSkipped;
             continue;
         }
 
-        // Read contents of zip file and write to disk
-        std::vector<char> buffer(4096);
-        zip_int64_t bytesRead;
-        while ((bytesRead = zip_fread(zf, buffer.data(), buffer.size())) > 0) {
-            file.write(buffer.data(), bytesRead);
+        // Find the entry's bytes within the archive
+        const unsigned char * entryData = ZipHandler::findEntryData(data, size, entry);
+        if (entryData == nullptr) {
+            std::cerr << "Error locating data for " << entry.name << "\n";
+            ++filesFailed;
+            continue;
         }
 
-        file.close();
-        zip_fclose(zf);
+        if (entry.uncompressedSize <= BATCHED_FILE_LIMIT) {
+            // Stored entries are written straight out of the mapping; deflated ones are decoded first. Both are CRC-checked up front.
+            const char * contents = reinterpret_cast<const char *>(entryData);
+            bool valid;
+            if (entry.method == 0) {
+                valid = entry.compressedSize == entry.uncompressedSize
+                        && static_cast<std::uint32_t>(crc32_z(crc32(0L, Z_NULL, 0), entryData, static_cast<z_size_t>(entry.compressedSize))) == entry.crc;
+            } else {
+                decoded.emplace_back(new char[static_cast<std::size_t>(std::max<std::uint64_t>(entry.uncompressedSize, 1))]);
+                decodedBytes += entry.uncompressedSize;
+                contents = decoded.back().get();
+                valid = ZipHandler::decodeEntry(data, size, entry, decoded.back().get());
+            }
+            if (!valid) {
+                std::cerr << "Error extracting " << fullPath << "\n";
+                ++filesFailed;
+                continue;
+            }
+            writeSmallFile(fullPath, entry, contents);
+            if (decodedBytes >= BATCHED_BYTES_LIMIT) {
+                backend->finish();
+                decoded.clear();
+                decodedBytes = 0;
+            }
+            continue;
+        }
+
+        std::FILE * file = openOutputFile(fullPath, entry.uncompressedSize);
+        if (file == nullptr) {
+            ++filesFailed;
+            continue;
+        }
+
+        // Read contents of the entry and write to disk
+        std::int64_t fileBytes = 0;
+        std::uint32_t crc = static_cast<std::uint32_t>(crc32(0L, Z_NULL, 0));
+        if (entry.method == 0) {
+            crc = static_cast<std::uint32_t>(crc32_z(crc, entryData, static_cast<z_size_t>(entry.compressedSize)));
+            fileBytes = writeAll(file, reinterpret_cast<const char *>(entryData), entry.compressedSize)
+                            ? static_cast<std::int64_t>(entry.compressedSize) : -1;
+        } else if (entry.uncompressedSize <= WHOLE_BUFFER_LIMIT) {
+            // Entries of a known, reasonable size are inflated whole into the (grown) buffer, then written
+            if (buffer.size() < entry.uncompressedSize) {
+                buffer.resize(static_cast<size_t>(entry.uncompressedSize));
+            }
+            if (inflateWhole(entryData, entry.compressedSize, buffer.data(), entry.uncompressedSize)) {
+                crc = static_cast<std::uint32_t>(crc32_z(crc, reinterpret_cast<const Bytef *>(buffer.data()),
+                                                         static_cast<z_size_t>(entry.uncompressedSize)));
+                fileBytes = writeAll(file, buffer.data(), entry.uncompressedSize) ? static_cast<std::int64_t>(entry.uncompressedSize) : -1;
+            } else {
+                fileBytes = -1;
+            }
+        } else {
+            fileBytes = inflateToFile(entryData, entry.compressedSize, buffer, file, crc);
+        }
+
+        bool extracted = false;
+        if (fileBytes < 0) {
+            std::cerr << "Error extracting " << fullPath << "\n";
+            fileBytes = 0;
+        } else if (crc != entry.crc) {
+            std::cerr << "Error: CRC mismatch for " << fullPath << "\n";
+        } else if (static_cast<std::uint64_t>(fileBytes) != entry.uncompressedSize) {
+            std::cerr << "Error: size mismatch for " << fullPath << "\n";
+        } else {
+            extracted = true;
+        }
+
+        closeOutputFile(file, static_cast<std::uint64_t>(fileBytes), entry.uncompressedSize);
+        if (!extracted) {
+            ++filesFailed;
+            continue;
+        }
+        recordExtracted(fullPath, crc, entry.uncompressedSize, index);
+
+        ++filesWritten;
+        bytesWritten += static_cast<std::uint64_t>(fileBytes);
+    }
+    backend->finish();
+
+    bufferPool.release(std::move(buffer));
+
+    if (stats != nullptr) {
+        stats->files = filesWritten;
+        stats->bytes = bytesWritten;
+        stats->skipped = filesSkipped;
+        stats->failed = filesFailed;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+    return filesFailed > 0 ? -1 : 0;
+}
+
+/* Works out the output path of an archive entry from the mappings. Returns false if the entry
+ * falls outside of every mapping, would be written outside of its mapping's destination, or its
+ * path is too long. Directory paths keep their trailing slash.
+*/
+bool ZipHandler::mapEntryPath(const std::string &name, const std::vector<PathMapping> &mappings, std::string &fullPath) {
+    // Skip entries outside of the requested subtrees
+    const PathMapping * mapping = findMapping(name, mappings);
+    if (mapping == nullptr) {
+        return false;
+    }
+    std::string relativeName = name.substr(mapping->prefix.size());
+    if (!relativeName.empty()) {
+        // Refuse entries that would land outside of the destination ("zip slip"), and check the joined path as well
+        std::filesystem::path destination = std::filesystem::path(mapping->destination).lexically_normal();
+        std::filesystem::path joined = (destination / relativeName).lexically_normal();
+        std::filesystem::path inside = joined.lexically_relative(destination);
+        if (!isContainedName(relativeName) || inside.empty() || *inside.begin() == "..") {
+            std::cerr << "Error: Skipping " << name << ", which points outside of " << mapping->destination << "\n";
+            return false;
+        }
+        fullPath = mapping->destination + "/" + relativeName;
+    } else if (!mapping->prefix.empty() && mapping->prefix.back() != '/') {
+        fullPath = mapping->destination;
+    } else {
+        return false;
+    }
+
+    // Check if the path is too long
+    if (isPathTooLong(fullPath)) {
+        std::cerr << "Error: Path too long for " << fullPath << "\n";
+        return false;
+    }
+    return true;
+}
+
+/* Returns the entries of an archive, or of a pack made from one, preferring the stored index.
+ * Entries listed from a pack only carry their name, size and CRC.
+*/
+std::vector<ZipEntry> ZipHandler::listEntries(std::string filePath) {
+    if (PackArchive::isPack(filePath)) {
+        return PackArchive::listEntries(filePath);
+    }
+
+    std::vector<ZipEntry> entries;
+    ZipIndex zipIndex;
+    if (zipIndex.open(filePath)) {
+        return zipIndex.entries();
+    }
+    MappedFile archive(filePath);
+    if (!archive.isOpen() || !readCentralDirectory(archive.data(), archive.size(), entries)) {
+        std::cerr << "Error reading central directory of " << filePath << "\n";
+    }
+    return entries;
+}
+
+// Returns the names of the files (not directories) in an archive, or a pack made from one
+std::vector<std::string> ZipHandler::listFiles(std::string filePath) {
+    std::vector<std::string> names;
+    for (const ZipEntry &entry : listEntries(filePath)) {
+        if (!entry.name.empty() && entry.name.back() != '/') {
+            names.push_back(entry.name);
+        }
+    }
+    return names;
+}
+
+// Returns the name of the archive's top-level folder (with a trailing slash), or an empty string if it has none
+std::string ZipHandler::findRootFolder(std::string filePath) {
+    if (PackArchive::isPack(filePath)) {
+        return PackArchive::findRootFolder(filePath);
+    }
+
+    // The stored index lists entries sorted by name, so its first entry sits under the root folder too
+    ZipIndex zipIndex;
+    if (zipIndex.open(filePath) && zipIndex.size() > 0) {
+        std::string name = zipIndex.entry(0).name;
+        size_t separator = name.find('/');
+        return separator != std::string::npos ? name.substr(0, separator + 1) : "";
+    }
+
+    int err = 0;
+    zip* za = zip_open(filePath.c_str(), ZIP_RDONLY, &err);
+    if (za == nullptr) {
+        std::cerr << "Error opening archive: " << err << "\n";
+        return "";
+    }
+
+    std::string root;
+    if (zip_get_num_entries(za, 0) > 0) {
+        const char* filename = zip_get_name(za, 0, 0);
+        if (filename) {
+            std::string name(filename);
+            size_t separator = name.find('/');
+            if (separator != std::string::npos) {
+                root = name.substr(0, separator + 1);
+            }
+        }
     }
 
     zip_close(za);
-    return 0;
+    return root;
+}
+
+/* Creates a file for writing, unlinking whatever was there first. Installed plugins may be hardlinked
+ * to the cache, and truncating the old file in place would rewrite the installed copy too.
+*/
+std::FILE * ZipHandler::createFile(const std::string &path) {
+    std::remove(path.c_str());
+    return std::fopen(path.c_str(), "wb");
 }
 
 bool ZipHandler::isPathTooLong(const std::string& path) {
@@ -83,3 +931,186 @@ std::string ZipHandler::sanitizeFilename(std::string& filename) {
         '_');
     return result;
 }
+
+//=== ARCHIVE LAYOUT
+/* Parses the central directory of an archive held in memory (including Zip64 archives).
+ * Returns false if the end of central directory record is missing or the directory runs past the data.
+*/
+bool ZipHandler::readCentralDirectory(const unsigned char * data, std::size_t size, std::vector<ZipEntry> &entries) {
+    entries.clear();
+    const std::size_t EOCD_SIZE = 22;
+    if (data == nullptr || size < EOCD_SIZE) {
+        return false;
+    }
+
+    // Search backwards for the end of central directory record (it may be followed by a comment)
+    const std::size_t searchLimit = std::min<std::size_t>(size, EOCD_SIZE + 0xFFFF);
+    const unsigned char * eocd = nullptr;
+    for (std::size_t back = EOCD_SIZE; back <= searchLimit; ++back) {
+        const unsigned char * candidate = data + size - back;
+        if (read32(candidate) == 0x06054b50) {
+            eocd = candidate;
+            break;
+        }
+    }
+    if (eocd == nullptr) {
+        return false;
+    }
+
+    std::uint64_t entryCount = read16(eocd + 10);
+    std::uint64_t directorySize = read32(eocd + 12);
+    std::uint64_t directoryOffset = read32(eocd + 16);
+
+    // Zip64 archives keep the real values in a separate record
+    if (entryCount == 0xFFFF || directorySize == 0xFFFFFFFF || directoryOffset == 0xFFFFFFFF) {
+        const std::size_t eocdPosition = static_cast<std::size_t>(eocd - data);
+        if (eocdPosition < 20 || read32(eocd - 20) != 0x07064b50) {
+            return false;
+        }
+        std::uint64_t zip64Offset = read64(eocd - 20 + 8);
+        if (!within(zip64Offset, 56, size) || read32(data + zip64Offset) != 0x06064b50) {
+            return false;
+        }
+        entryCount = read64(data + zip64Offset + 32);
+        directorySize = read64(data + zip64Offset + 40);
+        directoryOffset = read64(data + zip64Offset + 48);
+    }
+
+    if (!within(directoryOffset, directorySize, size)) {
+        return false;
+    }
+
+    // Walk each central directory header
+    const unsigned char * cursor = data + directoryOffset;
+    const unsigned char * end = cursor + directorySize;
+    entries.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(entryCount, directorySize / 46)));
+    for (std::uint64_t i = 0; i < entryCount; ++i) {
+        if (end - cursor < 46 || read32(cursor) != 0x02014b50) {
+            return false;
+        }
+        std::uint16_t nameLength = read16(cursor + 28);
+        std::uint16_t extraLength = read16(cursor + 30);
+        std::uint16_t commentLength = read16(cursor + 32);
+        if (static_cast<std::size_t>(end - cursor) - 46 < static_cast<std::size_t>(nameLength) + extraLength + commentLength) {
+            return false;
+        }
+
+        ZipEntry entry;
+        entry.flags = read16(cursor + 8);
+        entry.method = read16(cursor + 10);
+        entry.crc = read32(cursor + 16);
+        entry.compressedSize = read32(cursor + 20);
+        entry.uncompressedSize = read32(cursor + 24);
+        entry.localHeaderOffset = read32(cursor + 42);
+        entry.name.assign(reinterpret_cast<const char *>(cursor + 46), nameLength);
+
+        // Fill in any 64-bit sizes from the Zip64 extra field
+        const unsigned char * extra = cursor + 46 + nameLength;
+        const unsigned char * extraEnd = extra + extraLength;
+        while (extraEnd - extra >= 4) {
+            std::uint16_t id = read16(extra);
+            std::uint16_t length = read16(extra + 2);
+            const unsigned char * field = extra + 4;
+            if (length > extraEnd - field) {
+                break;
+            }
+            const unsigned char * fieldEnd = field + length;
+            if (id == 0x0001) {
+                if (entry.uncompressedSize == 0xFFFFFFFF && fieldEnd - field >= 8) {
+                    entry.uncompressedSize = read64(field);
+                    field += 8;
+                }
+                if (entry.compressedSize == 0xFFFFFFFF && fieldEnd - field >= 8) {
+                    entry.compressedSize = read64(field);
+                    field += 8;
+                }
+                if (entry.localHeaderOffset == 0xFFFFFFFF && fieldEnd - field >= 8) {
+                    entry.localHeaderOffset = read64(field);
+                }
+            }
+            extra = fieldEnd;
+        }
+
+        entries.push_back(std::move(entry));
+        cursor += 46 + nameLength + extraLength + commentLength;
+    }
+    return true;
+}
+
+// Returns a pointer to an entry's (compressed) bytes within the archive, or nullptr if they fall outside of it
+const unsigned char * ZipHandler::findEntryData(const unsigned char * data, std::size_t size, const ZipEntry &entry) {
+    if (!within(entry.localHeaderOffset, 30, size)) {
+        return nullptr;
+    }
+    const unsigned char * header = data + entry.localHeaderOffset;
+    if (read32(header) != 0x04034b50) {
+        return nullptr;
+    }
+
+    std::uint64_t dataOffset = entry.localHeaderOffset + 30 + read16(header + 26) + read16(header + 28);
+    if (!within(dataOffset, entry.compressedSize, size)) {
+        return nullptr;
+    }
+    return data + dataOffset;
+}
+
+// Decodes a zip entry into memory. Returns false if it can't be decoded or its CRC doesn't match.
+bool ZipHandler::decodeEntry(const unsigned char * data, std::size_t size, const ZipEntry &entry, char * output) {
+    const unsigned char * input = findEntryData(data, size, entry);
+    if (input == nullptr) {
+        return false;
+    }
+
+    // Empty files have nothing to decode (and zlib refuses a null output buffer)
+    if (entry.uncompressedSize == 0) {
+        return entry.crc == 0;
+    }
+
+    if (entry.method == 0) {
+        std::memcpy(output, input, static_cast<std::size_t>(entry.uncompressedSize));
+    } else if (!inflateWhole(input, entry.compressedSize, output, entry.uncompressedSize)) {
+        return false;
+    }
+
+    std::uint32_t crc = static_cast<std::uint32_t>(crc32_z(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef *>(output),
+                                                           static_cast<z_size_t>(entry.uncompressedSize)));
+    return crc == entry.crc;
+}
+
+//=== ENGINE
+// Sets the engine used by every following extraction
+void ZipHandler::setEngine(ExtractEngine engine) { currentEngine = engine; }
+
+// Returns the engine currently used for extraction
+ExtractEngine ZipHandler::getEngine() { return currentEngine; }
+
+// Sets whether extract() skips files that are already on disk unchanged
+void ZipHandler::setIncremental(bool enabled) { incrementalExtraction = enabled; }
+
+// Returns whether extract() skips files that are already on disk unchanged
+bool ZipHandler::isIncremental() { return incrementalExtraction; }
+
+// Returns the CRC32 of a file's contents. Sets ok to false if the file could not be read.
+std::uint32_t ZipHandler::fileCrc(const std::string &path, bool &ok) {
+    std::uint32_t crc = static_cast<std::uint32_t>(crc32(0L, Z_NULL, 0));
+    ok = std::filesystem::exists(path);
+    if (!ok || std::filesystem::file_size(path) == 0) {
+        return crc;
+    }
+
+    MappedFile file(path);
+    ok = file.isOpen();
+    if (ok) {
+        crc = static_cast<std::uint32_t>(crc32_z(crc, file.data(), static_cast<z_size_t>(file.size())));
+    }
+    return crc;
+}
+
+//=== EXTRACT STATS
+double ExtractStats::filesPerSecond() const {
+    return seconds > 0.0 ? files / seconds : 0.0;
+}
+
+double ExtractStats::megabytesPerSecond() const {
+    return seconds > 0.0 ? (bytes / 1000000.0) / seconds : 0.0;
+}
@@ -1,15 +1,81 @@
 #ifndef ZIPHANDLER_H
 #define ZIPHANDLER_H
 #include <string>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <cstdio>
+
+class MemoryStage;
+
+// Throughput numbers gathered during an extraction
+struct ExtractStats
+{
+    std::uint64_t files = 0;        // Written whole and verified; failed files are only counted in "failed"
+    std::uint64_t bytes = 0;
+    std::uint64_t skipped = 0;
+    std::uint64_t failed = 0;
+    double seconds = 0.0;
+
+    double filesPerSecond() const;
+    double megabytesPerSecond() const;
+};
+
+/* Sends every archive entry under a prefix (ending in '/') to a destination directory. A prefix that
+ * names a file instead sends just that entry to the destination, which is then the file's full path.
+*/
+struct PathMapping
+{
+    std::string prefix;
+    std::string destination;
+};
+
+// A file record read from an archive's central directory
+struct ZipEntry
+{
+    std::string name;
+    std::uint64_t localHeaderOffset = 0;
+    std::uint64_t compressedSize = 0;
+    std::uint64_t uncompressedSize = 0;
+    std::uint32_t crc = 0;
+    std::uint16_t method = 0;
+    std::uint16_t flags = 0;
+};
+
+// The decompression path used for extraction
+enum class ExtractEngine
+{
+    Libzip,     // Streams every entry through zip_fread
+    Mapped      // Memory-maps the archive and inflates whole entries at once (with libdeflate when available)
+};
 
 class ZipHandler
 {
 public:
     ZipHandler();
 
-    static int extract(std::string filePath, std::string targetPath);
+    static int extract(std::string filePath, std::string targetPath, ExtractStats * stats = nullptr);
+    static int extractMapped(std::string filePath, const std::vector<PathMapping> &mappings, ExtractStats * stats = nullptr);
+    static int extractToMemory(std::string filePath, MemoryStage &stage, ExtractStats * stats = nullptr);
+    static std::string findRootFolder(std::string filePath);
+    static std::vector<ZipEntry> listEntries(std::string filePath);
+    static std::vector<std::string> listFiles(std::string filePath);
+    static bool mapEntryPath(const std::string &name, const std::vector<PathMapping> &mappings, std::string &fullPath);
     static std::string sanitizeFilename(std::string& filename);
     static bool isPathTooLong(const std::string & path);
+    static std::FILE * createFile(const std::string &path);
+
+    //=== ARCHIVE LAYOUT
+    static bool readCentralDirectory(const unsigned char * data, std::size_t size, std::vector<ZipEntry> &entries);
+    static const unsigned char * findEntryData(const unsigned char * data, std::size_t size, const ZipEntry &entry);
+    static bool decodeEntry(const unsigned char * data, std::size_t size, const ZipEntry &entry, char * output);
+
+    //=== ENGINE
+    static void setEngine(ExtractEngine engine);
+    static ExtractEngine getEngine();
+    static void setIncremental(bool enabled);
+    static bool isIncremental();
+    static std::uint32_t fileCrc(const std::string &path, bool &ok);
 };
 
 #endif // ZIPHANDLER_H
@@ -0,0 +1,253 @@
+#include "zipindex.h"
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+// Layout of the index file
+static const char INDEX_MAGIC[4] = { 'Z', 'I', 'D', 'X' };
+static const std::uint32_t INDEX_VERSION = 1;
+static const std::size_t HEADER_SIZE = 40;
+static const std::size_t RECORD_SIZE = 40;
+
+// Little-endian encoding helpers
+static void put16(std::string &out, std::uint16_t value) {
+    for (int i = 0; i < 2; ++i) { out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF)); }
+}
+static void put32(std::string &out, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) { out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF)); }
+}
+static void put64(std::string &out, std::uint64_t value) {
+    for (int i = 0; i < 8; ++i) { out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF)); }
+}
+static std::uint64_t get(const unsigned char * p, int bytes) {
+    std::uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; --i) { value = (value << 8) | p[i]; }
+    return value;
+}
+
+// Returns the archive's modification time as a plain number, used to detect a stale index
+static std::int64_t archiveTime(const std::string &archivePath) {
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(archivePath, error);
+    return error ? 0 : static_cast<std::int64_t>(time.time_since_epoch().count());
+}
+
+ZipIndex::ZipIndex() {}
+
+//=== FUNCTIONALITIES
+// Returns where the index for an archive is stored
+std::string ZipIndex::indexPathFor(const std::string &archivePath) {
+    return archivePath + ".idx";
+}
+
+/* Checks that an archive is complete: the central directory must be present and every entry's
+ * local header and data must lie inside the file. Describes the first problem found in "problem".
+*/
+bool ZipIndex::verifyArchive(const std::string &archivePath, std::string &problem) {
+    MappedFile archive(archivePath);
+    if (!archive.isOpen()) {
+        problem = "the archive could not be opened";
+        return false;
+    }
+
+    std::vector<ZipEntry> entries;
+    if (!ZipHandler::readCentralDirectory(archive.data(), archive.size(), entries)) {
+        problem = "the central directory is missing or damaged (truncated download?)";
+        return false;
+    }
+    if (entries.empty()) {
+        problem = "the archive is empty";
+        return false;
+    }
+
+    for (const ZipEntry &entry : entries) {
+        if (ZipHandler::findEntryData(archive.data(), archive.size(), entry) == nullptr) {
+            problem = "the data for '" + entry.name + "' lies outside of the archive";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Builds the index for an archive and writes it next to it. Returns false if the archive is incomplete.
+bool ZipIndex::build(const std::string &archivePath) {
+    std::vector<ZipEntry> entries;
+    {
+        MappedFile archive(archivePath);
+        if (!archive.isOpen() || !ZipHandler::readCentralDirectory(archive.data(), archive.size(), entries)) {
+            return false;
+        }
+        for (const ZipEntry &entry : entries) {
+            if (ZipHandler::findEntryData(archive.data(), archive.size(), entry) == nullptr) {
+                return false;
+            }
+        }
+    }
+
+    // Sort the entries so lookups can binary search
+    std::sort(entries.begin(), entries.end(), [](const ZipEntry &a, const ZipEntry &b) { return a.name < b.name; });
+
+    // Lay out the records and the name table
+    std::string records;
+    std::string names;
+    records.reserve(entries.size() * RECORD_SIZE);
+    for (const ZipEntry &entry : entries) {
+        put32(records, static_cast<std::uint32_t>(names.size()));
+        put32(records, static_cast<std::uint32_t>(entry.name.size()));
+        put64(records, entry.localHeaderOffset);
+        put64(records, entry.compressedSize);
+        put64(records, entry.uncompressedSize);
+        put32(records, entry.crc);
+        put16(records, entry.method);
+        put16(records, entry.flags);
+        names += entry.name;
+    }
+
+    std::string header(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    put32(header, INDEX_VERSION);
+    put64(header, std::filesystem::file_size(archivePath));
+    put64(header, static_cast<std::uint64_t>(archiveTime(archivePath)));
+    put64(header, entries.size());
+    put64(header, names.size());
+
+    // Write to a temporary file, then swap it in
+    std::string indexPath = indexPathFor(archivePath);
+    std::string temporaryPath = indexPath + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        out.write(header.data(), header.size());
+        out.write(records.data(), records.size());
+        out.write(names.data(), names.size());
+        if (!out) {
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, indexPath, error);
+    return !error;
+}
+
+/* Maps the stored index for an archive. Returns false if there is none or it no longer matches the
+ * archive. An index that matches the archive but whose records point outside of its name table is
+ * damaged: it is rebuilt from the archive and opened again.
+*/
+bool ZipIndex::open(const std::string &archivePath) {
+    if (openStored(archivePath) != Stored::Damaged) {
+        return isOpen();
+    }
+    return build(archivePath) && openStored(archivePath) == Stored::Valid;
+}
+// Unmaps the index
+void ZipIndex::close() {
+    file.close();
+    entryCount = 0;
+}
+
+//=== LOOKUPS
+bool ZipIndex::isOpen() const { return file.isOpen(); }
+
+std::size_t ZipIndex::size() const { return entryCount; }
+
+// Returns the name of the entry at a sorted position
+std::string ZipIndex::nameAt(std::size_t i) const {
+    const unsigned char * record = file.data() + HEADER_SIZE + i * RECORD_SIZE;
+    const char * names = reinterpret_cast<const char *>(file.data() + HEADER_SIZE + entryCount * RECORD_SIZE);
+    return std::string(names + get(record, 4), static_cast<std::size_t>(get(record + 4, 4)));
+}
+
+// Returns the entry at a sorted position
+ZipEntry ZipIndex::entry(std::size_t i) const {
+    const unsigned char * record = file.data() + HEADER_SIZE + i * RECORD_SIZE;
+    ZipEntry result;
+    result.name = nameAt(i);
+    result.localHeaderOffset = get(record + 8, 8);
+    result.compressedSize = get(record + 16, 8);
+    result.uncompressedSize = get(record + 24, 8);
+    result.crc = static_cast<std::uint32_t>(get(record + 32, 4));
+    result.method = static_cast<std::uint16_t>(get(record + 36, 2));
+    result.flags = static_cast<std::uint16_t>(get(record + 38, 2));
+    return result;
+}
+
+// Looks up an entry by its full name in the archive. Returns false if there is no such entry.
+bool ZipIndex::find(const std::string &name, ZipEntry &result) const {
+    std::size_t low = 0;
+    std::size_t high = entryCount;
+    while (low < high) {
+        std::size_t middle = low + (high - low) / 2;
+        int comparison = nameAt(middle).compare(name);
+        if (comparison == 0) {
+            result = entry(middle);
+            return true;
+        }
+        if (comparison < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return false;
+}
+
+// Returns every entry, sorted by name
+std::vector<ZipEntry> ZipIndex::entries() const {
+    std::vector<ZipEntry> result;
+    result.reserve(entryCount);
+    for (std::size_t i = 0; i < entryCount; ++i) {
+        result.push_back(entry(i));
+    }
+    return result;
+}
+
+// Returns the total size of every entry once extracted
+std::uint64_t ZipIndex::totalUncompressedSize() const {
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < entryCount; ++i) {
+        total += get(file.data() + HEADER_SIZE + i * RECORD_SIZE + 24, 8);
+    }
+    return total;
+}
+
+//=== PRIVATE
+// Maps the stored index and checks its layout and every record against it
+ZipIndex::Stored ZipIndex::openStored(const std::string &archivePath) {
+    close();
+
+    std::error_code error;
+    std::uint64_t archiveSize = std::filesystem::file_size(archivePath, error);
+    if (error || !file.open(indexPathFor(archivePath))) {
+        return Stored::Missing;
+    }
+
+    const unsigned char * data = file.data();
+    if (file.size() < HEADER_SIZE || std::memcmp(data, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0
+        || get(data + 4, 4) != INDEX_VERSION
+        || get(data + 8, 8) != archiveSize
+        || static_cast<std::int64_t>(get(data + 16, 8)) != archiveTime(archivePath)) {
+        close();
+        return Stored::Stale;
+    }
+
+    // Compare by division and subtraction: the counts come from the file and could overflow a sum
+    std::uint64_t count = get(data + 24, 8);
+    std::uint64_t namesSize = get(data + 32, 8);
+    std::uint64_t body = file.size() - HEADER_SIZE;
+    if (count > body / RECORD_SIZE || namesSize != body - count * RECORD_SIZE) {
+        close();
+        return Stored::Damaged;
+    }
+
+    const unsigned char * record = data + HEADER_SIZE;
+    for (std::uint64_t i = 0; i < count; ++i, record += RECORD_SIZE) {
+        std::uint64_t nameOffset = get(record, 4);
+        std::uint64_t nameLength = get(record + 4, 4);
+        if (nameOffset > namesSize || nameLength > namesSize - nameOffset) {
+            close();
+            return Stored::Damaged;
+        }
+    }
+
+    entryCount = static_cast<std::size_t>(count);
+    return Stored::Valid;
+}
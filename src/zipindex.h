@@ -0,0 +1,43 @@
+#ifndef ZIPINDEX_H
+#define ZIPINDEX_H
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "mappedfile.h"
+#include "ziphandler.h"
+
+/* A compact, sorted listing of an archive's entries, stored next to the archive as "<archive>.idx".
+ * The file is a fixed-size header, fixed-size entry records sorted by name, then a table of names,
+ * so it can be memory-mapped and searched without opening the archive itself.
+*/
+class ZipIndex
+{
+public:
+    ZipIndex();
+
+    //=== FUNCTIONALITIES
+    static std::string indexPathFor(const std::string &archivePath);
+    static bool build(const std::string &archivePath);
+    static bool verifyArchive(const std::string &archivePath, std::string &problem);
+    bool open(const std::string &archivePath);
+    void close();
+
+    //=== LOOKUPS
+    bool isOpen() const;
+    std::size_t size() const;
+    ZipEntry entry(std::size_t i) const;
+    bool find(const std::string &name, ZipEntry &result) const;
+    std::vector<ZipEntry> entries() const;
+    std::uint64_t totalUncompressedSize() const;
+
+private:
+    enum class Stored { Valid, Missing, Stale, Damaged };
+
+    Stored openStored(const std::string &archivePath);
+    std::string nameAt(std::size_t i) const;
+
+    MappedFile file;
+    std::size_t entryCount = 0;
+};
+
+#endif // ZIPINDEX_H